@@ -0,0 +1,192 @@
+#ifndef AISDI_MAPS_BASELINE_H
+#define AISDI_MAPS_BASELINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace bm {
+
+    /* Raw samples of previous runs, stored as "suite,benchmark,n,sample,sample,..." lines. */
+    class Baseline {
+    public:
+        using Key = std::tuple<std::string, std::string, int>;
+
+        struct Comparison {
+            std::string mSuite;
+            std::string mBenchmark;
+            int mCase;
+            double mBaseline;
+            double mCurrent;
+            double mChange;
+            double mPValue;
+            bool mRegression;
+        };
+
+        Baseline& record(const BenchmarkSuite& pSuite) {
+            for (auto&& bench : pSuite.getBenchmarks())
+                for (auto&& result : bench.getSamples())
+                    if (!result.second.empty())
+                        mSamples[Key(pSuite.getName(), bench.getName(), result.first)] = result.second;
+            return *this;
+        }
+
+        Baseline& addComment(const std::string& pComment) {
+            mComments.push_back(pComment);
+            return *this;
+        }
+
+        bool isEmpty() const {
+            return mSamples.empty();
+        }
+
+        static Baseline load(const std::string& pFile) {
+            std::ifstream file(pFile.c_str());
+            if (!file)
+                throw std::runtime_error("Unable to open baseline " + pFile);
+
+            Baseline baseline;
+            std::string line;
+            int lineNumber = 0;
+            while (std::getline(file, line)) {
+                ++lineNumber;
+                if (line.empty() || line[0] == '#')
+                    continue;
+
+                std::vector<std::string> fields;
+                std::stringstream stream(line);
+                std::string field;
+                while (std::getline(stream, field, ','))
+                    fields.push_back(field);
+
+                try {
+                    if (fields.size() < 4)
+                        throw std::invalid_argument("too few fields");
+                    std::vector<double> samples;
+                    for (std::size_t i = 3; i < fields.size(); ++i)
+                        samples.push_back(std::stod(fields[i]));
+                    baseline.mSamples[Key(fields[0], fields[1], std::stoi(fields[2]))] = samples;
+                } catch (std::exception&) {
+                    throw std::runtime_error(pFile + ":" + std::to_string(lineNumber) + ": malformed baseline entry");
+                }
+            }
+            return baseline;
+        }
+
+        void save(const std::string& pFile) const {
+            std::ofstream file(pFile.c_str());
+            if (!file)
+                throw std::runtime_error("Unable to write baseline " + pFile);
+
+            file << "# suite,benchmark,n,samples...\n";
+            for (auto&& comment : mComments)
+                file << "# " << comment << "\n";
+            for (auto&& entry : mSamples) {
+                file << std::get<0>(entry.first) << "," << std::get<1>(entry.first) << "," << std::get<2>(entry.first);
+                for (double sample : entry.second)
+                    file << "," << std::setprecision(10) << sample;
+                file << "\n";
+            }
+        }
+
+        /* Compares pCurrent against this baseline, case by case. A case regresses when its median got slower
+         * by more than pThreshold (0.1 = 10%) and a one-sided rank test rejects "not slower" at pAlpha.
+         * Cases with a single sample on either side cannot be tested and are judged by the threshold alone. */
+        std::vector<Comparison> compare(const Baseline& pCurrent, double pThreshold, double pAlpha) const {
+            std::vector<Comparison> result;
+            for (auto&& entry : pCurrent.mSamples) {
+                auto baseline = mSamples.find(entry.first);
+                if (baseline == mSamples.end())
+                    continue;
+
+                Comparison comparison;
+                comparison.mSuite = std::get<0>(entry.first);
+                comparison.mBenchmark = std::get<1>(entry.first);
+                comparison.mCase = std::get<2>(entry.first);
+                comparison.mBaseline = median(baseline->second);
+                comparison.mCurrent = median(entry.second);
+                comparison.mChange = comparison.mCurrent / comparison.mBaseline - 1.0;
+                comparison.mPValue = rankTest(baseline->second, entry.second);
+                comparison.mRegression = comparison.mChange > pThreshold && comparison.mPValue < pAlpha;
+                result.push_back(comparison);
+            }
+            return result;
+        }
+
+        static void report(const std::vector<Comparison>& pComparisons, std::ostream& pOut) {
+            pOut << std::left << std::setw(48) << "Benchmark" << std::right << std::setw(10) << "N"
+                 << std::setw(14) << "Baseline" << std::setw(14) << "Current" << std::setw(10) << "Change"
+                 << std::setw(10) << "p" << "\n";
+            for (auto&& item : pComparisons) {
+                pOut << std::left << std::setw(48) << (item.mSuite + "/" + item.mBenchmark) << std::right
+                     << std::setw(10) << item.mCase
+                     << std::setw(14) << std::setprecision(6) << item.mBaseline
+                     << std::setw(14) << item.mCurrent
+                     << std::setw(9) << std::fixed << std::setprecision(1) << item.mChange * 100 << "%"
+                     << std::setw(10) << std::setprecision(4) << item.mPValue << std::defaultfloat
+                     << (item.mRegression ? "  REGRESSION" : "") << "\n";
+            }
+        }
+
+    private:
+        std::map<Key, std::vector<double>> mSamples;
+        std::vector<std::string> mComments;
+
+        static double median(std::vector<double> pSamples) {
+            std::sort(pSamples.begin(), pSamples.end());
+            std::size_t middle = pSamples.size() / 2;
+            if (pSamples.size() % 2)
+                return pSamples[middle];
+            return (pSamples[middle - 1] + pSamples[middle]) / 2;
+        }
+
+        /* One-sided Mann-Whitney U test: p-value of "pCurrent is not slower than pBaseline". Rank based, so a
+         * single cold-cache outlier does not decide the outcome. Uses the normal approximation with tie and
+         * continuity corrections. */
+        static double rankTest(const std::vector<double>& pBaseline, const std::vector<double>& pCurrent) {
+            if (pBaseline.size() < 2 || pCurrent.size() < 2)
+                return 0.0;
+
+            std::vector<std::pair<double, bool>> all;
+            for (double sample : pBaseline)
+                all.push_back(std::make_pair(sample, false));
+            for (double sample : pCurrent)
+                all.push_back(std::make_pair(sample, true));
+            std::sort(all.begin(), all.end());
+
+            double n1 = pBaseline.size(), n2 = pCurrent.size(), n = all.size();
+            double currentRanks = 0, ties = 0;
+            for (std::size_t i = 0; i < all.size();) {
+                std::size_t j = i;
+                while (j < all.size() && all[j].first == all[i].first)
+                    ++j;
+                double rank = (i + j + 1) / 2.0;
+                for (std::size_t k = i; k < j; ++k)
+                    if (all[k].second)
+                        currentRanks += rank;
+                double t = j - i;
+                ties += t * t * t - t;
+                i = j;
+            }
+
+            double u = currentRanks - n2 * (n2 + 1) / 2;
+            double sigma = std::sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+            if (sigma == 0.0)
+                return 1.0;
+            double z = (u - n1 * n2 / 2 - 0.5) / sigma;
+            return 0.5 * std::erfc(z / std::sqrt(2.0));
+        }
+    };
+}
+
+#endif /* AISDI_MAPS_BASELINE_H */
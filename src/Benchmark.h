@@ -1,3 +1,6 @@
+#ifndef AISDI_MAPS_BENCHMARK_H
+#define AISDI_MAPS_BENCHMARK_H
+
 #include <initializer_list>
 #include <string>
 #include <functional>
@@ -6,9 +9,57 @@
 #include <iomanip>
 #include <map>
 #include <list>
+#include <memory>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <regex>
+#include <stdexcept>
 
 namespace bm {
+
+    inline std::string jsonQuote(const std::string& pText) {
+        std::ostringstream out;
+        out << '"';
+        for (char c : pText) {
+            switch (c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+                    else
+                        out << c;
+            }
+        }
+        out << '"';
+        return out.str();
+    }
+
+    /* Benchmark with untimed preparation: only run() is measured, setUp() (building inputs, pre-generating
+     * keys) and tearDown() (destroying collections) are excluded. One instance is reused for all cases. */
+    class Fixture {
+    public:
+        virtual ~Fixture() {}
+
+        virtual void setUp(int) {}
+
+        virtual void run(int n) = 0;
+
+        virtual void tearDown() {}
+
+        /* Number of operations performed by run(n), used for the ns/op normalization. */
+        virtual double operations(int n) {
+            return n;
+        }
+
+        /* Called after a timed run(n) that took pSeconds, before tearDown(), to report extra counters. */
+        virtual void counters(int, double, std::map<std::string, double>&) {}
+    };
+
     class Benchmark {
     public:
 
@@ -28,12 +79,70 @@ namespace bm {
             }
         }
 
+        /* Named per-case metrics reported next to the time, averaged over repetitions. "ns/op" is added to
+         * every case, dividing the median time by the "ops" counter (or the case size when there is none). */
+        using Counters = std::map<std::string, double>;
+
+        /* Runs a single case and returns its duration in seconds, for benchmarks that time themselves. */
+        using Measurement = std::function<double(int, Counters&)>;
+
         Benchmark(std::string pName,
                   std::function<void(int)> pFunc,
-                  std::initializer_list<int> pCases) : mName(pName), mTestFunc(pFunc) {
+                  std::initializer_list<int> pCases) : Benchmark(pName, timed(pFunc), pCases, "N") {}
+
+        /* Benchmark whose cases are not collection sizes (pCaseName is used as the column header),
+         * so runner-wide case overrides leave it alone. */
+        static Benchmark measured(std::string pName, Measurement pMeasure, std::vector<int> pCases,
+                                  std::string pCaseName = "N") {
+            return Benchmark(pName, pMeasure, pCases, pCaseName);
+        }
+
+        template<typename Cases>
+        static Benchmark fixture(std::string pName, std::shared_ptr<Fixture> pFixture, const Cases& pCases) {
+            return Benchmark(pName, [pFixture](int n, Counters& pCounters) {
+                using namespace std::chrono;
+                pFixture->setUp(n);
+                time_point<steady_clock> start = steady_clock::now();
+                pFixture->run(n);
+                duration<double> elapsed = steady_clock::now() - start;
+                pFixture->counters(n, elapsed.count(), pCounters);
+                pFixture->tearDown();
+                pCounters["ops"] = pFixture->operations(n);
+                return elapsed.count();
+            }, pCases, "N");
+        }
+
+        static Benchmark fixture(std::string pName, std::shared_ptr<Fixture> pFixture,
+                                 std::initializer_list<int> pCases) {
+            return fixture<std::initializer_list<int>>(pName, pFixture, pCases);
+        }
+
+        const std::string& getName() const {
+            return mName;
+        }
+
+        const std::map<int, std::vector<double>>& getSamples() const {
+            return mSamples;
+        }
+
+        Benchmark& setCases(const std::vector<int>& pCases) {
+            if (mCaseName != "N")
+                return *this;
+            mResults.clear();
+            mSamples.clear();
+            mCounters.clear();
             for (auto&& item : pCases)
                 mResults.insert(std::make_pair(item, -1.0));
-        };
+            return *this;
+        }
+
+        /* Every case is run pRepetitions times, the reported result is the median. */
+        Benchmark& setRepetitions(int pRepetitions) {
+            if (pRepetitions < 1)
+                throw std::invalid_argument("At least one repetition is required");
+            mRepetitions = pRepetitions;
+            return *this;
+        }
 
         Benchmark& run() {
             return run([](std::pair<const int, double>, int) {});
@@ -41,17 +150,23 @@ namespace bm {
 
         template<typename Tt>
         Benchmark& run(Tt pCallback) {
-            using namespace std::chrono;
-            time_point<system_clock> start, end;
-            duration<double> elapsed;
             int i = 0;
             for (auto&& item : mResults) {
                 i+= 100;
-                start = system_clock::now();
-                mTestFunc(item.first);
-                end = system_clock::now();
-                elapsed = end - start;
-                item.second = elapsed.count();
+                std::vector<double>& samples = mSamples[item.first];
+                Counters& counters = mCounters[item.first];
+                samples.clear();
+                counters.clear();
+                for (int r = 0; r < mRepetitions; ++r) {
+                    Counters current;
+                    samples.push_back(mMeasure(item.first, current));
+                    for (auto&& counter : current)
+                        counters[counter.first] += counter.second / mRepetitions;
+                }
+                item.second = median(samples);
+                double operations = counters.count("ops") ? counters["ops"] : item.first;
+                if (operations > 0)
+                    counters["ns/op"] = item.second * 1e9 / operations;
                 pCallback(item, (int)(i/mResults.size()));
             }
             return *this;
@@ -59,23 +174,97 @@ namespace bm {
 
         Benchmark& exportFancy(std::ostream& pOut) {
             pOut << "Benchmark: " << mName << "\n";
-            for (auto&& result : mResults)
-                pOut << result.first << "\t\t\t" << std::setprecision(10) << result.second << "\n";
+            for (auto&& result : mResults) {
+                pOut << result.first << "\t\t\t" << std::setprecision(10) << result.second;
+                for (auto&& counter : mCounters[result.first])
+                    pOut << "\t" << counter.first << " " << counter.second;
+                pOut << "\n";
+            }
             return *this;
         }
 
         Benchmark& exportCSV(std::ostream& pOut) {
-            pOut << "N," << mName << "\n";
-            for (auto&& result : mResults)
-                pOut << result.first << "," << std::setprecision(10) << result.second << "\n";
+            std::vector<std::string> counters = counterNames();
+            pOut << mCaseName << "," << mName;
+            for (auto&& counter : counters)
+                pOut << "," << mName << " " << counter;
+            pOut << "\n";
+            for (auto&& result : mResults) {
+                pOut << result.first << "," << std::setprecision(10) << result.second;
+                for (auto&& counter : counters)
+                    pOut << "," << mCounters[result.first][counter];
+                pOut << "\n";
+            }
+            return *this;
+        }
+
+        Benchmark& exportJSON(std::ostream& pOut) {
+            pOut << "{\"name\": " << jsonQuote(mName) << ", \"case\": " << jsonQuote(mCaseName)
+                 << ", \"repetitions\": " << mRepetitions << ", \"cases\": [";
+            bool first = true;
+            for (auto&& result : mResults) {
+                pOut << (first ? "" : ", ") << "{\"n\": " << result.first
+                     << ", \"seconds\": " << std::setprecision(10) << result.second << ", \"samples\": [";
+                const std::vector<double>& samples = mSamples[result.first];
+                for (std::size_t i = 0; i < samples.size(); ++i)
+                    pOut << (i ? ", " : "") << samples[i];
+                pOut << "], \"counters\": {";
+                bool firstCounter = true;
+                for (auto&& counter : mCounters[result.first]) {
+                    pOut << (firstCounter ? "" : ", ") << jsonQuote(counter.first) << ": " << counter.second;
+                    firstCounter = false;
+                }
+                pOut << "}}";
+                first = false;
+            }
+            pOut << "]}";
             return *this;
         }
 
     private:
         std::string mName;
-        std::function<void(int)> mTestFunc;
+        Measurement mMeasure;
+        std::string mCaseName;
         std::map<int, double> mResults;
+        std::map<int, std::vector<double>> mSamples;
+        std::map<int, Counters> mCounters;
+        int mRepetitions;
+
+        template<typename Cases>
+        Benchmark(std::string pName, Measurement pMeasure, const Cases& pCases, std::string pCaseName)
+                : mName(pName), mMeasure(pMeasure), mCaseName(pCaseName), mRepetitions(1) {
+            for (auto&& item : pCases)
+                mResults.insert(std::make_pair(item, -1.0));
+        }
 
+        static Measurement timed(std::function<void(int)> pFunc) {
+            return [pFunc](int n, Counters&) {
+                using namespace std::chrono;
+                time_point<steady_clock> start = steady_clock::now();
+                pFunc(n);
+                duration<double> elapsed = steady_clock::now() - start;
+                return elapsed.count();
+            };
+        }
+
+        std::vector<std::string> counterNames() {
+            std::vector<std::string> names;
+            for (auto&& item : mCounters)
+                for (auto&& counter : item.second)
+                    if (std::find(names.begin(), names.end(), counter.first) == names.end())
+                        names.push_back(counter.first);
+            return names;
+        }
+
+        static double median(std::vector<double> pSamples) {
+            if (pSamples.empty())
+                return -1.0;
+            std::sort(pSamples.begin(), pSamples.end());
+            std::size_t middle = pSamples.size() / 2;
+            if (pSamples.size() % 2)
+                return pSamples[middle];
+            return (pSamples[middle - 1] + pSamples[middle]) / 2;
+        }
     };
 
 
@@ -90,6 +279,25 @@ namespace bm {
                 mBenchmarks.emplace_back(std::forward<Tt>(item));
         }
 
+        const std::string& getName() const {
+            return mName;
+        }
+
+        bool isEmpty() const {
+            return mBenchmarks.empty();
+        }
+
+        const std::list<Benchmark>& getBenchmarks() const {
+            return mBenchmarks;
+        }
+
+        std::list<std::string> getBenchmarkNames() const {
+            std::list<std::string> names;
+            for (auto&& item : mBenchmarks)
+                names.push_back(mName + "/" + item.getName());
+            return names;
+        }
+
         template<typename Tt>
         BenchmarkSuite& addBenchmark(Tt&& pBenchmark) {
             mBenchmarks.emplace_back(std::forward<Tt>(pBenchmark));
@@ -97,6 +305,28 @@ namespace bm {
             return *this;
         }
 
+        /* Keeps only benchmarks whose "Suite/Benchmark" name matches pPattern. */
+        BenchmarkSuite& filter(const std::regex& pPattern) {
+            mBenchmarks.remove_if([&](const Benchmark& pBenchmark) {
+                return !std::regex_search(mName + "/" + pBenchmark.getName(), pPattern);
+            });
+            return *this;
+        }
+
+        BenchmarkSuite& setCases(const std::vector<int>& pCases) {
+            for (auto&& item : mBenchmarks)
+                item.setCases(pCases);
+            mReady = false;
+            return *this;
+        }
+
+        BenchmarkSuite& setRepetitions(int pRepetitions) {
+            for (auto&& item : mBenchmarks)
+                item.setRepetitions(pRepetitions);
+            mReady = false;
+            return *this;
+        }
+
         template<typename Tt>
         BenchmarkSuite& run(Tt pCallback) {
             int i = 0;
@@ -153,9 +383,25 @@ namespace bm {
             return *this;
         }
 
+        BenchmarkSuite& exportJSON(std::ostream& pOut) {
+            if (!mReady)
+                throw std::logic_error("Trying to print unready benchmark results");
+            pOut << "{\"suite\": " << jsonQuote(mName) << ", \"benchmarks\": [";
+            bool first = true;
+            for (auto&& bench : mBenchmarks) {
+                pOut << (first ? "\n  " : ",\n  ");
+                bench.exportJSON(pOut);
+                first = false;
+            }
+            pOut << "]}";
+            return *this;
+        }
+
     private:
         std::string mName;
         std::list<Benchmark> mBenchmarks;
         bool mReady;
     };
-}
\ No newline at end of file
+}
+
+#endif /* AISDI_MAPS_BENCHMARK_H */
@@ -0,0 +1,338 @@
+#ifndef AISDI_MAPS_BENCHMARKRUNNER_H
+#define AISDI_MAPS_BENCHMARKRUNNER_H
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "Baseline.h"
+#include "Benchmark.h"
+
+#ifndef AISDI_GIT_COMMIT
+#define AISDI_GIT_COMMIT "unknown"
+#endif
+
+#ifndef AISDI_BUILD_TYPE
+#define AISDI_BUILD_TYPE "unknown"
+#endif
+
+#ifndef AISDI_BUILD_FLAGS
+#define AISDI_BUILD_FLAGS "unknown"
+#endif
+
+namespace bm {
+
+    class BenchmarkRunner {
+    public:
+
+        struct Options {
+            std::string mFilter = ".*";
+            std::vector<int> mCases;
+            int mRepetitions = 1;
+            int mCpu = -1;
+            std::string mJsonFile;
+            std::string mCsvDir = ".";
+            bool mCsv = true;
+            std::string mBaselineFile;
+            std::string mSaveBaselineFile;
+            double mThreshold = 0.1;
+            double mAlpha = 0.01;
+            bool mList = false;
+            bool mQuiet = false;
+            bool mHelp = false;
+        };
+
+        BenchmarkRunner& addSuite(BenchmarkSuite pSuite) {
+            mSuites.push_back(std::move(pSuite));
+            return *this;
+        }
+
+        /* Parses the command line, runs the selected benchmarks and returns the process exit code. */
+        int run(int argc, char** argv) {
+            Options options;
+            try {
+                options = parse(argc, argv);
+            } catch (std::invalid_argument& e) {
+                std::cerr << e.what() << "\n\n";
+                usage(argc > 0 ? argv[0] : "aisdiMaps", std::cerr);
+                return 2;
+            }
+
+            if (options.mHelp) {
+                usage(argv[0], std::cout);
+                return 0;
+            }
+            return run(options);
+        }
+
+        int run(const Options& pOptions) {
+            std::regex pattern;
+            try {
+                pattern = std::regex(pOptions.mFilter);
+            } catch (std::regex_error& e) {
+                std::cerr << "Invalid filter \"" << pOptions.mFilter << "\": " << e.what() << "\n";
+                return 2;
+            }
+
+            for (auto&& suite : mSuites) {
+                suite.filter(pattern);
+                if (!pOptions.mCases.empty())
+                    suite.setCases(pOptions.mCases);
+                suite.setRepetitions(pOptions.mRepetitions);
+            }
+            mSuites.remove_if([](const BenchmarkSuite& pSuite) { return pSuite.isEmpty(); });
+
+            if (pOptions.mList) {
+                for (auto&& suite : mSuites)
+                    for (auto&& name : suite.getBenchmarkNames())
+                        std::cout << name << "\n";
+                return 0;
+            }
+
+            if (pOptions.mCpu >= 0 && !pinToCpu(pOptions.mCpu)) {
+                std::cerr << "Unable to pin to CPU " << pOptions.mCpu << "\n";
+                return 1;
+            }
+
+            Baseline baseline;
+            if (!pOptions.mBaselineFile.empty()) {
+                try {
+                    baseline = Baseline::load(pOptions.mBaselineFile);
+                } catch (std::runtime_error& e) {
+                    std::cerr << e.what() << "\n";
+                    return 1;
+                }
+            }
+
+            for (auto&& suite : mSuites) {
+                if (!pOptions.mQuiet)
+                    std::cout << "Suite: " << suite.getName() << "\n";
+                suite.run([&](std::pair<const int, double> pPair, int percent) {
+                    if (!pOptions.mQuiet)
+                        std::cout << "Done " << percent << "% -> " << pPair.first << " in " << pPair.second << "\n";
+                });
+                if (pOptions.mCsv)
+                    suite.exportCSVFile(pOptions.mCsvDir + "/" + suite.getName() + ".csv");
+            }
+
+            if (!pOptions.mJsonFile.empty()) {
+                if (pOptions.mJsonFile == "-") {
+                    exportJSON(std::cout, pOptions);
+                } else {
+                    std::ofstream file(pOptions.mJsonFile.c_str());
+                    if (!file) {
+                        std::cerr << "Unable to open " << pOptions.mJsonFile << "\n";
+                        return 1;
+                    }
+                    exportJSON(file, pOptions);
+                }
+            }
+
+            Baseline current;
+            current.addComment("commit " + std::string(AISDI_GIT_COMMIT) + ", " + compiler() + ", " +
+                               AISDI_BUILD_TYPE + ", " + cpuModel());
+            for (auto&& suite : mSuites)
+                current.record(suite);
+
+            if (!pOptions.mSaveBaselineFile.empty()) {
+                try {
+                    current.save(pOptions.mSaveBaselineFile);
+                } catch (std::runtime_error& e) {
+                    std::cerr << e.what() << "\n";
+                    return 1;
+                }
+            }
+
+            if (!pOptions.mBaselineFile.empty()) {
+                auto comparisons = baseline.compare(current, pOptions.mThreshold, pOptions.mAlpha);
+                if (comparisons.empty()) {
+                    std::cerr << "No benchmark cases in common with " << pOptions.mBaselineFile << "\n";
+                    return 1;
+                }
+                Baseline::report(comparisons, std::cout);
+                for (auto&& item : comparisons)
+                    if (item.mRegression)
+                        return 1;
+            }
+            return 0;
+        }
+
+        BenchmarkRunner& exportJSON(std::ostream& pOut, const Options& pOptions) {
+            pOut << "{\n\"context\": {"
+                 << "\"date\": " << jsonQuote(timestamp())
+                 << ", \"commit\": " << jsonQuote(AISDI_GIT_COMMIT)
+                 << ", \"compiler\": " << jsonQuote(compiler())
+                 << ", \"build_type\": " << jsonQuote(AISDI_BUILD_TYPE)
+                 << ", \"build_flags\": " << jsonQuote(AISDI_BUILD_FLAGS)
+                 << ", \"cpu\": " << jsonQuote(cpuModel())
+                 << ", \"pinned_cpu\": " << pOptions.mCpu
+                 << ", \"repetitions\": " << pOptions.mRepetitions
+                 << "},\n\"suites\": [";
+            bool first = true;
+            for (auto&& suite : mSuites) {
+                pOut << (first ? "\n" : ",\n");
+                suite.exportJSON(pOut);
+                first = false;
+            }
+            pOut << "]\n}\n";
+            return *this;
+        }
+
+        static Options parse(int argc, char** argv) {
+            Options options;
+            for (int i = 1; i < argc; ++i) {
+                std::string arg = argv[i];
+                auto value = [&]() -> std::string {
+                    if (i + 1 >= argc)
+                        throw std::invalid_argument("Missing value for " + arg);
+                    return argv[++i];
+                };
+
+                if (arg == "-h" || arg == "--help")
+                    options.mHelp = true;
+                else if (arg == "-l" || arg == "--list")
+                    options.mList = true;
+                else if (arg == "-q" || arg == "--quiet")
+                    options.mQuiet = true;
+                else if (arg == "-f" || arg == "--filter")
+                    options.mFilter = value();
+                else if (arg == "-c" || arg == "--cases")
+                    options.mCases = parseList(value());
+                else if (arg == "-r" || arg == "--repetitions")
+                    options.mRepetitions = parseInt(value(), 1);
+                else if (arg == "--cpu")
+                    options.mCpu = parseInt(value(), 0);
+                else if (arg == "--json")
+                    options.mJsonFile = value();
+                else if (arg == "--csv-dir")
+                    options.mCsvDir = value();
+                else if (arg == "--no-csv")
+                    options.mCsv = false;
+                else if (arg == "--baseline")
+                    options.mBaselineFile = value();
+                else if (arg == "--save-baseline")
+                    options.mSaveBaselineFile = value();
+                else if (arg == "--threshold")
+                    options.mThreshold = parseDouble(value()) / 100;
+                else if (arg == "--alpha")
+                    options.mAlpha = parseDouble(value());
+                else
+                    throw std::invalid_argument("Unknown option " + arg);
+            }
+            return options;
+        }
+
+        static void usage(const std::string& pProgram, std::ostream& pOut) {
+            pOut << "Usage: " << pProgram << " [options]\n"
+                 << "  -f, --filter REGEX       run benchmarks whose \"Suite/Benchmark\" name matches REGEX\n"
+                 << "  -c, --cases N[,N...]     override case sizes of every benchmark\n"
+                 << "  -r, --repetitions N      run every case N times and report the median (default 1)\n"
+                 << "      --cpu N              pin the process to CPU N\n"
+                 << "      --json FILE          write results with build context as JSON (\"-\" for stdout)\n"
+                 << "      --csv-dir DIR        directory for the per-suite CSV files (default .)\n"
+                 << "      --no-csv             do not write CSV files\n"
+                 << "      --save-baseline FILE store raw samples of this run as a baseline\n"
+                 << "      --baseline FILE      compare with a stored baseline, fail on regressions\n"
+                 << "      --threshold PCT      slowdown of the median tolerated before failing (default 10)\n"
+                 << "      --alpha P            significance level of the regression test (default 0.01)\n"
+                 << "  -l, --list               list selected benchmarks and exit\n"
+                 << "  -q, --quiet              do not report progress\n"
+                 << "  -h, --help               show this message\n";
+        }
+
+    private:
+        std::list<BenchmarkSuite> mSuites;
+
+        static int parseInt(const std::string& pText, int pMinimum) {
+            std::size_t used = 0;
+            int value;
+            try {
+                value = std::stoi(pText, &used);
+            } catch (std::exception&) {
+                throw std::invalid_argument("Invalid number " + pText);
+            }
+            if (used != pText.size() || value < pMinimum)
+                throw std::invalid_argument("Invalid number " + pText);
+            return value;
+        }
+
+        static double parseDouble(const std::string& pText) {
+            std::size_t used = 0;
+            double value;
+            try {
+                value = std::stod(pText, &used);
+            } catch (std::exception&) {
+                throw std::invalid_argument("Invalid number " + pText);
+            }
+            if (used != pText.size() || value < 0)
+                throw std::invalid_argument("Invalid number " + pText);
+            return value;
+        }
+
+        static std::vector<int> parseList(const std::string& pText) {
+            std::vector<int> result;
+            std::stringstream stream(pText);
+            std::string item;
+            while (std::getline(stream, item, ','))
+                result.push_back(parseInt(item, 0));
+            if (result.empty())
+                throw std::invalid_argument("Empty case list");
+            return result;
+        }
+
+        static bool pinToCpu(int pCpu) {
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(pCpu, &set);
+            return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+            (void) pCpu;
+            return false;
+#endif
+        }
+
+        static std::string compiler() {
+#if defined(__clang__)
+            return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+            return std::string("gcc ") + __VERSION__;
+#else
+            return "unknown";
+#endif
+        }
+
+        static std::string cpuModel() {
+            std::ifstream cpuinfo("/proc/cpuinfo");
+            std::string line;
+            while (std::getline(cpuinfo, line)) {
+                if (line.compare(0, 10, "model name") == 0) {
+                    std::size_t start = line.find_first_not_of(' ', line.find(':') + 1);
+                    if (start != std::string::npos)
+                        return line.substr(start);
+                }
+            }
+            return "unknown";
+        }
+
+        static std::string timestamp() {
+            std::time_t now = std::time(nullptr);
+            char buffer[32];
+            std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+            return buffer;
+        }
+    };
+}
+
+#endif /* AISDI_MAPS_BENCHMARKRUNNER_H */
@@ -0,0 +1,621 @@
+#ifndef AISDI_MAPS_FIXTURES_H
+#define AISDI_MAPS_FIXTURES_H
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FlatMap.h"
+#include "HamtMap.h"
+#include "HashKernels.h"
+#include "HashMap.h"
+#include "KeyGenerator.h"
+#include "LinkedHashMap.h"
+#include "MappedMap.h"
+#include "TreeMap.h"
+
+namespace bm {
+
+    /* HashMap with a fixed bucket count, default constructible so it can be used as a fixture Collection. */
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class BucketedHashMap : public aisdi::HashMap<KeyType, ValueType> {
+    public:
+        BucketedHashMap() : aisdi::HashMap<KeyType, ValueType>(N) {}
+
+        /* Adopts a loaded map, which keeps the bucket count it was saved with. */
+        BucketedHashMap(aisdi::HashMap<KeyType, ValueType>&& other) : aisdi::HashMap<KeyType, ValueType>(std::move(other)) {}
+    };
+
+    /* BucketedHashMap that reseeds itself with a keyed hash once it sees a flooded chain. */
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class GuardedHashMap : public aisdi::HashMap<KeyType, ValueType> {
+    public:
+        GuardedHashMap() : aisdi::HashMap<KeyType, ValueType>(N, aisdi::HashMap<KeyType, ValueType>::Hashing::Guarded) {}
+    };
+
+    /* BucketedHashMap that keeps std::hash and plain chains however long they get. */
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class UnguardedHashMap : public aisdi::HashMap<KeyType, ValueType> {
+    public:
+        UnguardedHashMap() : aisdi::HashMap<KeyType, ValueType>(N, aisdi::HashMap<KeyType, ValueType>::Hashing::Unguarded) {}
+    };
+
+    /* BucketedHashMap that keeps std::hash and only indexes long chains with trees. */
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class TreeifiedHashMap : public aisdi::HashMap<KeyType, ValueType> {
+    public:
+        TreeifiedHashMap() : aisdi::HashMap<KeyType, ValueType>(N, aisdi::HashMap<KeyType, ValueType>::Hashing::Treeified) {}
+    };
+
+    /* BucketedHashMap hashing with SipHash under a random key from the start. */
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class KeyedHashMap : public aisdi::HashMap<KeyType, ValueType> {
+    public:
+        KeyedHashMap() : aisdi::HashMap<KeyType, ValueType>(N, aisdi::HashMap<KeyType, ValueType>::Hashing::Keyed) {}
+    };
+
+    template<int N, typename KeyType = int, typename ValueType = int>
+    class BucketedLinkedHashMap : public aisdi::LinkedHashMap<KeyType, ValueType> {
+    public:
+        BucketedLinkedHashMap() : aisdi::LinkedHashMap<KeyType, ValueType>(N) {}
+    };
+
+    /* pCount keys of the case of size n, pCount < 0 means n keys. */
+    template<typename KeyType>
+    std::vector<KeyType> generateKeys(const KeyDistribution<KeyType>& pKeys, int n, int pCount = -1) {
+        KeyGenerator<KeyType> next = pKeys(n);
+        std::vector<KeyType> keys;
+        keys.reserve(pCount < 0 ? n : pCount);
+        for (int i = 0; i < (pCount < 0 ? n : pCount); ++i)
+            keys.push_back(next());
+        return keys;
+    }
+
+    /* map[pKeys[i]] = i for every key. */
+    template<class Collection, typename KeyType>
+    void fill(Collection& pMap, const std::vector<KeyType>& pKeys) {
+        for (std::size_t i = 0; i < pKeys.size(); ++i)
+            pMap[pKeys[i]] = i;
+    }
+
+    /* Single FlatMap insertions shift the tail, build it the way it is meant to be built - in one batch. */
+    template<typename KeyType, typename ValueType>
+    void fill(aisdi::FlatMap<KeyType, ValueType>& pMap, const std::vector<KeyType>& pKeys) {
+        std::vector<std::pair<KeyType, ValueType>> batch;
+        batch.reserve(pKeys.size());
+        for (std::size_t i = 0; i < pKeys.size(); ++i)
+            batch.emplace_back(pKeys[i], i);
+        pMap.insert(batch.begin(), batch.end());
+    }
+
+    /* An empty HamtMap is built bottom-up from a batch as well. */
+    template<typename KeyType, typename ValueType>
+    void fill(aisdi::HamtMap<KeyType, ValueType>& pMap, const std::vector<KeyType>& pKeys) {
+        std::vector<std::pair<KeyType, ValueType>> batch;
+        batch.reserve(pKeys.size());
+        for (std::size_t i = 0; i < pKeys.size(); ++i)
+            batch.emplace_back(pKeys[i], i);
+        pMap.insert(batch.begin(), batch.end());
+    }
+
+    template<typename KeyType, typename ValueType>
+    void fill(aisdi::FrozenTreeMap<KeyType, ValueType>& pMap, const std::vector<KeyType>& pKeys) {
+        aisdi::TreeMap<KeyType, ValueType> tree;
+        fill(tree, pKeys);
+        pMap = tree.freeze();
+    }
+
+    /* Through a HashMap with a bucket per key, the way a lookup table would be compiled at startup. */
+    template<typename KeyType, typename ValueType>
+    void fill(aisdi::PerfectHashMap<KeyType, ValueType>& pMap, const std::vector<KeyType>& pKeys) {
+        aisdi::HashMap<KeyType, ValueType> map(pKeys.size() + 1);
+        fill(map, pKeys);
+        pMap = map.freeze();
+    }
+
+    /* Times n insertions of pre-generated keys into an empty collection. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class InsertFixture : public Fixture {
+    public:
+        explicit InsertFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys) {}
+
+        void setUp(int n) override {
+            mKeys = generateKeys(mDistribution, n);
+            mMap.reset(new Collection());
+        }
+
+        void run(int) override {
+            fill(*mMap, mKeys);
+        }
+
+        void tearDown() override {
+            mMap.reset();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        std::vector<KeyType> mKeys;
+        std::unique_ptr<Collection> mMap;
+    };
+
+    /* Times lookups, drawn from pLookups, in a collection built from n keys drawn from pKeys. There are
+     * n lookups unless pLookupCount is given - small collections need more to be measurable. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class FindFixture : public Fixture {
+    public:
+        FindFixture(KeyDistribution<KeyType> pKeys, KeyDistribution<KeyType> pLookups, int pLookupCount = -1)
+                : mDistribution(pKeys), mLookupDistribution(pLookups), mLookupCount(pLookupCount), mFound(0) {}
+
+        void setUp(int n) override {
+            mLookups = generateKeys(mLookupDistribution, n, mLookupCount);
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+        }
+
+        void run(int) override {
+            const Collection& map = *mMap;
+            std::size_t found = 0;
+            for (auto&& key : mLookups)
+                found += map.find(key) != map.end();
+            mFound = found;
+        }
+
+        double operations(int) override {
+            return mLookups.size();
+        }
+
+        void tearDown() override {
+            mMap.reset();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        KeyDistribution<KeyType> mLookupDistribution;
+        int mLookupCount;
+        std::vector<KeyType> mLookups;
+        std::unique_ptr<Collection> mMap;
+        std::size_t mFound;
+    };
+
+    /* Times keyedHashBatch() of n keys drawn from pKeys with the kernels of pLevel. */
+    template<typename KeyType>
+    class HashKernelFixture : public Fixture {
+    public:
+        HashKernelFixture(KeyDistribution<KeyType> pKeys, aisdi::SimdLevel pLevel)
+                : mDistribution(pKeys), mLevel(pLevel) {}
+
+        void setUp(int n) override {
+            mKeys = generateKeys(mDistribution, n);
+            mHashes.assign(mKeys.size(), 0);
+        }
+
+        void run(int) override {
+            aisdi::keyedHashBatch(mKeys.data(), mKeys.size(), 0x0123456789abcdefULL, 0xfedcba9876543210ULL,
+                                  mHashes.data(), mLevel);
+        }
+
+        void counters(int n, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["keys/s"] = pSeconds > 0 ? n / pSeconds : 0;
+        }
+
+        void tearDown() override {
+            mKeys.clear();
+            mHashes.clear();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        aisdi::SimdLevel mLevel;
+        std::vector<KeyType> mKeys;
+        std::vector<std::uint64_t> mHashes;
+    };
+
+    /* Times n insertions of items with keys drawn from pKeys into an empty HashMap, in one batched insert or
+     * one operator[] at a time. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class BatchInsertFixture : public Fixture {
+    public:
+        BatchInsertFixture(KeyDistribution<KeyType> pKeys, bool pBatched) : mDistribution(pKeys), mBatched(pBatched) {}
+
+        void setUp(int n) override {
+            std::vector<KeyType> keys = generateKeys(mDistribution, n);
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                mItems.emplace_back(keys[i], i);
+            mMap.reset(new Collection());
+        }
+
+        void run(int) override {
+            if (mBatched) {
+                mMap->insert(mItems.begin(), mItems.end());
+            } else {
+                for (auto&& item : mItems)
+                    (*mMap)[item.first] = item.second;
+            }
+        }
+
+        void counters(int n, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["keys/s"] = pSeconds > 0 ? n / pSeconds : 0;
+        }
+
+        void tearDown() override {
+            mItems.clear();
+            mMap.reset();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        bool mBatched;
+        std::vector<std::pair<KeyType, typename Collection::mapped_type>> mItems;
+        std::unique_ptr<Collection> mMap;
+    };
+
+    /* Times n lookups, drawn from pLookups, in a HashMap of n keys drawn from pKeys, in one batched find or
+     * one find at a time. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class BatchFindFixture : public Fixture {
+    public:
+        BatchFindFixture(KeyDistribution<KeyType> pKeys, KeyDistribution<KeyType> pLookups, bool pBatched)
+                : mDistribution(pKeys), mLookupDistribution(pLookups), mBatched(pBatched), mFound(0) {}
+
+        void setUp(int n) override {
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+            mLookups = generateKeys(mLookupDistribution, n);
+            mValues.assign(mLookups.size(), nullptr);
+        }
+
+        void run(int) override {
+            const Collection& map = *mMap;
+            std::size_t found = 0;
+            if (mBatched) {
+                map.find(mLookups.begin(), mLookups.end(), mValues.begin());
+                for (auto&& value : mValues)
+                    found += value != nullptr;
+            } else {
+                for (auto&& key : mLookups)
+                    found += map.find(key) != map.end();
+            }
+            mFound = found;
+        }
+
+        void counters(int n, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["keys/s"] = pSeconds > 0 ? n / pSeconds : 0;
+        }
+
+        void tearDown() override {
+            mMap.reset();
+            mLookups.clear();
+            mValues.clear();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        KeyDistribution<KeyType> mLookupDistribution;
+        bool mBatched;
+        std::vector<KeyType> mLookups;
+        std::vector<const typename Collection::mapped_type*> mValues;
+        std::unique_ptr<Collection> mMap;
+        std::size_t mFound;
+    };
+
+    /* Times a full forward iteration over a collection of n keys drawn from pKeys. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class IterateFixture : public Fixture {
+    public:
+        explicit IterateFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys), mSum(0) {}
+
+        void setUp(int n) override {
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+        }
+
+        void run(int) override {
+            const Collection& map = *mMap;
+            std::size_t sum = 0;
+            for (auto it = map.begin(); it != map.end(); ++it)
+                sum += it->second;
+            mSum = sum;
+        }
+
+        void tearDown() override {
+            mMap.reset();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        std::unique_ptr<Collection> mMap;
+        std::size_t mSum;
+    };
+
+    /* Times copy construction of a collection of n keys drawn from pKeys. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class CopyFixture : public Fixture {
+    public:
+        explicit CopyFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys) {}
+
+        void setUp(int n) override {
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+        }
+
+        void run(int) override {
+            mCopy.reset(new Collection(*mMap));
+        }
+
+        void tearDown() override {
+            mCopy.reset();
+            mMap.reset();
+        }
+
+    protected:
+        KeyDistribution<KeyType> mDistribution;
+        std::unique_ptr<Collection> mMap;
+        std::unique_ptr<Collection> mCopy;
+    };
+
+    /* Times copy assignment of a collection of n keys onto an equally large one, which has to be destroyed. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class AssignFixture : public CopyFixture<Collection, KeyType> {
+    public:
+        using CopyFixture<Collection, KeyType>::CopyFixture;
+
+        void setUp(int n) override {
+            CopyFixture<Collection, KeyType>::setUp(n);
+            this->mCopy.reset(new Collection());
+            fill(*this->mCopy, generateKeys(this->mDistribution, n));
+        }
+
+        void run(int) override {
+            *this->mCopy = *this->mMap;
+        }
+    };
+
+    /* Times the comparison of a collection of n keys drawn from pKeys with an equal copy of it. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class CompareFixture : public CopyFixture<Collection, KeyType> {
+    public:
+        explicit CompareFixture(KeyDistribution<KeyType> pKeys) : CopyFixture<Collection, KeyType>(pKeys), mEqual(false) {}
+
+        void setUp(int n) override {
+            CopyFixture<Collection, KeyType>::setUp(n);
+            this->mCopy.reset(new Collection(*this->mMap));
+        }
+
+        void run(int) override {
+            mEqual = *this->mCopy == *this->mMap;
+        }
+
+    private:
+        bool mEqual;
+    };
+
+    /* Times pWrites writes of keys drawn from pKeys into a collection of n keys while a reader holds a
+     * snapshot of it, retaken every pInterval writes. A snapshot is a plain copy of the collection. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class SnapshotFixture : public Fixture {
+    public:
+        SnapshotFixture(KeyDistribution<KeyType> pKeys, int pWrites, int pInterval)
+                : mDistribution(pKeys), mWrites(pWrites), mInterval(pInterval) {}
+
+        void setUp(int n) override {
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+            mKeys = generateKeys(mDistribution, n, mWrites);
+            mSnapshot.reset(new Collection());
+        }
+
+        void run(int) override {
+            Collection& map = *mMap;
+            for (std::size_t i = 0; i < mKeys.size(); ++i) {
+                if (i % mInterval == 0)
+                    *mSnapshot = map;
+                map[mKeys[i]] = i;
+            }
+        }
+
+        double operations(int) override {
+            return mKeys.size();
+        }
+
+        void tearDown() override {
+            mSnapshot.reset();
+            mMap.reset();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        int mWrites;
+        std::size_t mInterval;
+        std::vector<KeyType> mKeys;
+        std::unique_ptr<Collection> mMap;
+        std::unique_ptr<Collection> mSnapshot;
+    };
+
+    /* Times save() of a collection of n keys drawn from pKeys into memory, reports the throughput. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class SaveFixture : public Fixture {
+    public:
+        explicit SaveFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys) {}
+
+        void setUp(int n) override {
+            mMap.reset(new Collection());
+            fill(*mMap, generateKeys(mDistribution, n));
+            mStream.str(std::string());
+        }
+
+        void run(int) override {
+            mMap->save(mStream);
+        }
+
+        void counters(int, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["MB/s"] = pSeconds > 0 ? mStream.str().size() / pSeconds / 1e6 : 0;
+        }
+
+        void tearDown() override {
+            mMap.reset();
+            mStream.str(std::string());
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        std::unique_ptr<Collection> mMap;
+        std::ostringstream mStream;
+    };
+
+    /* Times load() of a collection of n keys drawn from pKeys saved in memory, reports the throughput. */
+    template<class Collection, typename KeyType = typename Collection::key_type>
+    class LoadFixture : public Fixture {
+    public:
+        explicit LoadFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys) {}
+
+        void setUp(int n) override {
+            Collection map;
+            fill(map, generateKeys(mDistribution, n));
+            std::ostringstream out;
+            map.save(out);
+            mFile = out.str();
+        }
+
+        void run(int) override {
+            std::istringstream in(mFile);
+            mMap.reset(new Collection(Collection::load(in)));
+        }
+
+        void counters(int, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["MB/s"] = pSeconds > 0 ? mFile.size() / pSeconds / 1e6 : 0;
+        }
+
+        void tearDown() override {
+            mMap.reset();
+            mFile.clear();
+        }
+
+    private:
+        KeyDistribution<KeyType> mDistribution;
+        std::string mFile;
+        std::unique_ptr<Collection> mMap;
+    };
+
+    /* Writes the mapped map file for n keys drawn from pKeys, removes it on tearDown(). */
+    template<class Mapped, typename KeyType = typename Mapped::key_type>
+    class MappedFixture : public Fixture {
+    public:
+        explicit MappedFixture(KeyDistribution<KeyType> pKeys) : mDistribution(pKeys), mPath("aisdi-benchmark.map") {}
+
+        void setUp(int n) override {
+            std::vector<KeyType> keys = generateKeys(mDistribution, n);
+            std::vector<std::pair<KeyType, typename Mapped::mapped_type>> items;
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                items.emplace_back(keys[i], i);
+            Mapped::write(mPath, items.begin(), items.end());
+        }
+
+        void tearDown() override {
+            mMap.reset();
+            std::remove(mPath.c_str());
+        }
+
+    protected:
+        KeyDistribution<KeyType> mDistribution;
+        std::string mPath;
+        std::unique_ptr<Mapped> mMap;
+    };
+
+    /* Times opening a mapped map of n keys - compare with LoadFixture. */
+    template<class Mapped, typename KeyType = typename Mapped::key_type>
+    class MappedOpenFixture : public MappedFixture<Mapped, KeyType> {
+    public:
+        using MappedFixture<Mapped, KeyType>::MappedFixture;
+
+        void run(int) override {
+            this->mMap.reset(new Mapped(this->mPath));
+        }
+    };
+
+    /* Times lookups, drawn from pLookups, in a mapped map of n keys drawn from pKeys, see FindFixture. */
+    template<class Mapped, typename KeyType = typename Mapped::key_type>
+    class MappedFindFixture : public MappedFixture<Mapped, KeyType> {
+    public:
+        MappedFindFixture(KeyDistribution<KeyType> pKeys, KeyDistribution<KeyType> pLookups, int pLookupCount = -1)
+                : MappedFixture<Mapped, KeyType>(pKeys), mLookupDistribution(pLookups), mLookupCount(pLookupCount),
+                  mFound(0) {}
+
+        void setUp(int n) override {
+            MappedFixture<Mapped, KeyType>::setUp(n);
+            mLookups = generateKeys(mLookupDistribution, n, mLookupCount);
+            this->mMap.reset(new Mapped(this->mPath));
+        }
+
+        void run(int) override {
+            const Mapped& map = *this->mMap;
+            std::size_t found = 0;
+            for (auto&& key : mLookups)
+                found += map.find(key) != map.end();
+            mFound = found;
+        }
+
+        double operations(int) override {
+            return mLookups.size();
+        }
+
+    private:
+        KeyDistribution<KeyType> mLookupDistribution;
+        int mLookupCount;
+        std::vector<KeyType> mLookups;
+        std::size_t mFound;
+    };
+
+    /* Replays pLength accesses drawn from pKeys over pUniverse keys through a cache of capacity n,
+     * loading every missed key. Reports the hit ratio and throughput. */
+    template<class Cache>
+    class CacheFixture : public Fixture {
+    public:
+        CacheFixture(KeyDistribution<int> pKeys, int pUniverse, int pLength)
+                : mDistribution(pKeys), mUniverse(pUniverse), mLength(pLength) {}
+
+        void setUp(int n) override {
+            if (mTrace.empty()) {
+                KeyGenerator<int> next = mDistribution(mUniverse);
+                mTrace.reserve(mLength);
+                for (int i = 0; i < mLength; ++i)
+                    mTrace.push_back(next());
+            }
+            mCache.reset(new Cache(n));
+        }
+
+        void run(int) override {
+            Cache& cache = *mCache;
+            for (int key : mTrace)
+                if (cache.get(key) == nullptr)
+                    cache.put(key, key);
+        }
+
+        void counters(int, double pSeconds, std::map<std::string, double>& pCounters) override {
+            pCounters["hit ratio"] = mCache->stats().hitRatio();
+            pCounters["ops/s"] = pSeconds > 0 ? mTrace.size() / pSeconds : 0;
+        }
+
+        void tearDown() override {
+            mCache.reset();
+        }
+
+        double operations(int) override {
+            return mLength;
+        }
+
+    private:
+        KeyDistribution<int> mDistribution;
+        int mUniverse;
+        int mLength;
+        std::vector<int> mTrace;
+        std::unique_ptr<Cache> mCache;
+    };
+}
+
+#endif /* AISDI_MAPS_FIXTURES_H */
@@ -0,0 +1,401 @@
+#ifndef AISDI_MAPS_FLATMAP_H
+#define AISDI_MAPS_FLATMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi {
+
+    /* Ordered map over two sorted contiguous arrays, one of keys and one of values, with the TreeMap
+     * interface. Lookups are branchless binary searches touching only the keys; single inserts and removals
+     * shift the tail, so build large maps with a batched insert(first, last). freeze() makes the key set
+     * immutable and releases spare capacity - values can still be modified in place.
+     *
+     * Elements are not stored as pairs, so iterators yield std::pair<const key_type&, mapped_type&> proxies;
+     * it->first, it->second and structured access work as for the other maps. */
+    template<typename KeyType, typename ValueType>
+    class FlatMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using reference = std::pair<const key_type&, mapped_type&>;
+        using const_reference = std::pair<const key_type&, const mapped_type&>;
+
+        class ConstIterator;
+
+        class Iterator;
+
+        using iterator = Iterator;
+        using const_iterator = ConstIterator;
+
+        FlatMap() : mFrozen(false) {}
+
+        FlatMap(std::initializer_list<value_type> list) : FlatMap() {
+            insert(list.begin(), list.end());
+        }
+
+        template<typename InputIterator>
+        FlatMap(InputIterator first, InputIterator last) : FlatMap() {
+            insert(first, last);
+        }
+
+        FlatMap(const FlatMap& other) = default;
+
+        FlatMap(FlatMap&& other) : FlatMap() {
+            swap(other);
+        }
+
+        FlatMap& operator=(const FlatMap& other) = default;
+
+        FlatMap& operator=(FlatMap&& other) {
+            swap(other);
+            return *this;
+        }
+
+        bool isEmpty() const {
+            return mKeys.empty();
+        }
+
+        mapped_type& operator[](const key_type& key) {
+            size_type index = lowerBoundIndex(key);
+            if (index == mKeys.size() || key < mKeys[index]) {
+                checkMutable();
+                mKeys.insert(mKeys.begin() + index, key);
+                try {
+                    mValues.insert(mValues.begin() + index, mapped_type{});
+                } catch (...) {
+                    mKeys.erase(mKeys.begin() + index);
+                    throw;
+                }
+            }
+            return mValues[index];
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            size_type index = indexOf(key);
+            if (index == mKeys.size())
+                throw std::out_of_range("Key does not exists");
+            return mValues[index];
+        }
+
+        mapped_type& valueOf(const key_type& key) {
+            return const_cast<mapped_type&>(static_cast<const FlatMap*>(this)->valueOf(key));
+        }
+
+        const_iterator find(const key_type& key) const {
+            return ConstIterator(*this, indexOf(key));
+        }
+
+        iterator find(const key_type& key) {
+            return Iterator(*this, indexOf(key));
+        }
+
+        /* First element whose key is not less than key. */
+        const_iterator lowerBound(const key_type& key) const {
+            return ConstIterator(*this, lowerBoundIndex(key));
+        }
+
+        iterator lowerBound(const key_type& key) {
+            return Iterator(*this, lowerBoundIndex(key));
+        }
+
+        /* Sorts the batch and merges it in a single pass - O(m log m + n) instead of m shifts of the tail.
+         * Within the batch and against present keys the last assignment wins, as with operator[]. */
+        template<typename InputIterator>
+        void insert(InputIterator first, InputIterator last) {
+            std::vector<std::pair<key_type, mapped_type>> batch;
+            for (; first != last; ++first)
+                batch.emplace_back((*first).first, (*first).second);
+            if (batch.empty())
+                return;
+            checkMutable();
+
+            std::stable_sort(batch.begin(), batch.end(), [](const std::pair<key_type, mapped_type>& a,
+                                                             const std::pair<key_type, mapped_type>& b) {
+                return a.first < b.first;
+            });
+
+            std::vector<key_type> keys;
+            std::vector<mapped_type> values;
+            keys.reserve(mKeys.size() + batch.size());
+            values.reserve(mKeys.size() + batch.size());
+
+            size_type i = 0, j = 0;
+            while (i < mKeys.size() || j < batch.size()) {
+                if (j == batch.size() || (i < mKeys.size() && mKeys[i] < batch[j].first)) {
+                    keys.push_back(std::move(mKeys[i]));
+                    values.push_back(std::move(mValues[i]));
+                    ++i;
+                    continue;
+                }
+                if (i < mKeys.size() && !(batch[j].first < mKeys[i]))
+                    ++i;
+                while (j + 1 < batch.size() && !(batch[j].first < batch[j + 1].first))
+                    ++j;
+                keys.push_back(std::move(batch[j].first));
+                values.push_back(std::move(batch[j].second));
+                ++j;
+            }
+
+            mKeys.swap(keys);
+            mValues.swap(values);
+        }
+
+        void remove(const key_type& key) {
+            size_type index = indexOf(key);
+            if (index == mKeys.size())
+                throw std::out_of_range("Removing nonexisting element");
+            erase(index);
+        }
+
+        void remove(const const_iterator& it) {
+            if (it.mIndex >= mKeys.size())
+                throw std::out_of_range("Removing end iterator");
+            erase(it.mIndex);
+        }
+
+        /* After freezing, adding or removing keys throws std::logic_error. */
+        void freeze() {
+            mKeys.shrink_to_fit();
+            mValues.shrink_to_fit();
+            mFrozen = true;
+        }
+
+        bool isFrozen() const {
+            return mFrozen;
+        }
+
+        size_type getSize() const {
+            return mKeys.size();
+        }
+
+        bool operator==(const FlatMap& other) const {
+            return mKeys == other.mKeys && mValues == other.mValues;
+        }
+
+        bool operator!=(const FlatMap& other) const {
+            return !(*this == other);
+        }
+
+        iterator begin() {
+            return Iterator(*this, 0);
+        }
+
+        iterator end() {
+            return Iterator(*this, mKeys.size());
+        }
+
+        const_iterator cbegin() const {
+            return ConstIterator(*this, 0);
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(*this, mKeys.size());
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        static const size_type PrefetchThreshold = 256 * 1024;
+
+        std::vector<key_type> mKeys;
+        std::vector<mapped_type> mValues;
+        bool mFrozen;
+
+        void swap(FlatMap& other) {
+            mKeys.swap(other.mKeys);
+            mValues.swap(other.mValues);
+            std::swap(mFrozen, other.mFrozen);
+        }
+
+        void checkMutable() const {
+            if (mFrozen)
+                throw std::logic_error("FlatMap is frozen");
+        }
+
+        void erase(size_type pIndex) {
+            checkMutable();
+            mKeys.erase(mKeys.begin() + pIndex);
+            mValues.erase(mValues.begin() + pIndex);
+        }
+
+        /* The loop has a fixed trip count of log2(n) and its only data dependent step is arithmetic (a ternary
+         * here gets compiled to a branch mispredicted half of the time), so there is nothing to mispredict.
+         * Keys beyond the L2 cache get both possible next probes prefetched, which hides most of the memory
+         * latency; for smaller ones prefetching only costs. */
+        size_type lowerBoundIndex(const key_type& pKey) const {
+            if (mKeys.empty())
+                return 0;
+            const key_type* base = mKeys.size() * sizeof(key_type) > PrefetchThreshold
+                                   ? descend<true>(mKeys.data(), mKeys.size(), pKey)
+                                   : descend<false>(mKeys.data(), mKeys.size(), pKey);
+            return (base - mKeys.data()) + (*base < pKey);
+        }
+
+        template<bool Prefetch>
+        static const key_type* descend(const key_type* pBase, size_type pLength, const key_type& pKey) {
+            while (pLength > 1) {
+                size_type half = pLength / 2;
+                if (Prefetch) {
+                    __builtin_prefetch(pBase + half / 2 - 1);
+                    __builtin_prefetch(pBase + half + half / 2 - 1);
+                }
+                pBase += static_cast<size_type>(pBase[half - 1] < pKey) * half;
+                pLength -= half;
+            }
+            return pBase;
+        }
+
+        /* Index of pKey or getSize() if it is missing. */
+        size_type indexOf(const key_type& pKey) const {
+            size_type size = mKeys.size();
+            if (size == 0)
+                return 0;
+            size_type index = lowerBoundIndex(pKey);
+            /* Hits and misses are equally likely in many workloads, keep this branch free as well. */
+            size_type probe = index < size ? index : size - 1;
+            bool missing = (index == size) | (pKey < mKeys[probe]);
+            return index + static_cast<size_type>(missing) * (size - index);
+        }
+    };
+
+    template<typename KeyType, typename ValueType>
+    class FlatMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename FlatMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename FlatMap::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        /* operator-> has to return something with an operator->, the proxy pair is kept by value. */
+        template<typename Reference>
+        class Arrow {
+        public:
+            explicit Arrow(Reference pReference) : mReference(pReference) {}
+
+            const Reference* operator->() const {
+                return &mReference;
+            }
+
+        private:
+            Reference mReference;
+        };
+
+        using pointer = Arrow<reference>;
+
+        friend class FlatMap;
+
+        explicit ConstIterator(const FlatMap& pMap, size_type pIndex) : mMap(&pMap), mIndex(pIndex) {}
+
+        ConstIterator(const ConstIterator& other) = default;
+
+        ConstIterator& operator=(const ConstIterator& other) = default;
+
+        ConstIterator& operator++() {
+            if (mIndex >= mMap->mKeys.size())
+                throw std::out_of_range("Incrementing end iterator");
+            ++mIndex;
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            if (mIndex == 0)
+                throw std::out_of_range("Decrementing begin iterator");
+            --mIndex;
+            return *this;
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mIndex >= mMap->mKeys.size())
+                throw std::out_of_range("Dereferencing end iterator");
+            return reference(mMap->mKeys[mIndex], mMap->mValues[mIndex]);
+        }
+
+        pointer operator->() const {
+            return pointer(operator*());
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return mMap == other.mMap && mIndex == other.mIndex;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    protected:
+        const FlatMap* mMap;
+        size_type mIndex;
+    };
+
+    template<typename KeyType, typename ValueType>
+    class FlatMap<KeyType, ValueType>::Iterator : public FlatMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename FlatMap::reference;
+        using pointer = typename ConstIterator::template Arrow<reference>;
+
+        explicit Iterator(const FlatMap& pMap, size_type pIndex) : ConstIterator(pMap, pIndex) {}
+
+        Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+        Iterator& operator++() {
+            ConstIterator::operator++();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto result = *this;
+            ConstIterator::operator++();
+            return result;
+        }
+
+        Iterator& operator--() {
+            ConstIterator::operator--();
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto result = *this;
+            ConstIterator::operator--();
+            return result;
+        }
+
+        reference operator*() const {
+            ConstIterator::operator*();
+            FlatMap& map = const_cast<FlatMap&>(*this->mMap);
+            return reference(map.mKeys[this->mIndex], map.mValues[this->mIndex]);
+        }
+
+        pointer operator->() const {
+            return pointer(operator*());
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_FLATMAP_H */
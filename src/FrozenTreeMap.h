@@ -0,0 +1,230 @@
+#ifndef AISDI_MAPS_FROZENTREEMAP_H
+#define AISDI_MAPS_FROZENTREEMAP_H
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace aisdi {
+
+    /* Immutable snapshot of an ordered map, see TreeMap::freeze(). Keys are laid out in Eytzinger (BFS)
+     * order in one array: the children of slot k are 2k and 2k + 1 and slot 0 is unused. A lookup walks
+     * down without branching on the comparison and, since the 16 descendants four levels below k are
+     * contiguous, prefetches them while descending - pointer-free, and most of the memory latency of
+     * maps larger than the caches is overlapped. Values are kept in a parallel array.
+     *
+     * Iteration visits keys in order by walking the implicit tree, amortized O(1) per step. Like with
+     * FlatMap, iterators yield std::pair<const key_type&, const mapped_type&> proxies. */
+    template<typename KeyType, typename ValueType>
+    class FrozenTreeMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using const_reference = std::pair<const key_type&, const mapped_type&>;
+        using reference = const_reference;
+
+        class ConstIterator;
+
+        using iterator = ConstIterator;
+        using const_iterator = ConstIterator;
+
+        FrozenTreeMap() : mCount(0) {}
+
+        /* Takes pCount elements with strictly increasing keys, O(n). */
+        template<typename InputIterator>
+        FrozenTreeMap(InputIterator pFirst, size_type pCount) : mKeys(pCount + 1), mValues(pCount + 1),
+                                                                 mCount(pCount) {
+            for (size_type slot = first(); slot != 0; slot = next(slot), ++pFirst) {
+                mKeys[slot] = (*pFirst).first;
+                mValues[slot] = (*pFirst).second;
+            }
+        }
+
+        bool isEmpty() const {
+            return mCount == 0;
+        }
+
+        size_type getSize() const {
+            return mCount;
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            size_type slot = slotOf(key);
+            if (slot == 0)
+                throw std::out_of_range("Key does not exists");
+            return mValues[slot];
+        }
+
+        const_iterator find(const key_type& key) const {
+            return ConstIterator(*this, slotOf(key));
+        }
+
+        /* First element whose key is not less than key. */
+        const_iterator lowerBound(const key_type& key) const {
+            return ConstIterator(*this, lowerBoundSlot(key));
+        }
+
+        const_iterator cbegin() const {
+            return ConstIterator(*this, first());
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(*this, 0);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        std::vector<key_type> mKeys;
+        std::vector<mapped_type> mValues;
+        size_type mCount;
+
+        /* Slot of the smallest key, 0 if empty. */
+        size_type first() const {
+            size_type slot = mCount > 0 ? 1 : 0;
+            while (slot != 0 && 2 * slot <= mCount)
+                slot = 2 * slot;
+            return slot;
+        }
+
+        size_type last() const {
+            size_type slot = mCount > 0 ? 1 : 0;
+            while (slot != 0 && 2 * slot + 1 <= mCount)
+                slot = 2 * slot + 1;
+            return slot;
+        }
+
+        /* In-order successor: leftmost slot of the right subtree, or the first ancestor we are left of. */
+        size_type next(size_type pSlot) const {
+            if (2 * pSlot + 1 <= mCount) {
+                pSlot = 2 * pSlot + 1;
+                while (2 * pSlot <= mCount)
+                    pSlot = 2 * pSlot;
+                return pSlot;
+            }
+            while (pSlot & 1)
+                pSlot >>= 1;
+            return pSlot >> 1;
+        }
+
+        size_type previous(size_type pSlot) const {
+            if (2 * pSlot <= mCount) {
+                pSlot = 2 * pSlot;
+                while (2 * pSlot + 1 <= mCount)
+                    pSlot = 2 * pSlot + 1;
+                return pSlot;
+            }
+            while (pSlot != 0 && !(pSlot & 1))
+                pSlot >>= 1;
+            return pSlot >> 1;
+        }
+
+        /* Descends to a leaf, remembering turns in the bits of the slot. The answer is the last node where
+         * we went left: strip the trailing right turns (ones) and the left turn itself. 0 means end. */
+        size_type lowerBoundSlot(const key_type& pKey) const {
+            static const size_type Prefetch = 64 / sizeof(key_type) > 0 ? 64 / sizeof(key_type) : 1;
+            const key_type* keys = mKeys.data();
+            size_type slot = 1;
+            while (slot <= mCount) {
+                __builtin_prefetch(keys + (Prefetch * slot < mCount ? Prefetch * slot : 0));
+                slot = 2 * slot + static_cast<size_type>(keys[slot] < pKey);
+            }
+            slot >>= __builtin_ffsll(static_cast<long long>(~slot));
+            return slot;
+        }
+
+        size_type slotOf(const key_type& pKey) const {
+            size_type slot = lowerBoundSlot(pKey);
+            if (slot == 0 || pKey < mKeys[slot])
+                return 0;
+            return slot;
+        }
+    };
+
+    template<typename KeyType, typename ValueType>
+    class FrozenTreeMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename FrozenTreeMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename FrozenTreeMap::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        class Arrow {
+        public:
+            explicit Arrow(reference pReference) : mReference(pReference) {}
+
+            const reference* operator->() const {
+                return &mReference;
+            }
+
+        private:
+            reference mReference;
+        };
+
+        using pointer = Arrow;
+
+        explicit ConstIterator(const FrozenTreeMap& pMap, size_type pSlot) : mMap(&pMap), mSlot(pSlot) {}
+
+        ConstIterator& operator++() {
+            if (mSlot == 0)
+                throw std::out_of_range("Incrementing end iterator");
+            mSlot = mMap->next(mSlot);
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            size_type slot = mSlot == 0 ? mMap->last() : mMap->previous(mSlot);
+            if (slot == 0)
+                throw std::out_of_range("Decrementing begin iterator");
+            mSlot = slot;
+            return *this;
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mSlot == 0)
+                throw std::out_of_range("Dereferencing end iterator");
+            return reference(mMap->mKeys[mSlot], mMap->mValues[mSlot]);
+        }
+
+        pointer operator->() const {
+            return pointer(operator*());
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return mMap == other.mMap && mSlot == other.mSlot;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const FrozenTreeMap* mMap;
+        size_type mSlot;
+    };
+
+}
+
+#endif /* AISDI_MAPS_FROZENTREEMAP_H */
@@ -0,0 +1,610 @@
+#ifndef AISDI_MAPS_HAMTMAP_H
+#define AISDI_MAPS_HAMTMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Hashing.h"
+#include "IntrusivePtr.h"
+
+namespace aisdi {
+
+    /* Unordered map over a persistent hash array mapped trie. Every level consumes five bits of the key's
+     * mixed 64-bit hash, highest first, and has up to 32 slots compressed by two bitmaps: one marks keys
+     * stored in the node, the other subtrees (the CHAMP layout). A slot's index is the popcount of the bits
+     * below it, so nodes hold only the slots they use. Keys with equal hashes share a collision node below
+     * the last level.
+     *
+     * Copies share the trie, so copying - taking a snapshot - is O(1). An update copies the nodes on the path
+     * to its key that are shared with another version, at most 14 of them. Nodes referenced by one version
+     * only are updated in place, which gives a map without live snapshots the in-place speed other
+     * persistent maps need a separate transient mode for. Removal moves lone keys back up to their parents,
+     * so the trie of a set of keys does not depend on the order of updates and versions compare subtree by
+     * subtree, skipping shared ones.
+     *
+     * References and iterators are invalidated by modifications of the version they came from. Writing
+     * through an iterator copies the path to its item first. */
+    template<typename KeyType, typename ValueType>
+    class HamtMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using reference = value_type&;
+        using const_reference = const value_type&;
+
+        class ConstIterator;
+
+        class Iterator;
+
+        using iterator = Iterator;
+        using const_iterator = ConstIterator;
+
+        HamtMap() : mCount(0) {}
+
+        HamtMap(std::initializer_list<value_type> list) : HamtMap() {
+            insert(list.begin(), list.end());
+        }
+
+        HamtMap(const HamtMap& other) = default;
+
+        HamtMap(HamtMap&& other) : HamtMap() {
+            *this = std::move(other);
+        }
+
+        HamtMap& operator=(const HamtMap& other) = default;
+
+        HamtMap& operator=(HamtMap&& other) {
+            if (this == &other)
+                return *this;
+            mRoot = std::move(other.mRoot);
+            mCount = other.mCount;
+            other.mCount = 0;
+            return *this;
+        }
+
+        /* Same as copying, spelled out for readers. */
+        HamtMap snapshot() const {
+            return *this;
+        }
+
+        /* Assigns every item, later ones win. An empty map is built bottom-up instead: items are sorted by
+         * hash and every node is allocated once, at its final size. */
+        template<typename InputIt>
+        void insert(InputIt first, InputIt last) {
+            if (!isEmpty()) {
+                for (; first != last; ++first)
+                    (*this)[first->first] = first->second;
+                return;
+            }
+            std::vector<std::pair<key_type, mapped_type>> items(first, last);
+            std::vector<std::pair<std::uint64_t, size_type>> order;
+            order.reserve(items.size());
+            for (size_type i = 0; i < items.size(); ++i)
+                order.emplace_back(hashOf(items[i].first), i);
+            std::sort(order.begin(), order.end());
+            /* Of repeated keys, which sort next to each other, keep the last one. */
+            std::vector<const std::pair<key_type, mapped_type>*> sorted;
+            sorted.reserve(order.size());
+            for (auto it = order.begin(); it != order.end(); ++it) {
+                bool repeated = false;
+                for (auto next = it + 1; next != order.end() && next->first == it->first && !repeated; ++next)
+                    repeated = items[next->second].first == items[it->second].first;
+                if (!repeated)
+                    sorted.push_back(&items[it->second]);
+            }
+            std::vector<std::uint64_t> hashes;
+            hashes.reserve(sorted.size());
+            for (auto item : sorted)
+                hashes.push_back(hashOf(item->first));
+            mRoot = build(sorted.data(), hashes.data(), sorted.size(), 0);
+            mCount = sorted.size();
+        }
+
+        bool isEmpty() const {
+            return mCount == 0;
+        }
+
+        mapped_type& operator[](const key_type& key) {
+            if (mRoot.get() == nullptr)
+                mRoot = NodePtr(new Node());
+            return assign(mRoot, hashOf(key), key, 0);
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            const value_type* entry = findEntry(key);
+            if (entry == nullptr)
+                throw std::out_of_range("Not found");
+            return entry->second;
+        }
+
+        /* Copies the path to the key if it is shared, like operator[]. */
+        mapped_type& valueOf(const key_type& key) {
+            if (findEntry(key) == nullptr)
+                throw std::out_of_range("Not found");
+            return (*this)[key];
+        }
+
+        const_iterator find(const key_type& key) const {
+            ConstIterator it(*this);
+            std::uint64_t hash = hashOf(key);
+            const Node* node = mRoot.get();
+            for (unsigned shift = 0; node != nullptr; shift += Bits) {
+                if (shift >= HashBits) {
+                    for (size_type i = 0; i < node->mEntries.size(); ++i)
+                        if (node->mEntries[i].first == key) {
+                            it.mFrames.push_back(Frame{node, i});
+                            return it;
+                        }
+                    break;
+                }
+                std::uint32_t bit = bitOf(hash, shift);
+                if (node->mDataMap & bit) {
+                    size_type position = index(node->mDataMap, bit);
+                    if (node->mEntries[position].first != key)
+                        break;
+                    it.mFrames.push_back(Frame{node, position});
+                    return it;
+                }
+                if (!(node->mNodeMap & bit))
+                    break;
+                size_type child = index(node->mNodeMap, bit);
+                it.mFrames.push_back(Frame{node, node->mEntries.size() + child});
+                node = node->mChildren[child].get();
+            }
+            return end();
+        }
+
+        iterator find(const key_type& key) {
+            return static_cast<const HamtMap*>(this)->find(key);
+        }
+
+        void remove(const key_type& key) {
+            if (findEntry(key) == nullptr)
+                throw std::out_of_range("Key not found");
+            erase(mRoot, hashOf(key), key, 0);
+            --mCount;
+        }
+
+        void remove(const const_iterator& it) {
+            if (it.mFrames.empty())
+                throw std::out_of_range("Erasing end");
+            key_type key = (*it).first;
+            remove(key);
+        }
+
+        size_type getSize() const {
+            return mCount;
+        }
+
+        bool operator==(const HamtMap& other) const {
+            if (mCount != other.mCount)
+                return false;
+            return mCount == 0 || equal(mRoot.get(), other.mRoot.get(), 0);
+        }
+
+        bool operator!=(const HamtMap& other) const {
+            return !(*this == other);
+        }
+
+        iterator begin() {
+            return cbegin();
+        }
+
+        iterator end() {
+            return cend();
+        }
+
+        const_iterator cbegin() const {
+            ConstIterator it(*this);
+            if (mRoot.get() != nullptr) {
+                it.mFrames.push_back(Frame{mRoot.get(), 0});
+                it.settle();
+            }
+            return it;
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(*this);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        struct Node;
+
+        using NodePtr = IntrusivePtr<Node>;
+
+        /* Keys first, subtrees after them, both in the order of their bits. */
+        struct Node {
+            std::uint32_t mDataMap;
+            std::uint32_t mNodeMap;
+            std::vector<value_type> mEntries;
+            std::vector<NodePtr> mChildren;
+            std::atomic<size_type> mReferences;
+
+            Node() : mDataMap(0), mNodeMap(0), mReferences(1) {}
+
+            /* Copy for path copying: shares all subtrees. */
+            Node(const Node& other) : mDataMap(other.mDataMap), mNodeMap(other.mNodeMap), mEntries(other.mEntries),
+                                      mChildren(other.mChildren), mReferences(1) {}
+        };
+
+        /* Position within a node on the way to an iterator's item, at a subtree for all but the last one. */
+        struct Frame {
+            const Node* mNode;
+            size_type mPosition;
+        };
+
+        static const unsigned Bits = 5;
+        static const unsigned HashBits = 64;
+
+        NodePtr mRoot;
+        size_type mCount;
+
+        static std::uint64_t hashOf(const key_type& pKey) {
+            return seededHash(pKey, 0);
+        }
+
+        /* Slot of the hash at the level starting pShift bits from the top; the last level has 4 bits. */
+        static std::uint32_t bitOf(std::uint64_t pHash, unsigned pShift) {
+            return std::uint32_t(1) << ((pHash << pShift) >> (HashBits - Bits));
+        }
+
+        static size_type index(std::uint32_t pBitmap, std::uint32_t pBit) {
+            return __builtin_popcount(pBitmap & (pBit - 1));
+        }
+
+        static Node* unshare(NodePtr& pSlot) {
+            if (!pSlot.unique())
+                pSlot = NodePtr(new Node(*pSlot.get()));
+            return pSlot.get();
+        }
+
+        /* value_type has a const key, so vectors of it cannot shift elements by assignment. */
+        static void insertAt(std::vector<value_type>& pEntries, size_type pPosition, value_type&& pEntry) {
+            if (pPosition == pEntries.size()) {
+                pEntries.push_back(std::move(pEntry));
+                return;
+            }
+            std::vector<value_type> entries;
+            entries.reserve(pEntries.size() + 1);
+            for (size_type i = 0; i < pPosition; ++i)
+                entries.push_back(std::move(pEntries[i]));
+            entries.push_back(std::move(pEntry));
+            for (size_type i = pPosition; i < pEntries.size(); ++i)
+                entries.push_back(std::move(pEntries[i]));
+            pEntries.swap(entries);
+        }
+
+        static void removeAt(std::vector<value_type>& pEntries, size_type pPosition) {
+            if (pPosition + 1 == pEntries.size()) {
+                pEntries.pop_back();
+                return;
+            }
+            std::vector<value_type> entries;
+            entries.reserve(pEntries.size() - 1);
+            for (size_type i = 0; i < pEntries.size(); ++i)
+                if (i != pPosition)
+                    entries.push_back(std::move(pEntries[i]));
+            pEntries.swap(entries);
+        }
+
+        const value_type* findEntry(const key_type& pKey) const {
+            std::uint64_t hash = hashOf(pKey);
+            const Node* node = mRoot.get();
+            for (unsigned shift = 0; node != nullptr; shift += Bits) {
+                if (shift >= HashBits) {
+                    for (auto&& entry : node->mEntries)
+                        if (entry.first == pKey)
+                            return &entry;
+                    return nullptr;
+                }
+                std::uint32_t bit = bitOf(hash, shift);
+                if (node->mDataMap & bit) {
+                    const value_type& entry = node->mEntries[index(node->mDataMap, bit)];
+                    return entry.first == pKey ? &entry : nullptr;
+                }
+                if (!(node->mNodeMap & bit))
+                    return nullptr;
+                node = node->mChildren[index(node->mNodeMap, bit)].get();
+            }
+            return nullptr;
+        }
+
+        mapped_type& assign(NodePtr& pSlot, std::uint64_t pHash, const key_type& pKey, unsigned pShift) {
+            Node* node = unshare(pSlot);
+            if (pShift >= HashBits) {
+                for (auto&& entry : node->mEntries)
+                    if (entry.first == pKey)
+                        return entry.second;
+                node->mEntries.emplace_back(pKey, mapped_type{});
+                ++mCount;
+                return node->mEntries.back().second;
+            }
+            std::uint32_t bit = bitOf(pHash, pShift);
+            if (node->mNodeMap & bit)
+                return assign(node->mChildren[index(node->mNodeMap, bit)], pHash, pKey, pShift + Bits);
+            size_type position = index(node->mDataMap, bit);
+            if (!(node->mDataMap & bit)) {
+                insertAt(node->mEntries, position, value_type(pKey, mapped_type{}));
+                node->mDataMap |= bit;
+                ++mCount;
+                return node->mEntries[position].second;
+            }
+            if (node->mEntries[position].first == pKey)
+                return node->mEntries[position].second;
+            /* Two keys for one slot: the one already there moves down to a new subtree, which the new key
+             * follows - as deep as their hashes agree. */
+            NodePtr child(new Node());
+            std::uint64_t hash = hashOf(node->mEntries[position].first);
+            if (pShift + Bits < HashBits)
+                child->mDataMap = bitOf(hash, pShift + Bits);
+            child->mEntries.push_back(std::move(node->mEntries[position]));
+            removeAt(node->mEntries, position);
+            node->mDataMap &= ~bit;
+            size_type slot = index(node->mNodeMap, bit);
+            node->mChildren.insert(node->mChildren.begin() + slot, std::move(child));
+            node->mNodeMap |= bit;
+            return assign(node->mChildren[slot], pHash, pKey, pShift + Bits);
+        }
+
+        /* The key is known to be present. */
+        static void erase(NodePtr& pSlot, std::uint64_t pHash, const key_type& pKey, unsigned pShift) {
+            Node* node = unshare(pSlot);
+            if (pShift >= HashBits) {
+                for (size_type i = 0; i < node->mEntries.size(); ++i)
+                    if (node->mEntries[i].first == pKey) {
+                        removeAt(node->mEntries, i);
+                        return;
+                    }
+                return;
+            }
+            std::uint32_t bit = bitOf(pHash, pShift);
+            if (node->mDataMap & bit) {
+                removeAt(node->mEntries, index(node->mDataMap, bit));
+                node->mDataMap &= ~bit;
+                return;
+            }
+            size_type slot = index(node->mNodeMap, bit);
+            NodePtr& child = node->mChildren[slot];
+            erase(child, pHash, pKey, pShift + Bits);
+            if (child->mChildren.empty() && child->mEntries.size() == 1) {
+                /* A lone key takes the place of its subtree. */
+                value_type entry(std::move(child->mEntries.front()));
+                node->mChildren.erase(node->mChildren.begin() + slot);
+                node->mNodeMap &= ~bit;
+                insertAt(node->mEntries, index(node->mDataMap, bit), std::move(entry));
+                node->mDataMap |= bit;
+            }
+        }
+
+        /* Node for pCount distinct items sorted by their hashes, which agree on the pShift bits above it. */
+        static NodePtr build(const std::pair<key_type, mapped_type>* const* pItems, const std::uint64_t* pHashes,
+                             size_type pCount, unsigned pShift) {
+            NodePtr node(new Node());
+            if (pShift >= HashBits) {
+                for (size_type i = 0; i < pCount; ++i)
+                    node->mEntries.emplace_back(pItems[i]->first, pItems[i]->second);
+                return node;
+            }
+            for (size_type begin = 0, end; begin < pCount; begin = end) {
+                std::uint32_t bit = bitOf(pHashes[begin], pShift);
+                for (end = begin + 1; end < pCount && bitOf(pHashes[end], pShift) == bit; ++end);
+                if (end - begin == 1) {
+                    node->mEntries.emplace_back(pItems[begin]->first, pItems[begin]->second);
+                    node->mDataMap |= bit;
+                } else {
+                    node->mChildren.push_back(build(pItems + begin, pHashes + begin, end - begin, pShift + Bits));
+                    node->mNodeMap |= bit;
+                }
+            }
+            return node;
+        }
+
+        /* Tries have a canonical shape, so equal maps have equal bitmaps everywhere - except for the order of
+         * keys in collision nodes. */
+        static bool equal(const Node* pNode, const Node* pOther, unsigned pShift) {
+            if (pNode == pOther)
+                return true;
+            if (pNode->mEntries.size() != pOther->mEntries.size())
+                return false;
+            if (pShift >= HashBits) {
+                for (auto&& entry : pNode->mEntries) {
+                    auto other = std::find_if(pOther->mEntries.begin(), pOther->mEntries.end(),
+                                              [&entry](const value_type& pEntry) { return pEntry.first == entry.first; });
+                    if (other == pOther->mEntries.end() || other->second != entry.second)
+                        return false;
+                }
+                return true;
+            }
+            if (pNode->mDataMap != pOther->mDataMap || pNode->mNodeMap != pOther->mNodeMap)
+                return false;
+            for (size_type i = 0; i < pNode->mEntries.size(); ++i)
+                if (pNode->mEntries[i].first != pOther->mEntries[i].first ||
+                    pNode->mEntries[i].second != pOther->mEntries[i].second)
+                    return false;
+            for (size_type i = 0; i < pNode->mChildren.size(); ++i)
+                if (!equal(pNode->mChildren[i].get(), pOther->mChildren[i].get(), pShift + Bits))
+                    return false;
+            return true;
+        }
+
+        /* Copies the shared nodes on an iterator's path and points the iterator at the copies. */
+        value_type& own(std::vector<Frame>& pFrames) {
+            NodePtr* slot = &mRoot;
+            Node* node = nullptr;
+            for (size_type i = 0; i < pFrames.size(); ++i) {
+                node = unshare(*slot);
+                pFrames[i].mNode = node;
+                if (i + 1 < pFrames.size())
+                    slot = &node->mChildren[pFrames[i].mPosition - node->mEntries.size()];
+            }
+            return node->mEntries[pFrames.back().mPosition];
+        }
+    };
+
+    /* Depth-first: the keys of a node, then its subtrees. The iterator keeps its path from the root; empty
+     * means end. */
+    template<typename KeyType, typename ValueType>
+    class HamtMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename HamtMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename HamtMap::value_type;
+        using pointer = const typename HamtMap::value_type*;
+        using difference_type = std::ptrdiff_t;
+
+        friend class HamtMap;
+
+        ConstIterator& operator++() {
+            if (mFrames.empty())
+                throw std::out_of_range("Incrementing end iterator");
+            ++mFrames.back().mPosition;
+            settle();
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            std::vector<Frame> frames(mFrames);
+            if (frames.empty() && mMap->mRoot.get() != nullptr)
+                frames.push_back(Frame{mMap->mRoot.get(), slots(mMap->mRoot.get())});
+            while (!frames.empty()) {
+                Frame& frame = frames.back();
+                if (frame.mPosition == 0) {
+                    frames.pop_back();
+                    continue;
+                }
+                const Node* node = frame.mNode;
+                if (--frame.mPosition < node->mEntries.size()) {
+                    mFrames.swap(frames);
+                    return *this;
+                }
+                const Node* child = node->mChildren[frame.mPosition - node->mEntries.size()].get();
+                frames.push_back(Frame{child, slots(child)});
+            }
+            throw std::out_of_range("Decrementing begin iterator");
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mFrames.empty())
+                throw std::out_of_range("Dereferencing end iterator");
+            return mFrames.back().mNode->mEntries[mFrames.back().mPosition];
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            if (mMap != other.mMap || mFrames.size() != other.mFrames.size())
+                return false;
+            return std::equal(mFrames.begin(), mFrames.end(), other.mFrames.begin(),
+                              [](const Frame& pFrame, const Frame& pOther) {
+                                  return pFrame.mNode == pOther.mNode && pFrame.mPosition == pOther.mPosition;
+                              });
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    protected:
+        const HamtMap* mMap;
+        /* Writing through an Iterator re-points it at copied nodes. */
+        mutable std::vector<Frame> mFrames;
+
+        explicit ConstIterator(const HamtMap& pMap) : mMap(&pMap) {}
+
+        static size_type slots(const Node* pNode) {
+            return pNode->mEntries.size() + pNode->mChildren.size();
+        }
+
+        /* Moves to the first key at or after the current position. */
+        void settle() {
+            while (!mFrames.empty()) {
+                const Node* node = mFrames.back().mNode;
+                size_type position = mFrames.back().mPosition;
+                if (position < node->mEntries.size())
+                    return;
+                if (position < slots(node)) {
+                    mFrames.push_back(Frame{node->mChildren[position - node->mEntries.size()].get(), 0});
+                    continue;
+                }
+                mFrames.pop_back();
+                if (!mFrames.empty())
+                    ++mFrames.back().mPosition;
+            }
+        }
+    };
+
+    template<typename KeyType, typename ValueType>
+    class HamtMap<KeyType, ValueType>::Iterator : public HamtMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename HamtMap::reference;
+        using pointer = typename HamtMap::value_type*;
+
+        Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+        Iterator& operator++() {
+            ConstIterator::operator++();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto result = *this;
+            ConstIterator::operator++();
+            return result;
+        }
+
+        Iterator& operator--() {
+            ConstIterator::operator--();
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto result = *this;
+            ConstIterator::operator--();
+            return result;
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        reference operator*() const {
+            if (this->mFrames.empty())
+                throw std::out_of_range("Dereferencing end iterator");
+            return const_cast<HamtMap*>(this->mMap)->own(this->mFrames);
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_HAMTMAP_H */
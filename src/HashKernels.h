@@ -0,0 +1,233 @@
+#ifndef AISDI_MAPS_HASHKERNELS_H
+#define AISDI_MAPS_HASHKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "Hashing.h"
+
+namespace aisdi {
+
+    /* Instruction sets the batch hashing kernels can use, in increasing order of width. */
+    enum class SimdLevel {
+        Scalar, Avx2, Avx512
+    };
+
+    /* Widest level this CPU supports, detected once. */
+    inline SimdLevel detectSimdLevel() {
+#if defined(__x86_64__)
+        static const SimdLevel level = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f"))
+                return SimdLevel::Avx512;
+            if (__builtin_cpu_supports("avx2"))
+                return SimdLevel::Avx2;
+            return SimdLevel::Scalar;
+        }();
+        return level;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    inline bool isSupported(SimdLevel pLevel) {
+        return pLevel <= detectSimdLevel();
+    }
+
+#if defined(__x86_64__)
+
+    /* SipHash-1-3 of 4 and 8 byte words, one per 64-bit lane, compiled for AVX2 and AVX-512 regardless of the
+     * build flags and only called after detectSimdLevel() said so. Two vectors are hashed at once so that
+     * the dependency chains of the rounds overlap - 8 keys per iteration with AVX2, 16 with AVX-512. */
+    __attribute__((target("avx2")))
+    inline __m256i rotateLeft256(__m256i pValue, int pBits) {
+        return _mm256_or_si256(_mm256_slli_epi64(pValue, pBits), _mm256_srli_epi64(pValue, 64 - pBits));
+    }
+
+    __attribute__((target("avx2")))
+    inline void sipRound256(__m256i* v) {
+        v[0] = _mm256_add_epi64(v[0], v[1]);
+        v[1] = _mm256_xor_si256(rotateLeft256(v[1], 13), v[0]);
+        v[0] = rotateLeft256(v[0], 32);
+        v[2] = _mm256_add_epi64(v[2], v[3]);
+        v[3] = _mm256_xor_si256(rotateLeft256(v[3], 16), v[2]);
+        v[0] = _mm256_add_epi64(v[0], v[3]);
+        v[3] = _mm256_xor_si256(rotateLeft256(v[3], 21), v[0]);
+        v[2] = _mm256_add_epi64(v[2], v[1]);
+        v[1] = _mm256_xor_si256(rotateLeft256(v[1], 17), v[2]);
+        v[2] = rotateLeft256(v[2], 32);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i loadWords256(const void* pWords, std::size_t pBytes) {
+        if (pBytes == 8)
+            return _mm256_loadu_si256(static_cast<const __m256i*>(pWords));
+        return _mm256_cvtepu32_epi64(_mm_loadu_si128(static_cast<const __m128i*>(pWords)));
+    }
+
+    /* Hashes the longest prefix of pCount pBytes-wide words that fills whole iterations, returns its length. */
+    __attribute__((target("avx2")))
+    inline std::size_t sipHashAvx2(const void* pWords, std::size_t pCount, std::size_t pBytes,
+                                   std::uint64_t pKey0, std::uint64_t pKey1, std::uint64_t* pOut) {
+        const unsigned char* words = static_cast<const unsigned char*>(pWords);
+        const __m256i length = _mm256_set1_epi64x(static_cast<long long>(static_cast<std::uint64_t>(pBytes) << 56));
+        const __m256i init[4] = {
+                _mm256_set1_epi64x(static_cast<long long>(0x736f6d6570736575ULL ^ pKey0)),
+                _mm256_set1_epi64x(static_cast<long long>(0x646f72616e646f6dULL ^ pKey1)),
+                _mm256_set1_epi64x(static_cast<long long>(0x6c7967656e657261ULL ^ pKey0)),
+                _mm256_set1_epi64x(static_cast<long long>(0x7465646279746573ULL ^ pKey1))
+        };
+        const __m256i finalization = _mm256_set1_epi64x(0xff);
+
+        std::size_t i = 0;
+        for (; i + 8 <= pCount; i += 8) {
+            __m256i v[2][4];
+            __m256i word[2];
+            for (int j = 0; j < 2; ++j) {
+                for (int k = 0; k < 4; ++k)
+                    v[j][k] = init[k];
+                word[j] = loadWords256(words + (i + 4 * j) * pBytes, pBytes);
+                if (pBytes == 8) {
+                    v[j][3] = _mm256_xor_si256(v[j][3], word[j]);
+                    sipRound256(v[j]);
+                    v[j][0] = _mm256_xor_si256(v[j][0], word[j]);
+                    word[j] = length;
+                } else {
+                    word[j] = _mm256_or_si256(word[j], length);
+                }
+            }
+            for (int j = 0; j < 2; ++j) {
+                v[j][3] = _mm256_xor_si256(v[j][3], word[j]);
+                sipRound256(v[j]);
+                v[j][0] = _mm256_xor_si256(v[j][0], word[j]);
+                v[j][2] = _mm256_xor_si256(v[j][2], finalization);
+                sipRound256(v[j]);
+                sipRound256(v[j]);
+                sipRound256(v[j]);
+                __m256i hash = _mm256_xor_si256(_mm256_xor_si256(v[j][0], v[j][1]), _mm256_xor_si256(v[j][2], v[j][3]));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pOut + i + 4 * j), hash);
+            }
+        }
+        return i;
+    }
+
+    /* Masked forms of the intrinsics are used with a full mask, the plain ones trip -Wmaybe-uninitialized
+     * in GCC's own header. */
+    template<int Bits>
+    __attribute__((target("avx512f")))
+    inline __m512i rotateLeft512(__m512i pValue) {
+        return _mm512_mask_rol_epi64(pValue, 0xff, pValue, Bits);
+    }
+
+    __attribute__((target("avx512f")))
+    inline void sipRound512(__m512i* v) {
+        v[0] = _mm512_add_epi64(v[0], v[1]);
+        v[1] = _mm512_xor_si512(rotateLeft512<13>(v[1]), v[0]);
+        v[0] = rotateLeft512<32>(v[0]);
+        v[2] = _mm512_add_epi64(v[2], v[3]);
+        v[3] = _mm512_xor_si512(rotateLeft512<16>(v[3]), v[2]);
+        v[0] = _mm512_add_epi64(v[0], v[3]);
+        v[3] = _mm512_xor_si512(rotateLeft512<21>(v[3]), v[0]);
+        v[2] = _mm512_add_epi64(v[2], v[1]);
+        v[1] = _mm512_xor_si512(rotateLeft512<17>(v[1]), v[2]);
+        v[2] = rotateLeft512<32>(v[2]);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512i loadWords512(const void* pWords, std::size_t pBytes) {
+        if (pBytes == 8)
+            return _mm512_loadu_si512(pWords);
+        return _mm512_maskz_cvtepu32_epi64(0xff, _mm256_loadu_si256(static_cast<const __m256i*>(pWords)));
+    }
+
+    __attribute__((target("avx512f")))
+    inline std::size_t sipHashAvx512(const void* pWords, std::size_t pCount, std::size_t pBytes,
+                                     std::uint64_t pKey0, std::uint64_t pKey1, std::uint64_t* pOut) {
+        const unsigned char* words = static_cast<const unsigned char*>(pWords);
+        const __m512i length = _mm512_set1_epi64(static_cast<long long>(static_cast<std::uint64_t>(pBytes) << 56));
+        const __m512i init[4] = {
+                _mm512_set1_epi64(static_cast<long long>(0x736f6d6570736575ULL ^ pKey0)),
+                _mm512_set1_epi64(static_cast<long long>(0x646f72616e646f6dULL ^ pKey1)),
+                _mm512_set1_epi64(static_cast<long long>(0x6c7967656e657261ULL ^ pKey0)),
+                _mm512_set1_epi64(static_cast<long long>(0x7465646279746573ULL ^ pKey1))
+        };
+        const __m512i finalization = _mm512_set1_epi64(0xff);
+
+        std::size_t i = 0;
+        for (; i + 16 <= pCount; i += 16) {
+            __m512i v[2][4];
+            __m512i word[2];
+            for (int j = 0; j < 2; ++j) {
+                for (int k = 0; k < 4; ++k)
+                    v[j][k] = init[k];
+                word[j] = loadWords512(words + (i + 8 * j) * pBytes, pBytes);
+                if (pBytes == 8) {
+                    v[j][3] = _mm512_xor_si512(v[j][3], word[j]);
+                    sipRound512(v[j]);
+                    v[j][0] = _mm512_xor_si512(v[j][0], word[j]);
+                    word[j] = length;
+                } else {
+                    word[j] = _mm512_or_si512(word[j], length);
+                }
+            }
+            for (int j = 0; j < 2; ++j) {
+                v[j][3] = _mm512_xor_si512(v[j][3], word[j]);
+                sipRound512(v[j]);
+                v[j][0] = _mm512_xor_si512(v[j][0], word[j]);
+                v[j][2] = _mm512_xor_si512(v[j][2], finalization);
+                sipRound512(v[j]);
+                sipRound512(v[j]);
+                sipRound512(v[j]);
+                __m512i hash = _mm512_xor_si512(_mm512_xor_si512(v[j][0], v[j][1]), _mm512_xor_si512(v[j][2], v[j][3]));
+                _mm512_storeu_si512(pOut + i + 8 * j, hash);
+            }
+        }
+        return i;
+    }
+
+#endif
+
+    /* Hashes a prefix of the keys with a SIMD kernel, returns its length. Only 4 and 8 byte integers, read
+     * as little-endian words exactly as sipHash() reads them, have kernels. */
+    template<typename KeyType, typename Enable = void>
+    struct KeyedHashKernel {
+        static std::size_t hash(const KeyType*, std::size_t, std::uint64_t, std::uint64_t, std::uint64_t*, SimdLevel) {
+            return 0;
+        }
+    };
+
+    template<typename KeyType>
+    struct KeyedHashKernel<KeyType, typename std::enable_if<std::is_integral<KeyType>::value
+                                                            && (sizeof(KeyType) == 4 || sizeof(KeyType) == 8)>::type> {
+        static std::size_t hash(const KeyType* pKeys, std::size_t pCount, std::uint64_t pKey0, std::uint64_t pKey1,
+                                std::uint64_t* pOut, SimdLevel pLevel) {
+#if defined(__x86_64__)
+            if (pLevel == SimdLevel::Avx512)
+                return sipHashAvx512(pKeys, pCount, sizeof(KeyType), pKey0, pKey1, pOut);
+            if (pLevel == SimdLevel::Avx2)
+                return sipHashAvx2(pKeys, pCount, sizeof(KeyType), pKey0, pKey1, pOut);
+#else
+            (void) pKeys, (void) pCount, (void) pKey0, (void) pKey1, (void) pOut, (void) pLevel;
+#endif
+            return 0;
+        }
+    };
+
+    /* pOut[i] = KeyedHash<KeyType>::hash(pKeys[i], pKey0, pKey1) for pCount keys, using the kernels of
+     * pLevel, which has to be supported, where there are any and scalar code for the rest. */
+    template<typename KeyType>
+    void keyedHashBatch(const KeyType* pKeys, std::size_t pCount, std::uint64_t pKey0, std::uint64_t pKey1,
+                        std::uint64_t* pOut, SimdLevel pLevel = detectSimdLevel()) {
+        std::size_t i = KeyedHashKernel<KeyType>::hash(pKeys, pCount, pKey0, pKey1, pOut, pLevel);
+        for (; i < pCount; ++i)
+            pOut[i] = KeyedHash<KeyType>::hash(pKeys[i], pKey0, pKey1);
+    }
+
+}
+
+#endif /* AISDI_MAPS_HASHKERNELS_H */
@@ -1,15 +1,83 @@
 #ifndef AISDI_MAPS_HASHMAP_H
 #define AISDI_MAPS_HASHMAP_H
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <stdexcept>
 #include <utility>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "HashKernels.h"
+#include "Hashing.h"
+#include "PerfectHashMap.h"
+#include "Serialization.h"
+#include "ThreadPool.h"
+#include "TreeMap.h"
 
 namespace aisdi {
 
+    template<typename KeyType, typename = void>
+    struct IsOrdered : std::false_type {};
+
+    template<typename KeyType>
+    struct IsOrdered<KeyType, decltype(void(std::declval<const KeyType&>() < std::declval<const KeyType&>()))>
+            : std::true_type {};
+
+    /* Index of the nodes of one long HashMap chain by key, a TreeMap - lookups in a bucket full of colliding
+     * keys take O(log n) instead of a walk of the chain, which stays linked for iteration. */
+    template<typename KeyType, typename Node, bool Ordered = IsOrdered<KeyType>::value>
+    class ChainIndex {
+    public:
+        static const bool Enabled = true;
+
+        Node* find(const KeyType& pKey) const {
+            auto it = mTree.find(pKey);
+            return it == mTree.end() ? nullptr : it->second;
+        }
+
+        void insert(Node* pNode) {
+            mTree[pNode->mPair.first] = pNode;
+        }
+
+        void remove(const KeyType& pKey) {
+            mTree.remove(pKey);
+        }
+
+        std::size_t getSize() const {
+            return mTree.getSize();
+        }
+
+    private:
+        TreeMap<KeyType, Node*> mTree;
+    };
+
+    /* Keys without operator< cannot be indexed, their chains are never treeified. */
+    template<typename KeyType, typename Node>
+    class ChainIndex<KeyType, Node, false> {
+    public:
+        static const bool Enabled = false;
+
+        Node* find(const KeyType&) const {
+            return nullptr;
+        }
+
+        void insert(Node*) {}
+
+        void remove(const KeyType&) {}
+
+        std::size_t getSize() const {
+            return 0;
+        }
+    };
+
     template<typename KeyType, typename ValueType>
     class HashMap {
     public:
@@ -29,14 +97,72 @@ namespace aisdi {
         using iterator = Iterator;
         using const_iterator = ConstIterator;
 
-        HashMap(size_type pBuckets = 50) : mBucketCount(pBuckets), mCount(0) {
+        /* Snapshot of the bucket layout, see stats(). */
+        struct Statistics {
+            size_type mSize;
+            size_type mBucketCount;
+            size_type mUsedBuckets;
+            size_type mLongestChain;
+            double mLoadFactor;
+            /* Key comparisons of an average lookup of a present / missing key. */
+            double mSuccessfulProbes;
+            double mUnsuccessfulProbes;
+            /* Fraction of entries sharing their bucket with an earlier entry. */
+            double mCollisionRate;
+            /* Successful probes expected from a uniformly random hash divided by the observed ones:
+             * about 1 for a good hasher, approaching 0 when keys pile up in few buckets. */
+            double mHashQuality;
+            /* mHistogram[k] - buckets holding k entries, the last one counts all longer chains. */
+            std::vector<size_type> mHistogram;
+            /* Buckets whose chain is indexed by a tree. */
+            size_type mTreeifiedBuckets;
+        };
+
+        static const size_type HistogramSize = 16;
+
+        /* How the map defends against keys chosen to collide under std::hash (for integers the identity).
+         * Maps are Unguarded unless told otherwise, so insertions keep iterators valid as they always did.
+         * Under Guarded and Keyed an insertion may reseed the map, moving every node to another bucket:
+         * it invalidates all iterators and changes the iteration order, references to items stay valid. */
+        enum class Hashing {
+            /* std::hash until an insertion walks a chain far longer than the load factor explains, then a
+             * randomly keyed hash, see reseed(). Long chains are indexed by a tree (see ChainIndex). */
+            Guarded,
+            /* Randomly keyed hash from the start, reseeded like Guarded and with indexed long chains. */
+            Keyed,
+            /* std::hash for good, only long chains are indexed by a tree - insertions never reseed. */
+            Treeified,
+            /* std::hash and plain chains however long they get, as before hashing policies existed. The
+             * default. */
+            Unguarded
+        };
+
+        /* A chain longer than TreeifiedChain plus twice the load factor gets a tree index, which is dropped
+         * when the chain shrinks below UntreeifiedChain. */
+        static const size_type TreeifiedChain = 8;
+        static const size_type UntreeifiedChain = 6;
+
+        /* An insertion into a chain longer than this plus twice the load factor reseeds a guarded map. */
+        static const size_type FloodedChain = 32;
+
+        /* Keys hashed at once by the batched insert() and find(). */
+        static const size_type BatchSize = 256;
+
+        HashMap(size_type pBuckets = 50, Hashing pHashing = Hashing::Unguarded)
+                : mBucketCount(pBuckets), mCount(0), mBlock(nullptr), mBlockSize(0), mHashing(pHashing),
+                  mKeyed(false), mKey0(0), mKey1(0), mNextReseed(0) {
             mBuckets = new BucketNode* [mBucketCount];
+            mOccupied = new std::uint64_t[wordCount()];
 
             for (size_type i = 0; i < mBucketCount; i++)
                 mBuckets[i] = nullptr;
+            for (size_type i = 0; i < wordCount(); i++)
+                mOccupied[i] = 0;
             mHasher = [](const key_type& pKey) {
                 return std::hash<key_type>{}(pKey);
             };
+            if (mHashing == Hashing::Keyed)
+                reseed(randomSeed());
         }
 
         HashMap(std::initializer_list<value_type> list) : HashMap() {
@@ -44,42 +170,51 @@ namespace aisdi {
                 insert(item.first, item.second);
         }
 
-        HashMap(const HashMap& other) : HashMap() {
+        /* Clones the layout: same bucket count and hasher, chains copied in order without rehashing into one
+         * block of nodes. */
+        HashMap(const HashMap& other) : HashMap(other.mBucketCount, Hashing::Unguarded) {
             mHasher = other.mHasher;
-
-            for (auto it = other.cbegin(); it != other.cend(); ++it)
-                insert((*it).first, (*it).second);
+            mHashing = other.mHashing;
+            mKeyed = other.mKeyed;
+            mKey0 = other.mKey0;
+            mKey1 = other.mKey1;
+            mNextReseed = other.mNextReseed;
+            if (other.mCount == 0)
+                return;
+            mBlock = static_cast<BucketNode*>(::operator new(other.mCount * sizeof(BucketNode)));
+            mBlockSize = other.mCount;
+            BucketNode* next = mBlock;
+            for (size_type i = other.nextOccupied(0); i < mBucketCount; i = other.nextOccupied(i + 1))
+                for (BucketNode* node = other.mBuckets[i]; node != nullptr; node = node->mNextNode)
+                    append(i, new(next++) BucketNode(node->mPair));
+            treeifyLongChains();
         }
 
         HashMap(HashMap&& other) : HashMap() {
-            std::swap(mCount, other.mCount);
-            std::swap(mBuckets, other.mBuckets);
-            std::swap(mBucketCount, other.mBucketCount);
-            std::swap(mHasher, other.mHasher);
+            swap(other);
         }
 
         ~HashMap() {
             clear();
             delete[] mBuckets;
+            delete[] mOccupied;
         }
 
+        /* Takes over the layout of other along with its items, see the copy constructor. */
         HashMap& operator=(const HashMap& other) {
-            if (*this == other)
-                return *this;
-            clear();
-            for (auto&& item : other) {
-                insert(item.first, item.second);
+            if (this != &other) {
+                HashMap copy(other);
+                swap(copy);
             }
             return *this;
         }
 
-
+        /* Leaves other empty, with the buckets of this map. */
         HashMap& operator=(HashMap&& other) {
-            std::swap(mCount, other.mCount);
-            std::swap(mBuckets, other.mBuckets);
-            std::swap(mBucketCount, other.mBucketCount);
-            std::swap(mHasher, other.mHasher);
-            other.mCount = 0;
+            if (this != &other) {
+                clear();
+                swap(other);
+            }
             return *this;
         }
 
@@ -87,15 +222,43 @@ namespace aisdi {
             return mCount == 0;
         }
 
+        /* Under Hashing::Guarded and Keyed inserting a key may reseed the map, which invalidates iterators but
+         * not references, see Hashing. */
         mapped_type& operator[](const key_type& key) {
-            size_type bucket = bucketHash(key);
-            BucketNode* node = mBuckets[bucket];
-            while (node != nullptr && node->mPair.first != key)
-                node = node->mNextNode;
-            if (node == nullptr)
-                return (*insert(key)).second;
-            else
-                return node->mPair.second;
+            return access(bucketHash(key), key);
+        }
+
+        /* Inserts or assigns a batch of items, the last assignment to a key wins as with operator[]. Keys are
+         * hashed BatchSize at a time - by the SIMD kernels of keyedHashBatch() for integer keys of keyed maps -
+         * and their buckets are prefetched before any is probed. May reseed the map like operator[]. */
+        template<typename InputIterator>
+        void insert(InputIterator first, InputIterator last) {
+            std::vector<key_type> keys;
+            std::vector<mapped_type> values;
+            std::vector<std::uint64_t> buckets(BatchSize);
+            keys.reserve(BatchSize);
+            values.reserve(BatchSize);
+            while (first != last) {
+                keys.clear();
+                values.clear();
+                for (; first != last && keys.size() < BatchSize; ++first) {
+                    keys.push_back((*first).first);
+                    values.push_back((*first).second);
+                }
+                bucketBatch(keys.data(), keys.size(), buckets.data());
+                bool keyed = mKeyed;
+                std::uint64_t seed = mKey0;
+                for (size_type i = 0; i < keys.size(); ++i) {
+                    /* An insertion that reseeds the map moves the keys still waiting to other buckets. */
+                    if (mKeyed != keyed || mKey0 != seed) {
+                        bucketBatch(keys.data() + i, keys.size() - i, buckets.data() + i);
+                        keyed = mKeyed;
+                        seed = mKey0;
+                    }
+                    prefetchHead(buckets.data(), i + PrefetchDistance, keys.size());
+                    access(buckets[i], keys[i]) = std::move(values[i]);
+                }
+            }
         }
 
         const mapped_type& valueOf(const key_type& key) const {
@@ -111,9 +274,7 @@ namespace aisdi {
 
         const_iterator find(const key_type& key) const {
             size_type bucket = bucketHash(key);
-            BucketNode* node = mBuckets[bucket];
-            while (node != nullptr && node->mPair.first != key)
-                node = node->mNextNode;
+            BucketNode* node = findNode(bucket, key);
             if (node == nullptr)
                 return end();
             return ConstIterator(*this, bucket, node);
@@ -123,69 +284,338 @@ namespace aisdi {
             return static_cast<const HashMap<KeyType, ValueType>*>(this)->find(key);
         }
 
+        /* Looks a batch of keys up the way insert(first, last) inserts them. Writes a pointer to the value of
+         * each key, nullptr for missing ones, to pOut and returns its end. */
+        template<typename InputIterator, typename OutputIterator>
+        OutputIterator find(InputIterator first, InputIterator last, OutputIterator pOut) const {
+            std::vector<key_type> keys;
+            std::vector<std::uint64_t> buckets(BatchSize);
+            keys.reserve(BatchSize);
+            while (first != last) {
+                keys.clear();
+                for (; first != last && keys.size() < BatchSize; ++first)
+                    keys.push_back(*first);
+                bucketBatch(keys.data(), keys.size(), buckets.data());
+                for (size_type i = 0; i < keys.size(); ++i) {
+                    prefetchHead(buckets.data(), i + PrefetchDistance, keys.size());
+                    BucketNode* node = findNode(buckets[i], keys[i]);
+                    *pOut++ = node == nullptr ? nullptr : &node->mPair.second;
+                }
+            }
+            return pOut;
+        }
+
+        /* Calls pFunction on every item on the threads of pPool, which get a few ranges of buckets each so that
+         * crowded ranges even out. pFunction is called concurrently and may change values but not the map. */
+        template<typename Function>
+        void parallelForEach(Function pFunction, ThreadPool& pPool = ThreadPool::shared()) {
+            size_type ranges = rangeCount(pPool);
+            pPool.run(ranges, [&](size_type pRange) {
+                forEachIn(pRange, ranges, pFunction);
+            });
+        }
+
+        template<typename Function>
+        void parallelForEach(Function pFunction, ThreadPool& pPool = ThreadPool::shared()) const {
+            size_type ranges = rangeCount(pPool);
+            pPool.run(ranges, [&](size_type pRange) {
+                forEachIn(pRange, ranges, [&pFunction](const_reference pItem) {
+                    pFunction(pItem);
+                });
+            });
+        }
+
+        /* Folds pTransform(item) of every item into pIdentity with pCombine, the ranges of parallelForEach()
+         * in parallel and their results in iteration order - pCombine has to be associative, not commutative. */
+        template<typename T, typename Transform, typename Combine>
+        T parallelReduce(T pIdentity, Transform pTransform, Combine pCombine,
+                         ThreadPool& pPool = ThreadPool::shared()) const {
+            struct Partial {
+                T mValue;
+            };
+            size_type ranges = rangeCount(pPool);
+            std::vector<Partial> partials(ranges, Partial{pIdentity});
+            pPool.run(ranges, [&](size_type pRange) {
+                T result = pIdentity;
+                forEachIn(pRange, ranges, [&](const_reference pItem) {
+                    result = pCombine(std::move(result), pTransform(pItem));
+                });
+                partials[pRange].mValue = std::move(result);
+            });
+            T result = std::move(pIdentity);
+            for (auto&& partial : partials)
+                result = pCombine(std::move(result), std::move(partial.mValue));
+            return result;
+        }
+
         void remove(const key_type& key) {
             size_type bucket = bucketHash(key);
-            BucketNode* prev = mBuckets[bucket];
+            BucketNode* node = findNode(bucket, key);
+            if (node == nullptr)
+                throw std::out_of_range("Key not found");
+            unlink(bucket, node);
+        }
 
-            if (prev == nullptr) throw std::out_of_range("Key not found");
+        void remove(const const_iterator& it) {
+            if (it.mNode == nullptr)
+                throw std::out_of_range("Erasing end");
+            unlink(it.mBucket, it.mNode);
+        }
 
-            if (prev->mPair.first == key) {
-                mBuckets[bucket] = prev->mNextNode;
-                delete prev;
-                mCount--;
-                return;
-            }
+        size_type getSize() const {
+            return mCount;
+        }
 
-            while (prev && prev->mNextNode && prev->mNextNode->mPair.first != key) prev = prev->mNextNode;
+        size_type getBucketCount() const {
+            return mBucketCount;
+        }
 
-            if (prev == nullptr) throw std::out_of_range("Key not found");
-            prev->mNextNode = prev->mNextNode->mNextNode;
-            mCount--;
-            delete prev;
+        double loadFactor() const {
+            return static_cast<double>(mCount) / mBucketCount;
         }
 
-        void remove(const const_iterator& it) {
-            if (it == end())
-                throw std::out_of_range("Erasing begin");
+        /* Whether keys are hashed with SipHash under a secret key rather than with std::hash. */
+        bool isKeyed() const {
+            return mKeyed;
+        }
 
-            BucketNode* prev;
-            prev = mBuckets[it.mBucket];
+        /* Switches to SipHash keyed with pSeed and moves every node to its new bucket - O(n) with no
+         * allocations, references to items stay valid but iterators do not. */
+        void reseed(std::uint64_t pSeed) {
+            std::uint64_t key0 = pSeed;
+            std::uint64_t key1 = mix64(pSeed ^ 0x9e3779b97f4a7c15ULL);
+            mHasher = [key0, key1](const key_type& pKey) {
+                return static_cast<size_type>(KeyedHash<key_type>::hash(pKey, key0, key1));
+            };
+            mKeyed = true;
+            mKey0 = key0;
+            mKey1 = key1;
+            mNextReseed = 2 * mCount;
+            rehash();
+        }
 
-            if (prev == it.mNode) {
-                mBuckets[it.mBucket] = prev->mNextNode;
-                delete prev;
-                mCount--;
-                return;
+        /* Immutable copy over a minimal perfect hash, see PerfectHashMap. Expected O(n), the map stays usable. */
+        PerfectHashMap<key_type, mapped_type> freeze() const {
+            return PerfectHashMap<key_type, mapped_type>(begin(), end());
+        }
+
+        /* Single pass over the buckets, no hashing and no allocations besides the histogram. */
+        Statistics stats() const {
+            Statistics result;
+            result.mSize = mCount;
+            result.mBucketCount = mBucketCount;
+            result.mUsedBuckets = 0;
+            result.mLongestChain = 0;
+            result.mHistogram.assign(HistogramSize, 0);
+            result.mTreeifiedBuckets = mIndexes.size() - std::count(mIndexes.begin(), mIndexes.end(), nullptr);
+
+            double probes = 0;
+            for (size_type i = 0; i < mBucketCount; ++i) {
+                size_type length = 0;
+                for (BucketNode* node = mBuckets[i]; node != nullptr; node = node->mNextNode)
+                    ++length;
+                if (length > 0)
+                    ++result.mUsedBuckets;
+                result.mLongestChain = std::max(result.mLongestChain, length);
+                result.mHistogram[std::min(length, HistogramSize - 1)]++;
+                probes += length * (length + 1) / 2.0;
             }
 
-            while (prev->mNextNode != it.mNode) prev = prev->mNextNode;
-            prev->mNextNode = prev->mNextNode->mNextNode;
-            mCount--;
-            delete prev;
+            result.mLoadFactor = loadFactor();
+            result.mUnsuccessfulProbes = result.mLoadFactor;
+            if (mCount == 0) {
+                result.mSuccessfulProbes = 0;
+                result.mCollisionRate = 0;
+                result.mHashQuality = 1;
+            } else {
+                result.mSuccessfulProbes = probes / mCount;
+                result.mCollisionRate = static_cast<double>(mCount - result.mUsedBuckets) / mCount;
+                result.mHashQuality = (1.0 + (mCount - 1) / (2.0 * mBucketCount)) / result.mSuccessfulProbes;
+            }
+            return result;
         }
 
-        size_type getSize() const {
-            return mCount;
+        /* Writes the hashing policy and whether the map is keyed - never the SipHash key itself - then the
+         * map bucket by bucket, chains in order, see Serialization.h. */
+        void save(std::ostream& out) const {
+            BinaryWriter writer(out);
+            writeHeader(writer, MapHeader{MapKind::HashMap, mCount, mBucketCount});
+            writer.writeValue(static_cast<std::uint32_t>(mHashing));
+            writer.writeValue<std::uint32_t>(mKeyed);
+            for (size_type bucket = nextOccupied(0); bucket != mBucketCount; bucket = nextOccupied(bucket + 1)) {
+                std::uint64_t length = 0;
+                for (BucketNode* node = mBuckets[bucket]; node != nullptr; node = node->mNextNode)
+                    ++length;
+                writer.writeValue<std::uint64_t>(bucket);
+                writer.writeValue(length);
+                for (BucketNode* node = mBuckets[bucket]; node != nullptr; node = node->mNextNode) {
+                    Serializer<key_type>::write(writer, node->mPair.first);
+                    Serializer<mapped_type>::write(writer, node->mPair.second);
+                }
+            }
+            writer.finish();
         }
 
-        bool operator==(const HashMap& other) const {
-            if (mCount != other.mCount)
-                return false;
+        /* Restores the saved hashing policy and bucket layout. Chains of an unkeyed map are relinked without
+         * hashing the keys, only the first key is hashed to check that std::hash still agrees with the file.
+         * A keyed map gets a fresh random key, so its entries are inserted as usual. */
+        static HashMap load(std::istream& in) {
+            BinaryReader reader(in);
+            MapHeader header = readHeader(reader, MapKind::HashMap);
+            std::uint32_t hashing = reader.readValue<std::uint32_t>();
+            std::uint32_t keyed = reader.readValue<std::uint32_t>();
+            if (header.mParameter == 0 || hashing > static_cast<std::uint32_t>(Hashing::Unguarded) || keyed > 1)
+                throw std::runtime_error("Corrupt map file");
+
+            HashMap map(header.mParameter, static_cast<Hashing>(hashing));
+            if (keyed && !map.mKeyed)
+                map.reseed(randomSeed());
+            bool checked = false, rehash = map.mKeyed;
+            std::uint64_t remaining = header.mSize;
+            std::uint64_t next = 0;
+            while (remaining > 0) {
+                std::uint64_t bucket = reader.readValue<std::uint64_t>();
+                std::uint64_t length = reader.readValue<std::uint64_t>();
+                if (bucket < next || bucket >= map.mBucketCount || length == 0 || length > remaining)
+                    throw std::runtime_error("Corrupt map file");
+                next = bucket + 1;
+                remaining -= length;
+
+                for (; length > 0; --length) {
+                    key_type key = Serializer<key_type>::read(reader);
+                    mapped_type value = Serializer<mapped_type>::read(reader);
+                    if (!checked) {
+                        rehash = rehash || map.bucketHash(key) != bucket;
+                        checked = true;
+                    }
+                    if (rehash)
+                        map[key] = std::move(value);
+                    else
+                        map.append(bucket, new BucketNode(key, std::move(value)));
+                }
+            }
+            reader.finish();
+            map.treeifyLongChains();
+            return map;
+        }
 
-            for (size_type i = 0; i < mBucketCount; ++i) {
-                if ((mBuckets[i] == nullptr && other.mBuckets[i] != nullptr) ||
-                    (mBuckets[i] != nullptr && other.mBuckets[i] == nullptr))
-                    return false;
+        /* Builds a map of pBuckets buckets from the items in [first, last) on the threads of pPool. The buckets
+         * are split into one range of whole mOccupied words per thread and the items are radix-partitioned by
+         * the range their bucket falls into, so every task links the chains it owns without locking. Items
+         * keep their order within a partition: chains come out as operator[] would leave them and the last of
+         * repeated keys wins. Nodes share one block, as in a copy. */
+        template<typename RandomAccessIterator>
+        static HashMap parallelBuild(RandomAccessIterator first, RandomAccessIterator last, size_type pBuckets,
+                                     ThreadPool& pPool = ThreadPool::shared(), Hashing pHashing = Hashing::Unguarded) {
+            HashMap map(pBuckets, pHashing);
+            size_type count = static_cast<size_type>(last - first);
+            if (count == 0)
+                return map;
+            size_type threads = std::min(pPool.getSize(), map.wordCount());
+
+            /* Partition p owns buckets [bounds[p], bounds[p + 1]), slice s of the input holds items
+             * [s * count / threads, (s + 1) * count / threads). */
+            std::vector<size_type> bounds(threads + 1);
+            for (size_type p = 0; p <= threads; ++p)
+                bounds[p] = std::min(map.wordCount() * p / threads * WordBits, map.mBucketCount);
+            auto sliceBegin = [count, threads](size_type pSlice) {
+                return count * pSlice / threads;
+            };
+            auto partitionOf = [&bounds](size_type pBucket) {
+                return static_cast<size_type>(std::upper_bound(bounds.begin() + 1, bounds.end(), pBucket)
+                                              - bounds.begin() - 1);
+            };
 
-                /* Buckets full, compare */
-                BucketNode* node = mBuckets[i];
-                while (node != nullptr) {
-                    if (other.find(node->mPair.first)->second != node->mPair.second)
-                        return false;
-                    node = node->mNextNode;
+            /* offsets[s * threads + p] - items of slice s in partition p, then where they start in order. */
+            std::vector<std::uint64_t> buckets(count);
+            std::vector<size_type> offsets(threads * threads, 0);
+            pPool.run(threads, [&](size_type pSlice) {
+                std::vector<key_type> keys;
+                keys.reserve(BatchSize);
+                for (size_type i = sliceBegin(pSlice); i < sliceBegin(pSlice + 1); i += keys.size()) {
+                    keys.clear();
+                    for (size_type j = i; j < sliceBegin(pSlice + 1) && keys.size() < BatchSize; ++j)
+                        keys.push_back(first[j].first);
+                    map.bucketBatch(keys.data(), keys.size(), buckets.data() + i);
+                    for (size_type j = 0; j < keys.size(); ++j)
+                        ++offsets[pSlice * threads + partitionOf(buckets[i + j])];
+                }
+            });
+            size_type offset = 0;
+            for (size_type p = 0; p < threads; ++p)
+                for (size_type s = 0; s < threads; ++s) {
+                    size_type items = offsets[s * threads + p];
+                    offsets[s * threads + p] = offset;
+                    offset += items;
                 }
+
+            std::vector<size_type> order(count);
+            pPool.run(threads, [&](size_type pSlice) {
+                for (size_type i = sliceBegin(pSlice); i < sliceBegin(pSlice + 1); ++i)
+                    order[offsets[pSlice * threads + partitionOf(buckets[i])]++] = i;
+            });
+
+            /* After the scatter offsets[s * threads + p] is where slice s ends in partition p, the entries of
+             * the last slice end the partitions. Node k of the block is built from item order[k]. */
+            map.mBlock = static_cast<BucketNode*>(::operator new(count * sizeof(BucketNode)));
+            map.mBlockSize = count;
+            std::vector<size_type> sizes(threads, 0);
+            std::vector<size_type> longest(threads, 0);
+            std::vector<std::vector<size_type>> candidates(threads);
+            try {
+                pPool.run(threads, [&](size_type pPartition) {
+                    size_type begin = pPartition == 0 ? 0 : offsets[(threads - 1) * threads + pPartition - 1];
+                    size_type end = offsets[(threads - 1) * threads + pPartition];
+                    for (size_type k = begin; k < end; ++k) {
+                        if (k + PrefetchDistance < end)
+                            __builtin_prefetch(map.mBuckets + buckets[order[k + PrefetchDistance]]);
+                        size_type i = order[k];
+                        size_type bucket = buckets[i];
+                        size_type length = 0;
+                        BucketNode* node = map.mBuckets[bucket];
+                        for (; node != nullptr && node->mPair.first != first[i].first; node = node->mNextNode)
+                            ++length;
+                        if (node != nullptr) {
+                            node->mPair.second = first[i].second;
+                            continue;
+                        }
+                        map.push(bucket, new(map.mBlock + k) BucketNode(first[i].first, first[i].second));
+                        ++sizes[pPartition];
+                        longest[pPartition] = std::max(longest[pPartition], length + 1);
+                        if (length == TreeifiedChain)
+                            candidates[pPartition].push_back(bucket);
+                    }
+                });
+            } catch (...) {
+                map.mCount = std::accumulate(sizes.begin(), sizes.end(), size_type(0));
+                throw;
             }
 
+            map.mCount = std::accumulate(sizes.begin(), sizes.end(), size_type(0));
+            if (map.isFlooded(*std::max_element(longest.begin(), longest.end()))) {
+                map.reseed(randomSeed());
+                return map;
+            }
+            for (auto&& partition : candidates)
+                for (size_type bucket : partition) {
+                    size_type length = 0;
+                    for (BucketNode* node = map.mBuckets[bucket]; node != nullptr; node = node->mNextNode)
+                        ++length;
+                    if (map.isLong(length))
+                        map.treeify(bucket);
+                }
+            return map;
+        }
+
+        /* Maps with different bucket counts or hashers may still be equal, so every key is looked up. */
+        bool operator==(const HashMap& other) const {
+            if (mCount != other.mCount)
+                return false;
+            for (auto&& item : *this) {
+                auto it = other.find(item.first);
+                if (it == other.end() || it->second != item.second)
+                    return false;
+            }
             return true;
         }
 
@@ -218,11 +648,283 @@ namespace aisdi {
         }
 
     private:
+        static const size_type WordBits = 64;
+
         size_type mBucketCount;
         size_type mCount;
         BucketNode** mBuckets;
+        /* Bit i is set when bucket i is not empty, lets iterators skip 64 empty buckets at a time. */
+        std::uint64_t* mOccupied;
 
         std::function<size_type(const key_type&)> mHasher;
+        /* Nodes of a copy, allocated together. They are destroyed in place when removed and their memory is
+         * released by clear(). */
+        BucketNode* mBlock;
+        size_type mBlockSize;
+        Hashing mHashing;
+        bool mKeyed;
+        /* SipHash key of a keyed map, see reseed(). */
+        std::uint64_t mKey0;
+        std::uint64_t mKey1;
+        /* Size the map has to reach before flooding reseeds it again. If a key type collides under every
+         * seed this keeps reseeding amortized O(1) per insertion. */
+        size_type mNextReseed;
+
+        using Index = ChainIndex<key_type, BucketNode>;
+        /* Index of every treeified bucket, nullptr for the others. Empty until a chain is first treeified. */
+        std::vector<Index*> mIndexes;
+
+        void swap(HashMap& other) {
+            std::swap(mCount, other.mCount);
+            std::swap(mBuckets, other.mBuckets);
+            std::swap(mOccupied, other.mOccupied);
+            std::swap(mBucketCount, other.mBucketCount);
+            std::swap(mHasher, other.mHasher);
+            std::swap(mBlock, other.mBlock);
+            std::swap(mBlockSize, other.mBlockSize);
+            std::swap(mHashing, other.mHashing);
+            std::swap(mKeyed, other.mKeyed);
+            std::swap(mKey0, other.mKey0);
+            std::swap(mKey1, other.mKey1);
+            std::swap(mNextReseed, other.mNextReseed);
+            std::swap(mIndexes, other.mIndexes);
+        }
+
+        /* Buckets ahead of the one being probed whose chain head is prefetched. */
+        static const size_type PrefetchDistance = 8;
+
+        mapped_type& access(size_type pBucket, const key_type& pKey) {
+            BucketNode* node;
+            size_type length = 0;
+            if (Index* index = indexOf(pBucket)) {
+                node = index->find(pKey);
+                length = index->getSize();
+            } else {
+                for (node = mBuckets[pBucket]; node != nullptr && node->mPair.first != pKey; node = node->mNextNode)
+                    ++length;
+            }
+            if (node != nullptr)
+                return node->mPair.second;
+            if (isFlooded(length)) {
+                reseed(randomSeed());
+                return (*insert(pKey)).second;
+            }
+            iterator it = insert(pKey);
+            if (isLong(length + 1) && indexOf(pBucket) == nullptr)
+                treeify(pBucket);
+            return (*it).second;
+        }
+
+        /* Buckets of pCount keys, whose head pointers get prefetched. Unkeyed maps hash with std::hash, which
+         * mHasher then is, without going through it. */
+        void bucketBatch(const key_type* pKeys, size_type pCount, std::uint64_t* pBuckets) const {
+            if (mKeyed)
+                keyedHashBatch(pKeys, pCount, mKey0, mKey1, pBuckets);
+            else
+                for (size_type i = 0; i < pCount; ++i)
+                    pBuckets[i] = std::hash<key_type>{}(pKeys[i]);
+            for (size_type i = 0; i < pCount; ++i) {
+                pBuckets[i] %= mBucketCount;
+                __builtin_prefetch(mBuckets + pBuckets[i]);
+            }
+        }
+
+        void prefetchHead(const std::uint64_t* pBuckets, size_type pIndex, size_type pCount) const {
+            if (pIndex < pCount && mBuckets[pBuckets[pIndex]] != nullptr)
+                __builtin_prefetch(mBuckets[pBuckets[pIndex]]);
+        }
+
+        Index* indexOf(size_type pBucket) const {
+            return mIndexes.empty() ? nullptr : mIndexes[pBucket];
+        }
+
+        BucketNode* findNode(size_type pBucket, const key_type& pKey) const {
+            if (Index* index = indexOf(pBucket))
+                return index->find(pKey);
+            BucketNode* node = mBuckets[pBucket];
+            while (node != nullptr && node->mPair.first != pKey)
+                node = node->mNextNode;
+            return node;
+        }
+
+        bool isLong(size_type pChainLength) const {
+            return Index::Enabled && mHashing != Hashing::Unguarded
+                   && pChainLength > TreeifiedChain + 2 * mCount / mBucketCount;
+        }
+
+        void treeify(size_type pBucket) {
+            if (mIndexes.empty())
+                mIndexes.assign(mBucketCount, nullptr);
+            std::unique_ptr<Index> index(new Index());
+            for (BucketNode* node = mBuckets[pBucket]; node != nullptr; node = node->mNextNode)
+                index->insert(node);
+            mIndexes[pBucket] = index.release();
+        }
+
+        void treeifyLongChains() {
+            for (size_type i = nextOccupied(0); i < mBucketCount; i = nextOccupied(i + 1)) {
+                size_type length = 0;
+                for (BucketNode* node = mBuckets[i]; node != nullptr; node = node->mNextNode)
+                    ++length;
+                if (isLong(length) && indexOf(i) == nullptr)
+                    treeify(i);
+            }
+        }
+
+        void clearIndexes() {
+            for (Index* index : mIndexes)
+                delete index;
+            mIndexes.clear();
+        }
+
+        bool isFlooded(size_type pChainLength) const {
+            return (mHashing == Hashing::Guarded || mHashing == Hashing::Keyed) && mCount >= mNextReseed
+                   && pChainLength > FloodedChain + 2 * mCount / mBucketCount;
+        }
+
+        /* Relinks every node into the bucket the current hasher picks. */
+        void rehash() {
+            clearIndexes();
+            BucketNode* nodes = nullptr;
+            for (size_type i = nextOccupied(0); i < mBucketCount; i = nextOccupied(i + 1)) {
+                BucketNode* node = mBuckets[i];
+                while (node != nullptr) {
+                    BucketNode* next = node->mNextNode;
+                    node->mNextNode = nodes;
+                    nodes = node;
+                    node = next;
+                }
+                mBuckets[i] = nullptr;
+            }
+            for (size_type i = 0; i < wordCount(); i++)
+                mOccupied[i] = 0;
+            mCount = 0;
+            while (nodes != nullptr) {
+                BucketNode* next = nodes->mNextNode;
+                link(bucketHash(nodes->mPair.first), nodes);
+                nodes = next;
+            }
+            treeifyLongChains();
+        }
+
+        void release(BucketNode* pNode) {
+            if (pNode >= mBlock && pNode < mBlock + mBlockSize)
+                pNode->~BucketNode();
+            else
+                delete pNode;
+        }
+
+        size_type wordCount() const {
+            return (mBucketCount + WordBits - 1) / WordBits;
+        }
+
+        /* First non-empty bucket not before pBucket, mBucketCount if there is none. */
+        size_type nextOccupied(size_type pBucket) const {
+            if (pBucket >= mBucketCount)
+                return mBucketCount;
+            size_type word = pBucket / WordBits;
+            std::uint64_t bits = mOccupied[word] & (~std::uint64_t(0) << (pBucket % WordBits));
+            while (bits == 0) {
+                if (++word == wordCount())
+                    return mBucketCount;
+                bits = mOccupied[word];
+            }
+            return word * WordBits + __builtin_ctzll(bits);
+        }
+
+        /* Last non-empty bucket before pBucket, mBucketCount if there is none. */
+        size_type previousOccupied(size_type pBucket) const {
+            if (pBucket == 0)
+                return mBucketCount;
+            --pBucket;
+            size_type word = pBucket / WordBits;
+            std::uint64_t bits = mOccupied[word] & (~std::uint64_t(0) >> (WordBits - 1 - pBucket % WordBits));
+            while (bits == 0) {
+                if (word == 0)
+                    return mBucketCount;
+                bits = mOccupied[--word];
+            }
+            return word * WordBits + WordBits - 1 - __builtin_clzll(bits);
+        }
+
+        /* Bucket ranges per thread of the parallel scans. */
+        static const size_type RangesPerThread = 8;
+
+        size_type rangeCount(const ThreadPool& pPool) const {
+            return pPool.getSize() == 1 ? 1 : std::min(pPool.getSize() * RangesPerThread, mBucketCount);
+        }
+
+        /* Calls pFunction on the items of range pRange out of pRanges equal ranges of buckets. */
+        template<typename Function>
+        void forEachIn(size_type pRange, size_type pRanges, Function&& pFunction) const {
+            size_type end = mBucketCount * (pRange + 1) / pRanges;
+            for (size_type i = nextOccupied(mBucketCount * pRange / pRanges); i < end; i = nextOccupied(i + 1))
+                for (BucketNode* node = mBuckets[i]; node != nullptr; node = node->mNextNode)
+                    pFunction(node->mPair);
+        }
+
+        /* Chains are doubly linked, the head's mPrevNode points to the tail. */
+        void link(size_type pBucket, BucketNode* pNode) {
+            push(pBucket, pNode);
+            if (Index* index = indexOf(pBucket))
+                index->insert(pNode);
+            mCount++;
+        }
+
+        /* Links pNode at the head of its chain, leaving the index and mCount to the caller. */
+        void push(size_type pBucket, BucketNode* pNode) {
+            BucketNode* head = mBuckets[pBucket];
+            pNode->mNextNode = head;
+            if (head != nullptr) {
+                pNode->mPrevNode = head->mPrevNode;
+                head->mPrevNode = pNode;
+            } else {
+                pNode->mPrevNode = pNode;
+                mOccupied[pBucket / WordBits] |= std::uint64_t(1) << (pBucket % WordBits);
+            }
+            mBuckets[pBucket] = pNode;
+        }
+
+        /* Adds pNode at the end of the chain, keeping the order chains were saved in. */
+        void append(size_type pBucket, BucketNode* pNode) {
+            BucketNode* head = mBuckets[pBucket];
+            if (head == nullptr) {
+                link(pBucket, pNode);
+                return;
+            }
+            pNode->mPrevNode = head->mPrevNode;
+            head->mPrevNode->mNextNode = pNode;
+            head->mPrevNode = pNode;
+            if (Index* index = indexOf(pBucket))
+                index->insert(pNode);
+            mCount++;
+        }
+
+        void unlink(size_type pBucket, BucketNode* pNode) {
+            BucketNode* head = mBuckets[pBucket];
+            if (pNode == head) {
+                mBuckets[pBucket] = pNode->mNextNode;
+                if (pNode->mNextNode != nullptr)
+                    pNode->mNextNode->mPrevNode = pNode->mPrevNode;
+                else
+                    mOccupied[pBucket / WordBits] &= ~(std::uint64_t(1) << (pBucket % WordBits));
+            } else {
+                pNode->mPrevNode->mNextNode = pNode->mNextNode;
+                if (pNode->mNextNode != nullptr)
+                    pNode->mNextNode->mPrevNode = pNode->mPrevNode;
+                else
+                    head->mPrevNode = pNode->mPrevNode;
+            }
+            if (Index* index = indexOf(pBucket)) {
+                index->remove(pNode->mPair.first);
+                if (index->getSize() < UntreeifiedChain) {
+                    delete index;
+                    mIndexes[pBucket] = nullptr;
+                }
+            }
+            release(pNode);
+            mCount--;
+        }
 
         size_type bucketHash(const key_type& pKey) const {
             return mHasher(pKey) % mBucketCount;
@@ -235,20 +937,14 @@ namespace aisdi {
         iterator insert(const key_type& pKey, mapped_type pValue) {
             size_type bucket = bucketHash(pKey);
             BucketNode* newValue = new BucketNode(pKey, pValue);
-            if (mBuckets[bucket] != nullptr)
-                newValue->mNextNode = mBuckets[bucket];
-            mBuckets[bucket] = newValue;
-            mCount++;
+            link(bucket, newValue);
             return Iterator(*this, bucket, newValue);
         };
 
         iterator insert(const key_type& pKey) {
             size_type bucket = bucketHash(pKey);
             BucketNode* newValue = new BucketNode(pKey);
-            if (mBuckets[bucket] != nullptr)
-                newValue->mNextNode = mBuckets[bucket];
-            mBuckets[bucket] = newValue;
-            mCount++;
+            link(bucket, newValue);
             return Iterator(*this, bucket, newValue);
         };
 
@@ -261,11 +957,17 @@ namespace aisdi {
                 while (node != nullptr) {
                     tmp_node = node;
                     node = node->mNextNode;
-                    delete tmp_node;
+                    release(tmp_node);
                     mCount--;
                 }
                 mBuckets[i] = nullptr;
             }
+            for (size_type i = 0; i < wordCount(); ++i)
+                mOccupied[i] = 0;
+            clearIndexes();
+            ::operator delete(mBlock);
+            mBlock = nullptr;
+            mBlockSize = 0;
         };
 
     };
@@ -274,12 +976,15 @@ namespace aisdi {
     struct HashMap<KeyType, ValueType>::BucketNode {
         value_type mPair;
         BucketNode* mNextNode;
+        BucketNode* mPrevNode;
 
-        BucketNode(const key_type& pKey) : mPair(std::make_pair(pKey, ValueType{})), mNextNode(nullptr) {}
+        BucketNode(const key_type& pKey)
+                : mPair(std::make_pair(pKey, ValueType{})), mNextNode(nullptr), mPrevNode(nullptr) {}
 
-        BucketNode(const key_type& pKey, mapped_type pData) : mPair(std::make_pair(pKey, pData)), mNextNode(nullptr) {}
+        BucketNode(const key_type& pKey, mapped_type pData)
+                : mPair(std::make_pair(pKey, pData)), mNextNode(nullptr), mPrevNode(nullptr) {}
 
-        BucketNode(value_type pPair) : mPair(pPair), mNextNode(nullptr) {}
+        BucketNode(const value_type& pPair) : mPair(pPair), mNextNode(nullptr), mPrevNode(nullptr) {}
     };
 
 
@@ -295,11 +1000,8 @@ namespace aisdi {
 
         explicit ConstIterator(const HashMap<KeyType, ValueType>& pMap, size_type pBucket, BucketNode* pNode) : mMap(
                 pMap), mBucket(pBucket), mNode(pNode) {
-
-            while (mNode == nullptr && mBucket < mMap.mBucketCount - 1) {
-                mBucket++;
-                mNode = mMap.mBuckets[mBucket];
-            }
+            if (mNode == nullptr)
+                skipEmptyBuckets();
         }
 
         ConstIterator(const ConstIterator& other) : mMap(other.mMap), mBucket(other.mBucket), mNode(other.mNode) {}
@@ -309,10 +1011,8 @@ namespace aisdi {
                 throw std::out_of_range("Incrementing end iterator");
 
             mNode = mNode->mNextNode;
-            while (mNode == nullptr && mBucket < mMap.mBucketCount - 1) {
-                mBucket++;
-                mNode = mMap.mBuckets[mBucket];
-            }
+            if (mNode == nullptr)
+                skipEmptyBuckets();
 
             return *this;
         }
@@ -324,21 +1024,17 @@ namespace aisdi {
         }
 
         ConstIterator& operator--() {
-
-            if (mMap.mBuckets[mBucket] == mNode) {
-                while (mMap.mBuckets[mBucket] == nullptr && mBucket > 0) mBucket--;
-                mNode = mMap.mBuckets[mBucket];
-
-                if (mBucket < 0 || mNode == nullptr)
-                    throw std::out_of_range("Decrementing begin iterator");
-
-                while (mNode->mNextNode != nullptr) mNode = mNode->mNextNode;
-
-            } else {
-                BucketNode* node = mMap.mBuckets[mBucket];
-                while (node->mNextNode != mNode) node = node->mNextNode;
-                mNode = node;
+            if (mNode != nullptr && mNode != mMap.mBuckets[mBucket]) {
+                mNode = mNode->mPrevNode;
+                return *this;
             }
+
+            /* At a chain head or at end - continue from the tail of the previous non-empty bucket. */
+            size_type bucket = mMap.previousOccupied(mNode == nullptr ? mBucket + 1 : mBucket);
+            if (bucket == mMap.mBucketCount)
+                throw std::out_of_range("Decrementing begin iterator");
+            mBucket = bucket;
+            mNode = mMap.mBuckets[mBucket]->mPrevNode;
             return *this;
         }
 
@@ -371,6 +1067,18 @@ namespace aisdi {
         const HashMap& mMap;
         size_type mBucket;
         BucketNode* mNode;
+
+        /* Moves to the head of the next non-empty bucket, or to end (the last bucket, no node). */
+        void skipEmptyBuckets() {
+            size_type bucket = mMap.nextOccupied(mBucket + 1);
+            if (bucket == mMap.mBucketCount) {
+                mBucket = mMap.mBucketCount - 1;
+                mNode = nullptr;
+            } else {
+                mBucket = bucket;
+                mNode = mMap.mBuckets[mBucket];
+            }
+        }
     };
 
     template<typename KeyType, typename ValueType>
@@ -0,0 +1,118 @@
+#ifndef AISDI_MAPS_HASHING_H
+#define AISDI_MAPS_HASHING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <type_traits>
+
+namespace aisdi {
+
+    /* Finalizer of MurmurHash3 - every input bit affects every output bit. std::hash of integers is the
+     * identity, so anything deriving several independent values from one hash has to mix it first. */
+    inline std::uint64_t mix64(std::uint64_t pValue) {
+        pValue ^= pValue >> 33;
+        pValue *= 0xff51afd7ed558ccdULL;
+        pValue ^= pValue >> 33;
+        pValue *= 0xc4ceb9fe1a85ec53ULL;
+        pValue ^= pValue >> 33;
+        return pValue;
+    }
+
+    /* Maps pHash uniformly onto [0, pRange) with a multiplication instead of a division (Lemire). Uses the
+     * high bits of pHash. */
+    inline std::uint64_t reduce(std::uint64_t pHash, std::uint64_t pRange) {
+        __extension__ typedef unsigned __int128 Wide;
+        return static_cast<std::uint64_t>((static_cast<Wide>(pHash) * pRange) >> 64);
+    }
+
+    template<typename KeyType>
+    std::uint64_t seededHash(const KeyType& pKey, std::uint64_t pSeed) {
+        return mix64(static_cast<std::uint64_t>(std::hash<KeyType>{}(pKey)) ^ pSeed);
+    }
+
+    inline std::uint64_t rotateLeft(std::uint64_t pValue, int pBits) {
+        return (pValue << pBits) | (pValue >> (64 - pBits));
+    }
+
+    /* SipHash-C-D of pLength bytes under the 128-bit key (pKey0, pKey1). Its output tells nothing about the
+     * key, so without it colliding inputs cannot be chosen. The default 1-3 variant is the one Rust's HashMap
+     * uses, 2-4 is the original. Words are read in host byte order. */
+    template<int Compressions = 1, int Finalizations = 3>
+    std::uint64_t sipHash(const void* pData, std::size_t pLength, std::uint64_t pKey0, std::uint64_t pKey1) {
+        std::uint64_t v0 = 0x736f6d6570736575ULL ^ pKey0;
+        std::uint64_t v1 = 0x646f72616e646f6dULL ^ pKey1;
+        std::uint64_t v2 = 0x6c7967656e657261ULL ^ pKey0;
+        std::uint64_t v3 = 0x7465646279746573ULL ^ pKey1;
+        auto rounds = [&](int pCount) {
+            for (int i = 0; i < pCount; ++i) {
+                v0 += v1;
+                v1 = rotateLeft(v1, 13) ^ v0;
+                v0 = rotateLeft(v0, 32);
+                v2 += v3;
+                v3 = rotateLeft(v3, 16) ^ v2;
+                v0 += v3;
+                v3 = rotateLeft(v3, 21) ^ v0;
+                v2 += v1;
+                v1 = rotateLeft(v1, 17) ^ v2;
+                v2 = rotateLeft(v2, 32);
+            }
+        };
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(pData);
+        const unsigned char* last = bytes + (pLength & ~std::size_t(7));
+        for (; bytes != last; bytes += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            v3 ^= word;
+            rounds(Compressions);
+            v0 ^= word;
+        }
+        std::uint64_t word = static_cast<std::uint64_t>(pLength) << 56;
+        for (std::size_t i = 0; i < (pLength & 7); ++i)
+            word |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+        v3 ^= word;
+        rounds(Compressions);
+        v0 ^= word;
+
+        v2 ^= 0xff;
+        rounds(Finalizations);
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    /* Keyed hash of a key, see sipHash(). Integers and strings are hashed by their bytes, other types by
+     * their std::hash - a keyed hash of it spreads the keys, but keys whose std::hash collides still do. */
+    template<typename KeyType, typename Enable = void>
+    struct KeyedHash {
+        static std::uint64_t hash(const KeyType& pKey, std::uint64_t pKey0, std::uint64_t pKey1) {
+            std::uint64_t value = std::hash<KeyType>{}(pKey);
+            return sipHash(&value, sizeof(value), pKey0, pKey1);
+        }
+    };
+
+    template<typename KeyType>
+    struct KeyedHash<KeyType, typename std::enable_if<std::is_integral<KeyType>::value>::type> {
+        static std::uint64_t hash(const KeyType& pKey, std::uint64_t pKey0, std::uint64_t pKey1) {
+            return sipHash(&pKey, sizeof(pKey), pKey0, pKey1);
+        }
+    };
+
+    template<>
+    struct KeyedHash<std::string> {
+        static std::uint64_t hash(const std::string& pKey, std::uint64_t pKey0, std::uint64_t pKey1) {
+            return sipHash(pKey.data(), pKey.size(), pKey0, pKey1);
+        }
+    };
+
+    /* Seed nobody else can predict, for per-instance hash keys. */
+    inline std::uint64_t randomSeed() {
+        std::random_device device;
+        return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+    }
+
+}
+
+#endif /* AISDI_MAPS_HASHING_H */
@@ -0,0 +1,56 @@
+#ifndef AISDI_MAPS_INTRUSIVEPTR_H
+#define AISDI_MAPS_INTRUSIVEPTR_H
+
+#include <atomic>
+#include <utility>
+
+namespace aisdi {
+
+    /* Reference to a node of a persistent container, counted in the node's own atomic mReferences, which a
+     * new node starts at one. The node is deleted with its last reference. unique() tells a node only one
+     * version refers to, which can be updated in place, from one that has to be copied first. */
+    template<typename Node>
+    class IntrusivePtr {
+    public:
+        IntrusivePtr() : mNode(nullptr) {}
+
+        explicit IntrusivePtr(Node* pNode) : mNode(pNode) {}
+
+        IntrusivePtr(const IntrusivePtr& other) : mNode(other.mNode) {
+            if (mNode != nullptr)
+                mNode->mReferences.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        IntrusivePtr(IntrusivePtr&& other) : mNode(other.mNode) {
+            other.mNode = nullptr;
+        }
+
+        IntrusivePtr& operator=(IntrusivePtr other) {
+            std::swap(mNode, other.mNode);
+            return *this;
+        }
+
+        ~IntrusivePtr() {
+            if (mNode != nullptr && mNode->mReferences.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete mNode;
+        }
+
+        Node* get() const {
+            return mNode;
+        }
+
+        Node* operator->() const {
+            return mNode;
+        }
+
+        bool unique() const {
+            return mNode->mReferences.load(std::memory_order_acquire) == 1;
+        }
+
+    private:
+        Node* mNode;
+    };
+
+}
+
+#endif /* AISDI_MAPS_INTRUSIVEPTR_H */
@@ -0,0 +1,177 @@
+#ifndef AISDI_MAPS_KEYGENERATOR_H
+#define AISDI_MAPS_KEYGENERATOR_H
+
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bm {
+
+    /* Produces consecutive keys of a single benchmark case. */
+    template<typename KeyType>
+    using KeyGenerator = std::function<KeyType()>;
+
+    /* Creates a fresh generator for a case of size n, so every case (and every repetition) sees the same keys. */
+    template<typename KeyType>
+    using KeyDistribution = std::function<KeyGenerator<KeyType>(int)>;
+
+    class Keys {
+    public:
+
+        /* Keys drawn uniformly from [0, n]. */
+        static KeyDistribution<int> uniform(unsigned pSeed = std::mt19937::default_seed) {
+            return [pSeed](int n) -> KeyGenerator<int> {
+                std::mt19937 device(pSeed);
+                std::uniform_int_distribution<int> distribution(0, n);
+                return [device, distribution]() mutable {
+                    return distribution(device);
+                };
+            };
+        }
+
+        /* Zipf-distributed ranks over [0, n) - key 0 is the hottest, theta in (0, 1) controls the skew
+         * (0.99 is the usual YCSB setting). Uses the method of Gray et al., "Quickly generating
+         * billion-record synthetic databases". */
+        static KeyDistribution<int> zipfian(double pTheta = 0.99, unsigned pSeed = std::mt19937::default_seed) {
+            if (pTheta <= 0.0 || pTheta >= 1.0)
+                throw std::invalid_argument("Zipfian theta has to be in (0, 1)");
+
+            return [pTheta, pSeed](int n) -> KeyGenerator<int> {
+                if (n < 2)
+                    return []() { return 0; };
+
+                double zetan = zeta(n, pTheta);
+                double zeta2 = zeta(2, pTheta);
+                double alpha = 1.0 / (1.0 - pTheta);
+                double eta = (1.0 - std::pow(2.0 / n, 1.0 - pTheta)) / (1.0 - zeta2 / zetan);
+                double second = 1.0 + std::pow(0.5, pTheta);
+
+                std::mt19937 device(pSeed);
+                std::uniform_real_distribution<double> distribution(0.0, 1.0);
+                return [=]() mutable {
+                    double u = distribution(device);
+                    double uz = u * zetan;
+                    if (uz < 1.0)
+                        return 0;
+                    if (uz < second)
+                        return 1;
+                    int rank = static_cast<int>(n * std::pow(eta * u - eta + 1.0, alpha));
+                    return rank < n ? rank : n - 1;
+                };
+            };
+        }
+
+        /* pHotProbability of the keys come from the first pHotFraction of [0, n], the rest from the remainder. */
+        static KeyDistribution<int> hotspot(double pHotFraction = 0.1, double pHotProbability = 0.9,
+                                            unsigned pSeed = std::mt19937::default_seed) {
+            if (pHotFraction <= 0.0 || pHotFraction >= 1.0 || pHotProbability < 0.0 || pHotProbability > 1.0)
+                throw std::invalid_argument("Invalid hotspot parameters");
+
+            return [pHotFraction, pHotProbability, pSeed](int n) -> KeyGenerator<int> {
+                int hotEnd = static_cast<int>(n * pHotFraction);
+                std::mt19937 device(pSeed);
+                std::bernoulli_distribution hit(pHotProbability);
+                std::uniform_int_distribution<int> hot(0, hotEnd);
+                std::uniform_int_distribution<int> cold(hotEnd < n ? hotEnd + 1 : n, n);
+                return [=]() mutable {
+                    return hit(device) ? hot(device) : cold(device);
+                };
+            };
+        }
+
+        /* Keys packed into pClusters dense runs of pWidth consecutive values scattered over [0, 32n]. */
+        static KeyDistribution<int> clustered(int pClusters = 16, int pWidth = 64,
+                                              unsigned pSeed = std::mt19937::default_seed) {
+            if (pClusters <= 0 || pWidth <= 0)
+                throw std::invalid_argument("Invalid cluster parameters");
+
+            return [pClusters, pWidth, pSeed](int n) -> KeyGenerator<int> {
+                std::mt19937 device(pSeed);
+                int span = n < std::numeric_limits<int>::max() / 32 ? 32 * n : std::numeric_limits<int>::max();
+                std::uniform_int_distribution<int> start(0, span > pWidth ? span - pWidth : 0);
+                std::vector<int> centers;
+                for (int i = 0; i < pClusters; ++i)
+                    centers.push_back(start(device));
+
+                std::uniform_int_distribution<int> cluster(0, pClusters - 1);
+                std::uniform_int_distribution<int> offset(0, pWidth - 1);
+                return [device, centers, cluster, offset]() mutable {
+                    return centers[cluster(device)] + offset(device);
+                };
+            };
+        }
+
+        /* pStart, pStart + pStep, pStart + 2 * pStep... - sorted input, the worst case for naive trees. */
+        static KeyDistribution<int> monotonic(int pStart = 0, int pStep = 1) {
+            return [pStart, pStep](int) -> KeyGenerator<int> {
+                int next = pStart;
+                return [next, pStep]() mutable {
+                    int key = next;
+                    next += pStep;
+                    return key;
+                };
+            };
+        }
+
+        /* Random multiples of pStride. With the default (identity) hasher every key lands in the same bucket
+         * of any HashMap whose bucket count divides pStride. */
+        static KeyDistribution<int> colliding(int pStride, unsigned pSeed = std::mt19937::default_seed) {
+            if (pStride <= 0)
+                throw std::invalid_argument("Stride has to be positive");
+
+            return [pStride, pSeed](int n) -> KeyGenerator<int> {
+                int limit = std::numeric_limits<int>::max() / pStride;
+                std::mt19937 device(pSeed);
+                std::uniform_int_distribution<int> distribution(0, n < limit ? n : limit);
+                return [device, distribution, pStride]() mutable {
+                    return distribution(device) * pStride;
+                };
+            };
+        }
+
+        /* String keys derived from another distribution, padded to a length in [pMinLength, pMaxLength].
+         * The same integer always maps to the same string, so the skew of pBase is preserved. */
+        static KeyDistribution<std::string> strings(KeyDistribution<int> pBase, std::size_t pMinLength = 8,
+                                                    std::size_t pMaxLength = 32) {
+            if (pMinLength > pMaxLength)
+                throw std::invalid_argument("Minimal key length exceeds maximal one");
+
+            return [pBase, pMinLength, pMaxLength](int n) -> KeyGenerator<std::string> {
+                KeyGenerator<int> base = pBase(n);
+                return [base, pMinLength, pMaxLength]() {
+                    int key = base();
+                    std::string result = std::to_string(key);
+                    std::size_t length = pMinLength + mix(static_cast<unsigned>(key)) % (pMaxLength - pMinLength + 1);
+                    if (result.size() < length)
+                        result.insert(0, length - result.size(), '#');
+                    return result;
+                };
+            };
+        }
+
+    private:
+
+        static double zeta(int pCount, double pTheta) {
+            double sum = 0;
+            for (int i = 1; i <= pCount; ++i)
+                sum += 1.0 / std::pow(i, pTheta);
+            return sum;
+        }
+
+        static std::size_t mix(unsigned pValue) {
+            pValue ^= pValue >> 16;
+            pValue *= 0x7feb352dU;
+            pValue ^= pValue >> 15;
+            pValue *= 0x846ca68bU;
+            pValue ^= pValue >> 16;
+            return pValue;
+        }
+    };
+}
+
+#endif /* AISDI_MAPS_KEYGENERATOR_H */
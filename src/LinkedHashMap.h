@@ -0,0 +1,381 @@
+#ifndef AISDI_MAPS_LINKEDHASHMAP_H
+#define AISDI_MAPS_LINKEDHASHMAP_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "HashMap.h"
+
+namespace aisdi {
+
+    /* HashMap whose entries are also threaded on a doubly linked list, so iteration visits them in a
+     * deterministic order at O(1) per step regardless of the bucket count. In insertion order (default)
+     * re-assigning an existing key keeps its position. In access order every lookup through a non-const
+     * map moves the entry to the back, making begin() the least recently used entry - the usual building
+     * block of LRU caches. */
+    template<typename KeyType, typename ValueType>
+    class LinkedHashMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using reference = value_type&;
+        using const_reference = const value_type&;
+
+        class ConstIterator;
+
+        class Iterator;
+
+        class Entry;
+
+        using iterator = Iterator;
+        using const_iterator = ConstIterator;
+
+        enum class Order {
+            Insertion, Access
+        };
+
+        LinkedHashMap(size_type pBuckets = 50, Order pOrder = Order::Insertion)
+                : mIndex(pBuckets), mHead(nullptr), mTail(nullptr), mOrder(pOrder) {}
+
+        LinkedHashMap(std::initializer_list<value_type> list) : LinkedHashMap() {
+            for (auto&& item : list)
+                (*this)[item.first] = item.second;
+        }
+
+        LinkedHashMap(const LinkedHashMap& other) : LinkedHashMap(other.mIndex.getBucketCount(), other.mOrder) {
+            for (Entry* entry = other.mHead; entry != nullptr; entry = entry->mNext)
+                append(entry->mPair);
+        }
+
+        LinkedHashMap(LinkedHashMap&& other) : LinkedHashMap(1, other.mOrder) {
+            swap(other);
+        }
+
+        ~LinkedHashMap() {
+            clear();
+        }
+
+        LinkedHashMap& operator=(const LinkedHashMap& other) {
+            if (this == &other)
+                return *this;
+            LinkedHashMap copy(other);
+            swap(copy);
+            return *this;
+        }
+
+        LinkedHashMap& operator=(LinkedHashMap&& other) {
+            swap(other);
+            return *this;
+        }
+
+        bool isEmpty() const {
+            return mIndex.isEmpty();
+        }
+
+        Order getOrder() const {
+            return mOrder;
+        }
+
+        /* A mapped_type constructor that throws leaves the map as it was. */
+        mapped_type& operator[](const key_type& key) {
+            Entry*& slot = mIndex[key];
+            if (slot == nullptr) {
+                try {
+                    slot = new Entry(key);
+                } catch (...) {
+                    mIndex.remove(key);
+                    throw;
+                }
+                link(slot);
+            } else {
+                touch(slot);
+            }
+            return slot->mPair.second;
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            return entryOf(key)->mPair.second;
+        }
+
+        mapped_type& valueOf(const key_type& key) {
+            Entry* entry = entryOf(key);
+            touch(entry);
+            return entry->mPair.second;
+        }
+
+        const_iterator find(const key_type& key) const {
+            auto it = mIndex.find(key);
+            return ConstIterator(*this, it == mIndex.end() ? nullptr : it->second);
+        }
+
+        iterator find(const key_type& key) {
+            auto it = mIndex.find(key);
+            if (it == mIndex.end())
+                return end();
+            touch(it->second);
+            return Iterator(*this, it->second);
+        }
+
+        void remove(const key_type& key) {
+            auto it = mIndex.find(key);
+            if (it == mIndex.end())
+                throw std::out_of_range("Key not found");
+            Entry* entry = it->second;
+            mIndex.remove(it);
+            unlink(entry);
+            delete entry;
+        }
+
+        void remove(const const_iterator& it) {
+            if (it.mNode == nullptr)
+                throw std::out_of_range("Erasing end");
+            remove(it.mNode->mPair.first);
+        }
+
+        size_type getSize() const {
+            return mIndex.getSize();
+        }
+
+        size_type getBucketCount() const {
+            return mIndex.getBucketCount();
+        }
+
+        /* Order does not matter, like for two HashMaps. */
+        bool operator==(const LinkedHashMap& other) const {
+            if (getSize() != other.getSize())
+                return false;
+
+            for (Entry* entry = mHead; entry != nullptr; entry = entry->mNext) {
+                auto it = other.mIndex.find(entry->mPair.first);
+                if (it == other.mIndex.end() || it->second->mPair.second != entry->mPair.second)
+                    return false;
+            }
+            return true;
+        }
+
+        bool operator!=(const LinkedHashMap& other) const {
+            return !(*this == other);
+        }
+
+        iterator begin() {
+            return Iterator(*this, mHead);
+        }
+
+        iterator end() {
+            return Iterator(*this, nullptr);
+        }
+
+        const_iterator cbegin() const {
+            return ConstIterator(*this, mHead);
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(*this, nullptr);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        HashMap<key_type, Entry*> mIndex;
+        Entry* mHead;
+        Entry* mTail;
+        Order mOrder;
+
+        void swap(LinkedHashMap& other) {
+            std::swap(mIndex, other.mIndex);
+            std::swap(mHead, other.mHead);
+            std::swap(mTail, other.mTail);
+            std::swap(mOrder, other.mOrder);
+        }
+
+        Entry* entryOf(const key_type& key) const {
+            auto it = mIndex.find(key);
+            if (it == mIndex.end())
+                throw std::out_of_range("Not found");
+            return it->second;
+        }
+
+        void append(const value_type& pPair) {
+            std::unique_ptr<Entry> entry(new Entry(pPair));
+            mIndex[pPair.first] = entry.get();
+            link(entry.release());
+        }
+
+        /* Appends to the back of the list. */
+        void link(Entry* pEntry) {
+            pEntry->mPrev = mTail;
+            pEntry->mNext = nullptr;
+            if (mTail != nullptr)
+                mTail->mNext = pEntry;
+            else
+                mHead = pEntry;
+            mTail = pEntry;
+        }
+
+        void unlink(Entry* pEntry) {
+            if (pEntry->mPrev != nullptr)
+                pEntry->mPrev->mNext = pEntry->mNext;
+            else
+                mHead = pEntry->mNext;
+            if (pEntry->mNext != nullptr)
+                pEntry->mNext->mPrev = pEntry->mPrev;
+            else
+                mTail = pEntry->mPrev;
+        }
+
+        void touch(Entry* pEntry) {
+            if (mOrder == Order::Access && pEntry != mTail) {
+                unlink(pEntry);
+                link(pEntry);
+            }
+        }
+
+        void clear() {
+            while (mHead != nullptr) {
+                Entry* next = mHead->mNext;
+                delete mHead;
+                mHead = next;
+            }
+            mTail = nullptr;
+        }
+    };
+
+    template<typename KeyType, typename ValueType>
+    class LinkedHashMap<KeyType, ValueType>::Entry {
+    public:
+        value_type mPair;
+        Entry* mPrev;
+        Entry* mNext;
+
+        Entry(const key_type& pKey) : mPair(pKey, ValueType{}), mPrev(nullptr), mNext(nullptr) {}
+
+        Entry(const value_type& pPair) : mPair(pPair), mPrev(nullptr), mNext(nullptr) {}
+    };
+
+
+    template<typename KeyType, typename ValueType>
+    class LinkedHashMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename LinkedHashMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename LinkedHashMap::value_type;
+        using pointer = const typename LinkedHashMap::value_type*;
+
+        friend class LinkedHashMap;
+
+        explicit ConstIterator(const LinkedHashMap& pMap, Entry* pNode) : mMap(&pMap), mNode(pNode) {}
+
+        ConstIterator(const ConstIterator& other) : mMap(other.mMap), mNode(other.mNode) {}
+
+        ConstIterator& operator=(const ConstIterator& other) {
+            mMap = other.mMap;
+            mNode = other.mNode;
+            return *this;
+        }
+
+        ConstIterator& operator++() {
+            if (mNode == nullptr)
+                throw std::out_of_range("Incrementing end iterator");
+            mNode = mNode->mNext;
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            Entry* previous = mNode == nullptr ? mMap->mTail : mNode->mPrev;
+            if (previous == nullptr)
+                throw std::out_of_range("Decrementing begin iterator");
+            mNode = previous;
+            return *this;
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mNode == nullptr)
+                throw std::out_of_range("Dereferencing end iterator");
+            return mNode->mPair;
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return mNode == other.mNode;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const LinkedHashMap* mMap;
+        Entry* mNode;
+    };
+
+    template<typename KeyType, typename ValueType>
+    class LinkedHashMap<KeyType, ValueType>::Iterator : public LinkedHashMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename LinkedHashMap::reference;
+        using pointer = typename LinkedHashMap::value_type*;
+
+        explicit Iterator(const LinkedHashMap& pMap, Entry* pNode) : ConstIterator(pMap, pNode) {}
+
+        Iterator(const ConstIterator& other) : ConstIterator(other) {}
+
+        Iterator& operator++() {
+            ConstIterator::operator++();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto result = *this;
+            ConstIterator::operator++();
+            return result;
+        }
+
+        Iterator& operator--() {
+            ConstIterator::operator--();
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            auto result = *this;
+            ConstIterator::operator--();
+            return result;
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        reference operator*() const {
+            return const_cast<reference>(ConstIterator::operator*());
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_LINKEDHASHMAP_H */
@@ -0,0 +1,149 @@
+#ifndef AISDI_MAPS_LRUCACHE_H
+#define AISDI_MAPS_LRUCACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+
+#include "LinkedHashMap.h"
+
+namespace aisdi {
+
+    /* Hit/miss counters shared by the caches, see stats(). */
+    struct CacheStatistics {
+        std::size_t mHits;
+        std::size_t mMisses;
+        std::size_t mEvictions;
+
+        double hitRatio() const {
+            std::size_t lookups = mHits + mMisses;
+            return lookups == 0 ? 0.0 : static_cast<double>(mHits) / lookups;
+        }
+    };
+
+    /* Bounded cache evicting the least recently used entries. The capacity is a total weight: with the
+     * default weigher every entry weighs 1 and the capacity counts entries, a weigher returning sizes in
+     * bytes makes it a byte budget. get, put and eviction are O(1) - the cache is an access ordered
+     * LinkedHashMap whose front is always the next victim. */
+    template<typename KeyType, typename ValueType>
+    class LruCache {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using size_type = std::size_t;
+        using Weigher = std::function<size_type(const key_type&, const mapped_type&)>;
+
+        /* pBuckets == 0 sizes the table for pCapacity unit-weight entries. */
+        explicit LruCache(size_type pCapacity, Weigher pWeigher = nullptr, size_type pBuckets = 0)
+                : mEntries(pBuckets > 0 ? pBuckets : defaultBuckets(pCapacity), Entries::Order::Access),
+                  mWeigher(pWeigher), mCapacity(pCapacity), mWeight(0), mStatistics{0, 0, 0} {
+            if (pCapacity == 0)
+                throw std::invalid_argument("Cache capacity has to be positive");
+        }
+
+        /* Cached value or nullptr, a hit makes the entry the most recently used one. The pointer is valid
+         * until the next put or remove. */
+        const mapped_type* get(const key_type& pKey) {
+            auto it = mEntries.find(pKey);
+            if (it == mEntries.end()) {
+                ++mStatistics.mMisses;
+                return nullptr;
+            }
+            ++mStatistics.mHits;
+            return &it->second.mValue;
+        }
+
+        /* Inserts or replaces the value, then evicts least recently used entries until the cache fits its
+         * capacity. An entry heavier than the whole capacity is evicted right away. A new key whose value
+         * fails to move in is not cached. */
+        void put(const key_type& pKey, mapped_type pValue) {
+            size_type weight = weigh(pKey, pValue);
+            size_type size = mEntries.getSize();
+            Slot& slot = mEntries[pKey];
+            try {
+                slot.mValue = std::move(pValue);
+            } catch (...) {
+                if (mEntries.getSize() != size)
+                    mEntries.remove(pKey);
+                throw;
+            }
+            mWeight = mWeight - slot.mWeight + weight;
+            slot.mWeight = weight;
+            evict();
+        }
+
+        bool contains(const key_type& pKey) const {
+            return mEntries.find(pKey) != mEntries.end();
+        }
+
+        bool remove(const key_type& pKey) {
+            auto it = mEntries.find(pKey);
+            if (it == mEntries.end())
+                return false;
+            mWeight -= it->second.mWeight;
+            mEntries.remove(it);
+            return true;
+        }
+
+        bool isEmpty() const {
+            return mEntries.isEmpty();
+        }
+
+        size_type getSize() const {
+            return mEntries.getSize();
+        }
+
+        size_type getWeight() const {
+            return mWeight;
+        }
+
+        size_type getCapacity() const {
+            return mCapacity;
+        }
+
+        const CacheStatistics& stats() const {
+            return mStatistics;
+        }
+
+        void resetStats() {
+            mStatistics = CacheStatistics{0, 0, 0};
+        }
+
+    private:
+        struct Slot {
+            mapped_type mValue;
+            size_type mWeight;
+
+            Slot() : mValue(), mWeight(0) {}
+        };
+
+        using Entries = LinkedHashMap<key_type, Slot>;
+
+        Entries mEntries;
+        Weigher mWeigher;
+        size_type mCapacity;
+        size_type mWeight;
+        CacheStatistics mStatistics;
+
+        static size_type defaultBuckets(size_type pCapacity) {
+            return pCapacity < 16 ? 16 : (pCapacity > (1u << 20) ? (1u << 20) : pCapacity);
+        }
+
+        size_type weigh(const key_type& pKey, const mapped_type& pValue) const {
+            return mWeigher ? mWeigher(pKey, pValue) : 1;
+        }
+
+        void evict() {
+            while (mWeight > mCapacity) {
+                auto eldest = mEntries.begin();
+                mWeight -= eldest->second.mWeight;
+                mEntries.remove(eldest);
+                ++mStatistics.mEvictions;
+            }
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_LRUCACHE_H */
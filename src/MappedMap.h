@@ -0,0 +1,511 @@
+#ifndef AISDI_MAPS_MAPPEDMAP_H
+#define AISDI_MAPS_MAPPEDMAP_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Hashing.h"
+
+namespace aisdi {
+
+    /* Read-only maps queried directly on the pages of a memory mapped file. Opening one maps the file and
+     * checks its header - O(1), nothing is read or allocated per entry, and processes mapping the same file
+     * share a single copy in the page cache. The layout is a 64 byte header followed by arrays of raw keys,
+     * values and, for MappedHashMap, bucket offsets, each aligned to 64 bytes. Everything is addressed by
+     * offsets from the start of the file, so it can be mapped anywhere. Only the header is validated on
+     * opening, the files are trusted to have been written by write().
+     *
+     * Keys and values have to be trivially copyable and, since the file is read back without conversion,
+     * it only makes sense on machines with the same representation of them. MappedHashMap hashes the bytes
+     * of the keys, which therefore must not contain padding. */
+    enum class MappedLayout : std::uint32_t {
+        Sorted = 1,
+        Hashed = 2
+    };
+
+    struct MappedHeader {
+        char mMagic[8];
+        std::uint32_t mVersion;
+        std::uint32_t mLayout;
+        std::uint32_t mKeySize;
+        std::uint32_t mValueSize;
+        std::uint64_t mSize;
+        std::uint64_t mBucketCount;
+        std::uint64_t mKeys;
+        std::uint64_t mValues;
+        std::uint64_t mBuckets;
+    };
+
+    static_assert(sizeof(MappedHeader) == 64, "Mapped map header has to stay 64 bytes");
+
+    /* Read-only shared mapping of a whole file, unmapped on destruction. */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string& pPath) : mData(nullptr), mSize(0) {
+            int descriptor = ::open(pPath.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                throw std::runtime_error("Cannot open " + pPath + ": " + std::strerror(errno));
+            struct stat status;
+            if (::fstat(descriptor, &status) != 0 || status.st_size == 0) {
+                ::close(descriptor);
+                throw std::runtime_error("Cannot map empty or unreadable file " + pPath);
+            }
+            void* data = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED,
+                                descriptor, 0);
+            ::close(descriptor);
+            if (data == MAP_FAILED)
+                throw std::runtime_error("Cannot map " + pPath + ": " + std::strerror(errno));
+            mData = static_cast<const char*>(data);
+            mSize = static_cast<std::size_t>(status.st_size);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) : mData(other.mData), mSize(other.mSize) {
+            other.mData = nullptr;
+            other.mSize = 0;
+        }
+
+        MappedFile& operator=(MappedFile&& other) {
+            std::swap(mData, other.mData);
+            std::swap(mSize, other.mSize);
+            return *this;
+        }
+
+        ~MappedFile() {
+            if (mData != nullptr)
+                ::munmap(const_cast<char*>(mData), mSize);
+        }
+
+        const char* data() const {
+            return mData;
+        }
+
+        std::size_t size() const {
+            return mSize;
+        }
+
+        /* Checks the header against what the opening map expects, throws std::runtime_error otherwise. */
+        const MappedHeader& header(MappedLayout pLayout, std::size_t pKeySize, std::size_t pValueSize) const {
+            if (mSize < sizeof(MappedHeader))
+                throw std::runtime_error("Mapped map file is truncated");
+            const MappedHeader& header = *reinterpret_cast<const MappedHeader*>(mData);
+            if (std::memcmp(header.mMagic, "AISDIMMF", 8) != 0 || header.mVersion != 1)
+                throw std::runtime_error("Not a mapped map file");
+            if (header.mLayout != static_cast<std::uint32_t>(pLayout) || header.mKeySize != pKeySize ||
+                header.mValueSize != pValueSize)
+                throw std::runtime_error("Mapped map file holds different types or layout");
+            checkSection(header.mKeys, header.mSize * pKeySize);
+            checkSection(header.mValues, header.mSize * pValueSize);
+            if (pLayout == MappedLayout::Hashed)
+                checkSection(header.mBuckets, (header.mBucketCount + 1) * sizeof(std::uint64_t));
+            return header;
+        }
+
+        template<typename T>
+        const T* section(std::uint64_t pOffset) const {
+            return reinterpret_cast<const T*>(mData + pOffset);
+        }
+
+        /* Writes the header and the sections, aligning each to 64 bytes and filling in their offsets. */
+        static void write(const std::string& pPath, MappedHeader pHeader, const void* pKeys, std::size_t pKeysSize,
+                          const void* pValues, std::size_t pValuesSize, const void* pBuckets = nullptr,
+                          std::size_t pBucketsSize = 0) {
+            std::memcpy(pHeader.mMagic, "AISDIMMF", 8);
+            pHeader.mVersion = 1;
+            pHeader.mKeys = align(sizeof(MappedHeader));
+            pHeader.mValues = align(pHeader.mKeys + pKeysSize);
+            pHeader.mBuckets = align(pHeader.mValues + pValuesSize);
+
+            std::ofstream out(pPath, std::ios::binary | std::ios::trunc);
+            std::uint64_t position = 0;
+            auto put = [&](std::uint64_t pOffset, const void* pData, std::size_t pSize) {
+                static const char zeros[SectionAlignment] = {};
+                out.write(zeros, pOffset - position);
+                out.write(static_cast<const char*>(pData), pSize);
+                position = pOffset + pSize;
+            };
+            put(0, &pHeader, sizeof(pHeader));
+            put(pHeader.mKeys, pKeys, pKeysSize);
+            put(pHeader.mValues, pValues, pValuesSize);
+            put(pHeader.mBuckets, pBuckets, pBucketsSize);
+            out.close();
+            if (!out)
+                throw std::runtime_error("Writing " + pPath + " failed");
+        }
+
+    private:
+        static const std::uint64_t SectionAlignment = 64;
+
+        const char* mData;
+        std::size_t mSize;
+
+        static std::uint64_t align(std::uint64_t pOffset) {
+            return (pOffset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        }
+
+        void checkSection(std::uint64_t pOffset, std::uint64_t pSize) const {
+            if (pOffset % SectionAlignment != 0 || pOffset > mSize || pSize > mSize - pOffset)
+                throw std::runtime_error("Mapped map file is truncated or corrupt");
+        }
+    };
+
+    /* Iterator over the parallel key and value arrays of the mapped maps, yields pair proxies like FlatMap. */
+    template<typename KeyType, typename ValueType>
+    class MappedIterator {
+    public:
+        using reference = std::pair<const KeyType&, const ValueType&>;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::pair<const KeyType, ValueType>;
+        using difference_type = std::ptrdiff_t;
+
+        class Arrow {
+        public:
+            explicit Arrow(reference pReference) : mReference(pReference) {}
+
+            const reference* operator->() const {
+                return &mReference;
+            }
+
+        private:
+            reference mReference;
+        };
+
+        using pointer = Arrow;
+
+        MappedIterator(const KeyType* pKeys, const ValueType* pValues, std::size_t pSize, std::size_t pIndex)
+                : mKeys(pKeys), mValues(pValues), mSize(pSize), mIndex(pIndex) {}
+
+        MappedIterator& operator++() {
+            if (mIndex >= mSize)
+                throw std::out_of_range("Incrementing end iterator");
+            ++mIndex;
+            return *this;
+        }
+
+        MappedIterator operator++(int) {
+            MappedIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        MappedIterator& operator--() {
+            if (mIndex == 0)
+                throw std::out_of_range("Decrementing begin iterator");
+            --mIndex;
+            return *this;
+        }
+
+        MappedIterator operator--(int) {
+            MappedIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mIndex >= mSize)
+                throw std::out_of_range("Dereferencing end iterator");
+            return reference(mKeys[mIndex], mValues[mIndex]);
+        }
+
+        pointer operator->() const {
+            return pointer(operator*());
+        }
+
+        bool operator==(const MappedIterator& other) const {
+            return mKeys == other.mKeys && mIndex == other.mIndex;
+        }
+
+        bool operator!=(const MappedIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const KeyType* mKeys;
+        const ValueType* mValues;
+        std::size_t mSize;
+        std::size_t mIndex;
+    };
+
+    /* Ordered mapped map: sorted keys searched like FlatMap's, lowerBound() and iteration for range scans. */
+    template<typename KeyType, typename ValueType>
+    class MappedMap {
+    public:
+        static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+                      "Mapped maps hold trivially copyable keys and values only");
+
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using const_reference = std::pair<const key_type&, const mapped_type&>;
+        using reference = const_reference;
+        using const_iterator = MappedIterator<key_type, mapped_type>;
+        using iterator = const_iterator;
+
+        explicit MappedMap(const std::string& pPath) : mFile(pPath) {
+            const MappedHeader& header = mFile.header(MappedLayout::Sorted, sizeof(key_type), sizeof(mapped_type));
+            mSize = header.mSize;
+            mKeys = mFile.section<key_type>(header.mKeys);
+            mValues = mFile.section<mapped_type>(header.mValues);
+        }
+
+        /* Writes the elements of [first, last) to pPath. For repeated keys the last one wins. */
+        template<typename InputIterator>
+        static void write(const std::string& pPath, InputIterator first, InputIterator last) {
+            std::vector<std::pair<key_type, mapped_type>> entries;
+            for (; first != last; ++first)
+                entries.emplace_back((*first).first, (*first).second);
+            std::stable_sort(entries.begin(), entries.end(), [](const std::pair<key_type, mapped_type>& a,
+                                                                 const std::pair<key_type, mapped_type>& b) {
+                return a.first < b.first;
+            });
+
+            std::vector<key_type> keys;
+            std::vector<mapped_type> values;
+            for (auto&& entry : entries) {
+                if (!keys.empty() && !(keys.back() < entry.first)) {
+                    values.back() = entry.second;
+                    continue;
+                }
+                keys.push_back(entry.first);
+                values.push_back(entry.second);
+            }
+
+            MappedHeader header = {};
+            header.mLayout = static_cast<std::uint32_t>(MappedLayout::Sorted);
+            header.mKeySize = sizeof(key_type);
+            header.mValueSize = sizeof(mapped_type);
+            header.mSize = keys.size();
+            MappedFile::write(pPath, header, keys.data(), keys.size() * sizeof(key_type), values.data(),
+                              values.size() * sizeof(mapped_type));
+        }
+
+        bool isEmpty() const {
+            return mSize == 0;
+        }
+
+        size_type getSize() const {
+            return mSize;
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            size_type index = indexOf(key);
+            if (index == mSize)
+                throw std::out_of_range("Key does not exists");
+            return mValues[index];
+        }
+
+        const_iterator find(const key_type& key) const {
+            return iteratorAt(indexOf(key));
+        }
+
+        /* First element whose key is not less than key. */
+        const_iterator lowerBound(const key_type& key) const {
+            return iteratorAt(lowerBoundIndex(key));
+        }
+
+        const_iterator cbegin() const {
+            return iteratorAt(0);
+        }
+
+        const_iterator cend() const {
+            return iteratorAt(mSize);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        MappedFile mFile;
+        size_type mSize;
+        const key_type* mKeys;
+        const mapped_type* mValues;
+
+        const_iterator iteratorAt(size_type pIndex) const {
+            return const_iterator(mKeys, mValues, mSize, pIndex);
+        }
+
+        size_type lowerBoundIndex(const key_type& pKey) const {
+            if (mSize == 0)
+                return 0;
+            const key_type* base = mKeys;
+            size_type length = mSize;
+            while (length > 1) {
+                size_type half = length / 2;
+                base += static_cast<size_type>(base[half - 1] < pKey) * half;
+                length -= half;
+            }
+            return (base - mKeys) + (*base < pKey);
+        }
+
+        size_type indexOf(const key_type& pKey) const {
+            size_type index = lowerBoundIndex(pKey);
+            if (index == mSize || pKey < mKeys[index])
+                return mSize;
+            return index;
+        }
+    };
+
+    /* Unordered mapped map: entries grouped by a hash of the key bytes, one bucket per entry on average.
+     * A lookup reads a bucket's offsets and compares the keys of that bucket only. Iterates by bucket. */
+    template<typename KeyType, typename ValueType>
+    class MappedHashMap {
+    public:
+        static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value,
+                      "Mapped maps hold trivially copyable keys and values only");
+
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using const_reference = std::pair<const key_type&, const mapped_type&>;
+        using reference = const_reference;
+        using const_iterator = MappedIterator<key_type, mapped_type>;
+        using iterator = const_iterator;
+
+        explicit MappedHashMap(const std::string& pPath) : mFile(pPath) {
+            const MappedHeader& header = mFile.header(MappedLayout::Hashed, sizeof(key_type), sizeof(mapped_type));
+            mSize = header.mSize;
+            mBucketCount = header.mBucketCount;
+            mKeys = mFile.section<key_type>(header.mKeys);
+            mValues = mFile.section<mapped_type>(header.mValues);
+            mBuckets = mFile.section<std::uint64_t>(header.mBuckets);
+            if (mBucketCount == 0 || mBuckets[mBucketCount] != mSize)
+                throw std::runtime_error("Mapped map file is truncated or corrupt");
+        }
+
+        /* Writes the elements of [first, last) to pPath. For repeated keys the last one wins. */
+        template<typename InputIterator>
+        static void write(const std::string& pPath, InputIterator first, InputIterator last) {
+            std::vector<std::pair<std::uint64_t, std::pair<key_type, mapped_type>>> entries;
+            for (; first != last; ++first)
+                entries.emplace_back(0, std::make_pair((*first).first, (*first).second));
+            std::uint64_t bucketCount = std::max<std::uint64_t>(1, entries.size());
+            for (auto&& entry : entries)
+                entry.first = reduce(hashBytes(entry.second.first), bucketCount);
+            std::stable_sort(entries.begin(), entries.end(),
+                             [](const std::pair<std::uint64_t, std::pair<key_type, mapped_type>>& a,
+                                const std::pair<std::uint64_t, std::pair<key_type, mapped_type>>& b) {
+                                 return a.first < b.first;
+                             });
+
+            std::vector<key_type> keys;
+            std::vector<mapped_type> values;
+            std::vector<std::uint64_t> buckets(bucketCount + 1, 0);
+            size_type bucketStart = 0;
+            for (size_type i = 0; i < entries.size(); ++i) {
+                if (i > 0 && entries[i].first != entries[i - 1].first)
+                    bucketStart = keys.size();
+                auto duplicate = std::find(keys.begin() + bucketStart, keys.end(), entries[i].second.first);
+                if (duplicate != keys.end()) {
+                    values[duplicate - keys.begin()] = entries[i].second.second;
+                    continue;
+                }
+                keys.push_back(entries[i].second.first);
+                values.push_back(entries[i].second.second);
+                ++buckets[entries[i].first + 1];
+            }
+            for (size_type b = 0; b < bucketCount; ++b)
+                buckets[b + 1] += buckets[b];
+
+            MappedHeader header = {};
+            header.mLayout = static_cast<std::uint32_t>(MappedLayout::Hashed);
+            header.mKeySize = sizeof(key_type);
+            header.mValueSize = sizeof(mapped_type);
+            header.mSize = keys.size();
+            header.mBucketCount = bucketCount;
+            MappedFile::write(pPath, header, keys.data(), keys.size() * sizeof(key_type), values.data(),
+                              values.size() * sizeof(mapped_type), buckets.data(),
+                              buckets.size() * sizeof(std::uint64_t));
+        }
+
+        bool isEmpty() const {
+            return mSize == 0;
+        }
+
+        size_type getSize() const {
+            return mSize;
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            size_type index = indexOf(key);
+            if (index == mSize)
+                throw std::out_of_range("Key does not exists");
+            return mValues[index];
+        }
+
+        const_iterator find(const key_type& key) const {
+            return const_iterator(mKeys, mValues, mSize, indexOf(key));
+        }
+
+        const_iterator cbegin() const {
+            return const_iterator(mKeys, mValues, mSize, 0);
+        }
+
+        const_iterator cend() const {
+            return const_iterator(mKeys, mValues, mSize, mSize);
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        MappedFile mFile;
+        size_type mSize;
+        std::uint64_t mBucketCount;
+        const key_type* mKeys;
+        const mapped_type* mValues;
+        const std::uint64_t* mBuckets;
+
+        /* Depends on the bytes only, not on std::hash, so every process and build agrees on it. */
+        static std::uint64_t hashBytes(const key_type& pKey) {
+            const char* bytes = reinterpret_cast<const char*>(&pKey);
+            std::uint64_t hash = sizeof(key_type);
+            for (size_type offset = 0; offset < sizeof(key_type); offset += 8) {
+                std::uint64_t word = 0;
+                std::memcpy(&word, bytes + offset, std::min<size_type>(8, sizeof(key_type) - offset));
+                hash = mix64(hash ^ word);
+            }
+            return hash;
+        }
+
+        size_type indexOf(const key_type& pKey) const {
+            std::uint64_t bucket = reduce(hashBytes(pKey), mBucketCount);
+            for (std::uint64_t i = mBuckets[bucket]; i < mBuckets[bucket + 1]; ++i)
+                if (mKeys[i] == pKey)
+                    return i;
+            return mSize;
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_MAPPEDMAP_H */
@@ -0,0 +1,137 @@
+#ifndef AISDI_MAPS_PARALLELBENCHMARK_H
+#define AISDI_MAPS_PARALLELBENCHMARK_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Benchmark.h"
+
+namespace bm {
+
+    /* Benchmarks sweeping thread counts instead of collection sizes. For every case T the untimed setup
+     * builds the shared state, then T threads (pinned to consecutive CPUs) are released together and run
+     * the worker, which returns the number of operations it performed. The reported time is the wall time
+     * from the release to the last thread finishing, with counters:
+     *  - ops/s     aggregate throughput,
+     *  - fairness  Jain's index of per-thread throughput (1 - perfectly fair, 1/T - one thread did all),
+     *  - min/max   slowest to fastest thread throughput ratio. */
+    class ParallelBenchmark {
+    public:
+        using Setup = std::function<void(int)>;
+        using Worker = std::function<std::size_t(int, int)>;
+        using Teardown = std::function<void()>;
+
+        static Benchmark create(std::string pName, Setup pSetup, Worker pWorker, Teardown pTeardown,
+                                std::vector<int> pThreads, bool pPin = true) {
+            return Benchmark::measured(pName, [pSetup, pWorker, pTeardown, pPin](int pCount, Benchmark::Counters& pCounters) {
+                return measure(pSetup, pWorker, pTeardown, pCount, pPin, pCounters);
+            }, pThreads, "Threads");
+        }
+
+        static Benchmark create(std::string pName, Setup pSetup, Worker pWorker, std::vector<int> pThreads,
+                                bool pPin = true) {
+            return create(pName, pSetup, pWorker, []() {}, pThreads, pPin);
+        }
+
+        /* Thread counts 1, 2, 4... up to the number of hardware threads (inclusive). */
+        static std::vector<int> threadCounts() {
+            int hardware = static_cast<int>(std::thread::hardware_concurrency());
+            std::vector<int> counts;
+            for (int i = 1; i < hardware; i *= 2)
+                counts.push_back(i);
+            counts.push_back(hardware > 0 ? hardware : 1);
+            return counts;
+        }
+
+        static bool pin(std::thread& pThread, int pCpu) {
+#ifdef __linux__
+            int hardware = static_cast<int>(std::thread::hardware_concurrency());
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(hardware > 0 ? pCpu % hardware : 0, &set);
+            return pthread_setaffinity_np(pThread.native_handle(), sizeof(set), &set) == 0;
+#else
+            (void) pThread;
+            (void) pCpu;
+            return false;
+#endif
+        }
+
+    private:
+
+        static double measure(const Setup& pSetup, const Worker& pWorker, const Teardown& pTeardown, int pCount,
+                              bool pPin, Benchmark::Counters& pCounters) {
+            using namespace std::chrono;
+
+            pSetup(pCount);
+
+            std::atomic<int> ready(0);
+            std::atomic<bool> go(false);
+            std::vector<std::size_t> operations(pCount, 0);
+            std::vector<steady_clock::time_point> finished(pCount);
+            std::vector<std::exception_ptr> errors(pCount);
+            std::vector<std::thread> threads;
+
+            for (int t = 0; t < pCount; ++t) {
+                threads.emplace_back([&, t]() {
+                    ++ready;
+                    while (!go.load(std::memory_order_acquire))
+                        std::this_thread::yield();
+                    try {
+                        operations[t] = pWorker(t, pCount);
+                    } catch (...) {
+                        errors[t] = std::current_exception();
+                    }
+                    finished[t] = steady_clock::now();
+                });
+                if (pPin)
+                    pin(threads.back(), t);
+            }
+
+            while (ready.load() != pCount)
+                std::this_thread::yield();
+            steady_clock::time_point start = steady_clock::now();
+            go.store(true, std::memory_order_release);
+
+            for (auto&& thread : threads)
+                thread.join();
+
+            pTeardown();
+            for (auto&& error : errors)
+                if (error)
+                    std::rethrow_exception(error);
+
+            double wall = 0, total = 0, sum = 0, squares = 0, slowest = 0, fastest = 0;
+            for (int t = 0; t < pCount; ++t) {
+                double seconds = duration<double>(finished[t] - start).count();
+                double throughput = seconds > 0 ? operations[t] / seconds : 0;
+                wall = std::max(wall, seconds);
+                total += operations[t];
+                sum += throughput;
+                squares += throughput * throughput;
+                slowest = t == 0 ? throughput : std::min(slowest, throughput);
+                fastest = std::max(fastest, throughput);
+            }
+
+            pCounters["ops"] = total;
+            pCounters["ops/s"] = wall > 0 ? total / wall : 0;
+            pCounters["fairness"] = squares > 0 ? sum * sum / (pCount * squares) : 1;
+            pCounters["min/max"] = fastest > 0 ? slowest / fastest : 1;
+            return wall;
+        }
+    };
+}
+
+#endif /* AISDI_MAPS_PARALLELBENCHMARK_H */
@@ -0,0 +1,377 @@
+#ifndef AISDI_MAPS_PERFECTHASHMAP_H
+#define AISDI_MAPS_PERFECTHASHMAP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Hashing.h"
+
+namespace aisdi {
+
+    /* Immutable map over a minimal perfect hash function, see HashMap::freeze(). Built PtrHash style
+     * (Groot Koerkamp, "PtrHash: Minimal Perfect Hashing at RAM Throughput"): keys are split into buckets of
+     * about Lambda keys and every bucket gets an 8-bit pilot chosen so that its keys land in free slots of
+     * a table of n / Alpha slots. Slots past the last key are remapped into the
+     * holes left before it, so the n entries are stored densely in one array. A lookup reads one pilot byte
+     * (the pilot array is small enough to stay cached), computes the slot and compares one entry.
+     *
+     * Overhead beyond the entries is 8 / Lambda bits per key for pilots plus 32 bits per remapped slot,
+     * about 3 bits per key. Building is expected O(n) but several times slower than filling a HashMap.
+     * Iteration visits entries in slot order. */
+    template<typename KeyType, typename ValueType>
+    class PerfectHashMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using reference = const value_type&;
+        using const_reference = const value_type&;
+
+        class ConstIterator;
+
+        using iterator = ConstIterator;
+        using const_iterator = ConstIterator;
+
+        PerfectHashMap() : mSeed(0), mBucketCount(0), mSlotCount(0) {}
+
+        /* Keys have to be distinct, throws std::invalid_argument otherwise. */
+        template<typename InputIterator>
+        PerfectHashMap(InputIterator first, InputIterator last) : PerfectHashMap() {
+            std::vector<std::pair<key_type, mapped_type>> items;
+            for (; first != last; ++first)
+                items.emplace_back((*first).first, (*first).second);
+            build(items);
+        }
+
+        bool isEmpty() const {
+            return mEntries.empty();
+        }
+
+        size_type getSize() const {
+            return mEntries.size();
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            size_type index = indexOf(key);
+            if (index == mEntries.size())
+                throw std::out_of_range("Not found");
+            return mEntries[index].second;
+        }
+
+        const_iterator find(const key_type& key) const {
+            return ConstIterator(*this, indexOf(key));
+        }
+
+        /* Memory used by the hash function itself, on top of the entries. */
+        double bitsPerKey() const {
+            if (mEntries.empty())
+                return 0;
+            return (8.0 * mPilots.size() + 32.0 * mRemap.size()) / mEntries.size();
+        }
+
+        const_iterator cbegin() const {
+            return ConstIterator(*this, 0);
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(*this, mEntries.size());
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        static constexpr double Lambda = 3.0;
+        static constexpr double Alpha = 0.99;
+        static const int PilotCount = 256;
+        static const int MaxAttempts = 32;
+        static const int RecentCount = 16;
+        static constexpr std::uint32_t Free = std::numeric_limits<std::uint32_t>::max();
+
+        std::vector<value_type> mEntries;
+        std::vector<std::uint8_t> mPilots;
+        std::vector<std::uint32_t> mRemap;
+        std::uint64_t mSeed;
+        std::uint64_t mBucketCount;
+        std::uint64_t mSlotCount;
+
+        std::uint64_t slotOf(std::uint64_t pHash, unsigned pPilot) const {
+            return reduce(mix64(pHash ^ ((pPilot + 1) * 0x9e3779b97f4a7c15ULL)), mSlotCount);
+        }
+
+        size_type indexOf(const key_type& pKey) const {
+            if (mEntries.empty())
+                return 0;
+            std::uint64_t hash = seededHash(pKey, mSeed);
+            std::uint64_t slot = slotOf(hash, mPilots[reduce(hash, mBucketCount)]);
+            if (slot >= mEntries.size())
+                slot = mRemap[slot - mEntries.size()];
+            return mEntries[slot].first == pKey ? slot : mEntries.size();
+        }
+
+        void build(const std::vector<std::pair<key_type, mapped_type>>& pItems) {
+            size_type n = pItems.size();
+            if (n == 0)
+                return;
+            if (n >= Free)
+                throw std::length_error("Too many keys for a PerfectHashMap");
+
+            mBucketCount = static_cast<std::uint64_t>(std::ceil(n / Lambda));
+            mSlotCount = std::max<std::uint64_t>(n, static_cast<std::uint64_t>(std::ceil(n / Alpha)));
+
+            std::vector<std::uint64_t> hashes(n);
+            std::vector<std::uint32_t> owners;
+            for (int attempt = 0; attempt < MaxAttempts; ++attempt) {
+                mSeed = mix64(attempt + 1);
+                for (size_type i = 0; i < n; ++i)
+                    hashes[i] = seededHash(pItems[i].first, mSeed);
+                if (place(hashes, owners)) {
+                    store(pItems, hashes, owners);
+                    return;
+                }
+            }
+            throw std::invalid_argument("Unable to find a perfect hash function, are the keys distinct?");
+        }
+
+        /* Assigns pilots bucket by bucket, largest first. Pilots whose slots are all free are searched for on
+         * a bit per slot, which stays in cache. A bucket that fits nowhere takes the pilot whose slots are held
+         * by the fewest and smallest buckets and evicts them back into the queue; recently placed buckets are
+         * not evicted, which keeps two buckets from taking turns. Fails on keys with equal hashes (a new seed
+         * is needed) or when evictions do not settle. */
+        bool place(const std::vector<std::uint64_t>& pHashes, std::vector<std::uint32_t>& pOwners) {
+            size_type n = pHashes.size();
+            std::vector<std::uint32_t> start(mBucketCount + 1, 0);
+            for (auto&& hash : pHashes)
+                ++start[reduce(hash, mBucketCount) + 1];
+            for (size_type b = 0; b < mBucketCount; ++b)
+                start[b + 1] += start[b];
+            /* Hashes grouped by bucket, so that trying a pilot reads one contiguous run. */
+            std::vector<std::uint64_t> grouped(n);
+            std::vector<std::uint32_t> fill(start.begin(), start.end() - 1);
+            for (auto&& hash : pHashes)
+                grouped[fill[reduce(hash, mBucketCount)]++] = hash;
+
+            std::priority_queue<std::pair<std::uint32_t, std::uint32_t>> queue;
+            for (std::uint32_t b = 0; b < mBucketCount; ++b)
+                if (start[b + 1] > start[b])
+                    queue.push(std::make_pair(start[b + 1] - start[b], b));
+
+            mPilots.assign(mBucketCount, 0);
+            pOwners.assign(mSlotCount, Free);
+            std::vector<bool> taken(mSlotCount, false);
+            std::vector<std::uint64_t> slots;
+            std::uint64_t random = mSeed;
+            size_type evictions = 0, placements = 0;
+            std::uint32_t recent[RecentCount];
+            std::fill(recent, recent + RecentCount, Free);
+
+            while (!queue.empty()) {
+                std::uint32_t bucket = queue.top().second;
+                queue.pop();
+                const std::uint64_t* first = grouped.data() + start[bucket];
+                const std::uint64_t* last = grouped.data() + start[bucket + 1];
+
+                random = mix64(random + 1);
+                int pilot = findFreePilot(first, last, static_cast<unsigned>(random), taken, slots);
+                if (pilot < 0)
+                    pilot = findCheapestPilot(first, last, static_cast<unsigned>(random), taken, pOwners, start,
+                                              recent, slots);
+                if (pilot < 0)
+                    return false;
+
+                mPilots[bucket] = static_cast<std::uint8_t>(pilot);
+                for (const std::uint64_t* hash = first; hash != last; ++hash) {
+                    std::uint64_t slot = slotOf(*hash, mPilots[bucket]);
+                    std::uint32_t evicted = pOwners[slot];
+                    if (evicted != Free) {
+                        for (std::uint32_t e = start[evicted]; e < start[evicted + 1]; ++e) {
+                            std::uint64_t freed = slotOf(grouped[e], mPilots[evicted]);
+                            pOwners[freed] = Free;
+                            taken[freed] = false;
+                        }
+                        queue.push(std::make_pair(start[evicted + 1] - start[evicted], evicted));
+                        if (++evictions > 16 * n + 1024)
+                            return false;
+                    }
+                    pOwners[slot] = bucket;
+                    taken[slot] = true;
+                }
+                recent[placements++ % RecentCount] = bucket;
+            }
+            return true;
+        }
+
+        int findFreePilot(const std::uint64_t* pFirst, const std::uint64_t* pLast, unsigned pOffset,
+                          const std::vector<bool>& pTaken, std::vector<std::uint64_t>& pSlots) const {
+            for (int k = 0; k < PilotCount; ++k) {
+                unsigned pilot = (pOffset + k) % PilotCount;
+                pSlots.clear();
+                const std::uint64_t* hash = pFirst;
+                for (; hash != pLast; ++hash) {
+                    std::uint64_t slot = slotOf(*hash, pilot);
+                    if (pTaken[slot])
+                        break;
+                    pSlots.push_back(slot);
+                }
+                if (hash == pLast && !hasDuplicates(pSlots))
+                    return static_cast<int>(pilot);
+            }
+            return -1;
+        }
+
+        int findCheapestPilot(const std::uint64_t* pFirst, const std::uint64_t* pLast, unsigned pOffset,
+                              const std::vector<bool>& pTaken, const std::vector<std::uint32_t>& pOwners,
+                              const std::vector<std::uint32_t>& pStart, const std::uint32_t* pRecent,
+                              std::vector<std::uint64_t>& pSlots) const {
+            int bestPilot = -1;
+            std::uint64_t bestScore = std::numeric_limits<std::uint64_t>::max();
+            for (int k = 0; k < PilotCount; ++k) {
+                unsigned pilot = (pOffset + k) % PilotCount;
+                pSlots.clear();
+                for (const std::uint64_t* hash = pFirst; hash != pLast; ++hash)
+                    pSlots.push_back(slotOf(*hash, pilot));
+                if (hasDuplicates(pSlots))
+                    continue;
+
+                std::uint64_t score = 0;
+                for (auto&& slot : pSlots) {
+                    if (!pTaken[slot])
+                        continue;
+                    std::uint32_t owner = pOwners[slot];
+                    if (std::find(pRecent, pRecent + RecentCount, owner) != pRecent + RecentCount) {
+                        score = bestScore;
+                        break;
+                    }
+                    std::uint64_t size = pStart[owner + 1] - pStart[owner];
+                    score += size * size;
+                    if (score >= bestScore)
+                        break;
+                }
+                if (score < bestScore) {
+                    bestScore = score;
+                    bestPilot = static_cast<int>(pilot);
+                }
+            }
+            return bestPilot;
+        }
+
+        static bool hasDuplicates(const std::vector<std::uint64_t>& pSlots) {
+            for (size_type i = 1; i < pSlots.size(); ++i)
+                for (size_type j = 0; j < i; ++j)
+                    if (pSlots[i] == pSlots[j])
+                        return true;
+            return false;
+        }
+
+        /* Remaps taken slots past n into free slots before n and lays the entries out densely. */
+        void store(const std::vector<std::pair<key_type, mapped_type>>& pItems,
+                   const std::vector<std::uint64_t>& pHashes, const std::vector<std::uint32_t>& pOwners) {
+            size_type n = pItems.size();
+            mRemap.assign(mSlotCount - n, 0);
+            size_type hole = 0;
+            for (size_type slot = n; slot < mSlotCount; ++slot) {
+                if (pOwners[slot] == Free)
+                    continue;
+                while (pOwners[hole] != Free)
+                    ++hole;
+                mRemap[slot - n] = static_cast<std::uint32_t>(hole++);
+            }
+
+            std::vector<std::uint32_t> order(n);
+            for (size_type i = 0; i < n; ++i) {
+                std::uint64_t slot = slotOf(pHashes[i], mPilots[reduce(pHashes[i], mBucketCount)]);
+                order[slot < n ? slot : mRemap[slot - n]] = static_cast<std::uint32_t>(i);
+            }
+            mEntries.clear();
+            mEntries.reserve(n);
+            for (size_type i = 0; i < n; ++i)
+                mEntries.emplace_back(pItems[order[i]].first, pItems[order[i]].second);
+        }
+    };
+
+    template<typename KeyType, typename ValueType>
+    constexpr double PerfectHashMap<KeyType, ValueType>::Lambda;
+
+    template<typename KeyType, typename ValueType>
+    constexpr double PerfectHashMap<KeyType, ValueType>::Alpha;
+
+    template<typename KeyType, typename ValueType>
+    constexpr std::uint32_t PerfectHashMap<KeyType, ValueType>::Free;
+
+    template<typename KeyType, typename ValueType>
+    class PerfectHashMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename PerfectHashMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename PerfectHashMap::value_type;
+        using pointer = const typename PerfectHashMap::value_type*;
+        using difference_type = std::ptrdiff_t;
+
+        explicit ConstIterator(const PerfectHashMap& pMap, size_type pIndex) : mMap(&pMap), mIndex(pIndex) {}
+
+        ConstIterator& operator++() {
+            if (mIndex >= mMap->mEntries.size())
+                throw std::out_of_range("Incrementing end iterator");
+            ++mIndex;
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            if (mIndex == 0)
+                throw std::out_of_range("Decrementing begin iterator");
+            --mIndex;
+            return *this;
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mIndex >= mMap->mEntries.size())
+                throw std::out_of_range("Dereferencing end iterator");
+            return mMap->mEntries[mIndex];
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return mMap == other.mMap && mIndex == other.mIndex;
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const PerfectHashMap* mMap;
+        size_type mIndex;
+    };
+
+}
+
+#endif /* AISDI_MAPS_PERFECTHASHMAP_H */
@@ -0,0 +1,416 @@
+#ifndef AISDI_MAPS_PERSISTENTTREEMAP_H
+#define AISDI_MAPS_PERSISTENTTREEMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "IntrusivePtr.h"
+
+namespace aisdi {
+
+    /* Ordered map over a persistent AVL tree. Copies share all nodes, so copying - taking a snapshot - is
+     * O(1). An update copies the O(log n) nodes on the path to its key that are still shared with another
+     * version and relinks them; all other nodes stay shared. Nodes referenced by one version only are
+     * updated in place, so a map without live snapshots costs about as much to modify as TreeMap.
+     *
+     * Node reference counts are atomic: a snapshot may be handed to and read by another thread while the
+     * original keeps being written. Taking the snapshot itself has to be synchronized with the writer.
+     * Iterators are invalidated by modifications of the version they came from, never by other versions. */
+    template<typename KeyType, typename ValueType>
+    class PersistentTreeMap {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using value_type = std::pair<const key_type, mapped_type>;
+        using size_type = std::size_t;
+        using reference = const value_type&;
+        using const_reference = const value_type&;
+
+        class ConstIterator;
+
+        using iterator = ConstIterator;
+        using const_iterator = ConstIterator;
+
+        PersistentTreeMap() : mCount(0) {}
+
+        PersistentTreeMap(std::initializer_list<value_type> list) : PersistentTreeMap() {
+            for (auto&& item : list)
+                (*this)[item.first] = item.second;
+        }
+
+        PersistentTreeMap(const PersistentTreeMap& other) = default;
+
+        PersistentTreeMap(PersistentTreeMap&& other) : PersistentTreeMap() {
+            swap(other);
+        }
+
+        PersistentTreeMap& operator=(const PersistentTreeMap& other) = default;
+
+        PersistentTreeMap& operator=(PersistentTreeMap&& other) {
+            swap(other);
+            return *this;
+        }
+
+        /* Same as copying, spelled out for readers. */
+        PersistentTreeMap snapshot() const {
+            return *this;
+        }
+
+        bool isEmpty() const {
+            return mCount == 0;
+        }
+
+        mapped_type& operator[](const key_type& key) {
+            mapped_type* value = nullptr;
+            assign(mRoot, key, value);
+            return *value;
+        }
+
+        const mapped_type& valueOf(const key_type& key) const {
+            const Node* node = findNode(key);
+            if (node == nullptr)
+                throw std::out_of_range("Key does not exists");
+            return node->mPair.second;
+        }
+
+        /* Copies the path to the key if it is shared, like operator[]. */
+        mapped_type& valueOf(const key_type& key) {
+            if (findNode(key) == nullptr)
+                throw std::out_of_range("Key does not exists");
+            return (*this)[key];
+        }
+
+        const_iterator find(const key_type& key) const {
+            ConstIterator it(mRoot.get());
+            for (const Node* node = mRoot.get(); node != nullptr;) {
+                it.mPath.push_back(node);
+                if (key < node->mPair.first)
+                    node = node->mLeft.get();
+                else if (node->mPair.first < key)
+                    node = node->mRight.get();
+                else
+                    return it;
+            }
+            return end();
+        }
+
+        void remove(const key_type& key) {
+            if (findNode(key) == nullptr)
+                throw std::out_of_range("Removing nonexisting element");
+            erase(mRoot, key);
+            --mCount;
+        }
+
+        void remove(const const_iterator& it) {
+            if (it.mPath.empty())
+                throw std::out_of_range("Removing end iterator");
+            remove(it.mPath.back()->mPair.first);
+        }
+
+        size_type getSize() const {
+            return mCount;
+        }
+
+        /* Debug check of key order, balance and cached heights, throws std::logic_error on a violation. */
+        void validate() const {
+            size_type count = 0;
+            validate(mRoot.get(), nullptr, nullptr, count);
+            if (count != mCount)
+                throw std::logic_error("Element count does not match the number of nodes");
+        }
+
+        /* Versions sharing their root are equal without looking further. */
+        bool operator==(const PersistentTreeMap& other) const {
+            if (mCount != other.mCount)
+                return false;
+            if (mRoot.get() == other.mRoot.get())
+                return true;
+            for (auto a = begin(), b = other.begin(); a != end(); ++a, ++b)
+                if (a->first != b->first || a->second != b->second)
+                    return false;
+            return true;
+        }
+
+        bool operator!=(const PersistentTreeMap& other) const {
+            return !(*this == other);
+        }
+
+        const_iterator cbegin() const {
+            ConstIterator it(mRoot.get());
+            for (const Node* node = mRoot.get(); node != nullptr; node = node->mLeft.get())
+                it.mPath.push_back(node);
+            return it;
+        }
+
+        const_iterator cend() const {
+            return ConstIterator(mRoot.get());
+        }
+
+        const_iterator begin() const {
+            return cbegin();
+        }
+
+        const_iterator end() const {
+            return cend();
+        }
+
+    private:
+        struct Node;
+
+        using NodePtr = IntrusivePtr<Node>;
+
+        struct Node {
+            value_type mPair;
+            NodePtr mLeft;
+            NodePtr mRight;
+            int mHeight;
+            std::atomic<size_type> mReferences;
+
+            explicit Node(const key_type& pKey) : mPair(pKey, mapped_type{}), mHeight(1), mReferences(1) {}
+
+            /* Copy for path copying: shares both children. */
+            Node(const Node& other) : mPair(other.mPair), mLeft(other.mLeft), mRight(other.mRight),
+                                      mHeight(other.mHeight), mReferences(1) {}
+        };
+
+        NodePtr mRoot;
+        size_type mCount;
+
+        void swap(PersistentTreeMap& other) {
+            std::swap(mRoot, other.mRoot);
+            std::swap(mCount, other.mCount);
+        }
+
+        const Node* findNode(const key_type& pKey) const {
+            const Node* node = mRoot.get();
+            while (node != nullptr && node->mPair.first != pKey)
+                node = pKey < node->mPair.first ? node->mLeft.get() : node->mRight.get();
+            return node;
+        }
+
+        /* Makes the node in pSlot owned by this version only, copying it if another version shares it. */
+        static Node* unshare(NodePtr& pSlot) {
+            if (!pSlot.unique())
+                pSlot = NodePtr(new Node(*pSlot.get()));
+            return pSlot.get();
+        }
+
+        void assign(NodePtr& pSlot, const key_type& pKey, mapped_type*& pValue) {
+            if (pSlot.get() == nullptr) {
+                pSlot = NodePtr(new Node(pKey));
+                pValue = &pSlot->mPair.second;
+                ++mCount;
+                return;
+            }
+            Node* node = unshare(pSlot);
+            if (pKey < node->mPair.first)
+                assign(node->mLeft, pKey, pValue);
+            else if (node->mPair.first < pKey)
+                assign(node->mRight, pKey, pValue);
+            else {
+                pValue = &node->mPair.second;
+                return;
+            }
+            rebalance(pSlot);
+        }
+
+        static void erase(NodePtr& pSlot, const key_type& pKey) {
+            Node* node = unshare(pSlot);
+            if (pKey < node->mPair.first)
+                erase(node->mLeft, pKey);
+            else if (node->mPair.first < pKey)
+                erase(node->mRight, pKey);
+            else if (node->mLeft.get() == nullptr) {
+                pSlot = NodePtr(std::move(node->mRight));
+                return;
+            } else if (node->mRight.get() == nullptr) {
+                pSlot = NodePtr(std::move(node->mLeft));
+                return;
+            } else {
+                NodePtr successor = removeMin(node->mRight);
+                successor->mLeft = std::move(node->mLeft);
+                successor->mRight = std::move(node->mRight);
+                pSlot = std::move(successor);
+            }
+            rebalance(pSlot);
+        }
+
+        /* Detaches the leftmost node of a non-empty subtree, unshared and with its children cleared. */
+        static NodePtr removeMin(NodePtr& pSlot) {
+            Node* node = unshare(pSlot);
+            if (node->mLeft.get() != nullptr) {
+                NodePtr min = removeMin(node->mLeft);
+                rebalance(pSlot);
+                return min;
+            }
+            NodePtr min = std::move(pSlot);
+            pSlot = std::move(min->mRight);
+            return min;
+        }
+
+        static int height(const NodePtr& pNode) {
+            return pNode.get() == nullptr ? 0 : pNode->mHeight;
+        }
+
+        static void update(Node* pNode) {
+            pNode->mHeight = 1 + std::max(height(pNode->mLeft), height(pNode->mRight));
+        }
+
+        static int balance(const Node* pNode) {
+            return height(pNode->mRight) - height(pNode->mLeft);
+        }
+
+        /* pSlot is already unshared, rotations unshare the child they lift. */
+        static void rebalance(NodePtr& pSlot) {
+            Node* node = pSlot.get();
+            update(node);
+            if (balance(node) == -2) {
+                if (balance(node->mLeft.get()) > 0) {
+                    unshare(node->mLeft);
+                    rotateLeft(node->mLeft);
+                }
+                rotateRight(pSlot);
+            } else if (balance(node) == 2) {
+                if (balance(node->mRight.get()) < 0) {
+                    unshare(node->mRight);
+                    rotateRight(node->mRight);
+                }
+                rotateLeft(pSlot);
+            }
+        }
+
+        static void rotateLeft(NodePtr& pSlot) {
+            unshare(pSlot->mRight);
+            NodePtr right = std::move(pSlot->mRight);
+            pSlot->mRight = std::move(right->mLeft);
+            update(pSlot.get());
+            right->mLeft = std::move(pSlot);
+            update(right.get());
+            pSlot = std::move(right);
+        }
+
+        static void rotateRight(NodePtr& pSlot) {
+            unshare(pSlot->mLeft);
+            NodePtr left = std::move(pSlot->mLeft);
+            pSlot->mLeft = std::move(left->mRight);
+            update(pSlot.get());
+            left->mRight = std::move(pSlot);
+            update(left.get());
+            pSlot = std::move(left);
+        }
+
+        static int validate(const Node* pNode, const key_type* pLower, const key_type* pUpper, size_type& pCount) {
+            if (pNode == nullptr)
+                return 0;
+            ++pCount;
+            if ((pLower != nullptr && !(*pLower < pNode->mPair.first)) ||
+                (pUpper != nullptr && !(pNode->mPair.first < *pUpper)))
+                throw std::logic_error("Keys are out of order");
+            int left = validate(pNode->mLeft.get(), pLower, &pNode->mPair.first, pCount);
+            int right = validate(pNode->mRight.get(), &pNode->mPair.first, pUpper, pCount);
+            if (pNode->mHeight != 1 + std::max(left, right))
+                throw std::logic_error("Stale node height");
+            if (right - left < -1 || right - left > 1)
+                throw std::logic_error("Node is out of balance");
+            return pNode->mHeight;
+        }
+    };
+
+    /* Without parent links the iterator keeps the path from the root to its node; empty means end. */
+    template<typename KeyType, typename ValueType>
+    class PersistentTreeMap<KeyType, ValueType>::ConstIterator {
+    public:
+        using reference = typename PersistentTreeMap::const_reference;
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename PersistentTreeMap::value_type;
+        using pointer = const typename PersistentTreeMap::value_type*;
+        using difference_type = std::ptrdiff_t;
+
+        friend class PersistentTreeMap;
+
+        ConstIterator& operator++() {
+            if (mPath.empty())
+                throw std::out_of_range("Incrementing end iterator");
+            const Node* node = mPath.back();
+            if (node->mRight.get() != nullptr) {
+                for (node = node->mRight.get(); node != nullptr; node = node->mLeft.get())
+                    mPath.push_back(node);
+                return *this;
+            }
+            mPath.pop_back();
+            while (!mPath.empty() && mPath.back()->mRight.get() == node) {
+                node = mPath.back();
+                mPath.pop_back();
+            }
+            return *this;
+        }
+
+        ConstIterator operator++(int) {
+            ConstIterator ret(*this);
+            operator++();
+            return ret;
+        }
+
+        ConstIterator& operator--() {
+            std::vector<const Node*> path(mPath);
+            if (path.empty()) {
+                for (const Node* node = mRoot; node != nullptr; node = node->mRight.get())
+                    path.push_back(node);
+            } else if (path.back()->mLeft.get() != nullptr) {
+                for (const Node* node = path.back()->mLeft.get(); node != nullptr; node = node->mRight.get())
+                    path.push_back(node);
+            } else {
+                const Node* node = path.back();
+                path.pop_back();
+                while (!path.empty() && path.back()->mLeft.get() == node) {
+                    node = path.back();
+                    path.pop_back();
+                }
+            }
+            if (path.empty())
+                throw std::out_of_range("Decrementing begin iterator");
+            mPath.swap(path);
+            return *this;
+        }
+
+        ConstIterator operator--(int) {
+            ConstIterator ret(*this);
+            operator--();
+            return ret;
+        }
+
+        reference operator*() const {
+            if (mPath.empty())
+                throw std::out_of_range("Dereferencing end iterator");
+            return mPath.back()->mPair;
+        }
+
+        pointer operator->() const {
+            return &this->operator*();
+        }
+
+        bool operator==(const ConstIterator& other) const {
+            return mRoot == other.mRoot && (mPath.empty() ? nullptr : mPath.back()) ==
+                                           (other.mPath.empty() ? nullptr : other.mPath.back());
+        }
+
+        bool operator!=(const ConstIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const Node* mRoot;
+        std::vector<const Node*> mPath;
+
+        explicit ConstIterator(const Node* pRoot) : mRoot(pRoot) {}
+    };
+
+}
+
+#endif /* AISDI_MAPS_PERSISTENTTREEMAP_H */
@@ -0,0 +1,262 @@
+#ifndef AISDI_MAPS_SERIALIZATION_H
+#define AISDI_MAPS_SERIALIZATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Hashing.h"
+
+namespace aisdi {
+
+    /* Map files are a header, the containers' own records and a trailing checksum of everything before it:
+     *
+     *     "AISDIMAP" | u32 version | u32 kind | u64 size | u64 parameter | records... | u64 checksum
+     *
+     * Numbers are stored little-endian as on every platform we build for - files are meant to be reloaded
+     * by the same build, not exchanged. The parameter is container specific (HashMap stores its bucket
+     * count). Corrupt, truncated or foreign files make load() throw std::runtime_error. */
+    enum class MapKind : std::uint32_t {
+        HashMap = 1,
+        TreeMap = 2
+    };
+
+    /* Order-sensitive 64-bit checksum fed with arbitrary chunks; eight bytes cost one mix64(), so it keeps
+     * up with memory bandwidth rather than with a byte at a time. */
+    class Checksum {
+    public:
+        Checksum() : mState(0x243f6a8885a308d3ULL), mPending(0), mPendingSize(0), mLength(0) {}
+
+        void update(const char* pData, std::size_t pSize) {
+            mLength += pSize;
+            while (pSize > 0 && mPendingSize != 0) {
+                mPending |= static_cast<std::uint64_t>(static_cast<unsigned char>(*pData++)) << (8 * mPendingSize);
+                --pSize;
+                if (++mPendingSize == 8)
+                    flushPending();
+            }
+            for (; pSize >= 8; pData += 8, pSize -= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, pData, 8);
+                mState = mix64(mState ^ word) + 0x9e3779b97f4a7c15ULL;
+            }
+            for (; pSize > 0; --pSize)
+                mPending |= static_cast<std::uint64_t>(static_cast<unsigned char>(*pData++)) << (8 * mPendingSize++);
+        }
+
+        std::uint64_t value() const {
+            return mix64(mState ^ mPending ^ mLength);
+        }
+
+    private:
+        std::uint64_t mState;
+        std::uint64_t mPending;
+        int mPendingSize;
+        std::uint64_t mLength;
+
+        void flushPending() {
+            mState = mix64(mState ^ mPending) + 0x9e3779b97f4a7c15ULL;
+            mPending = 0;
+            mPendingSize = 0;
+        }
+    };
+
+    /* Buffered writer checksumming what passes through it. finish() appends the checksum and flushes. */
+    class BinaryWriter {
+    public:
+        explicit BinaryWriter(std::ostream& pOut) : mOut(pOut) {
+            mBuffer.reserve(BufferSize);
+        }
+
+        void write(const void* pData, std::size_t pSize) {
+            const char* data = static_cast<const char*>(pData);
+            if (mBuffer.size() + pSize > BufferSize)
+                flush();
+            if (pSize >= BufferSize) {
+                put(data, pSize);
+                return;
+            }
+            mBuffer.insert(mBuffer.end(), data, data + pSize);
+        }
+
+        template<typename T>
+        void writeValue(const T& pValue) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are written raw");
+            write(&pValue, sizeof(T));
+        }
+
+        void finish() {
+            flush();
+            std::uint64_t checksum = mChecksum.value();
+            mOut.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+            mOut.flush();
+            if (!mOut)
+                throw std::runtime_error("Writing map failed");
+        }
+
+    private:
+        static const std::size_t BufferSize = 64 * 1024;
+
+        std::ostream& mOut;
+        std::vector<char> mBuffer;
+        Checksum mChecksum;
+
+        void flush() {
+            put(mBuffer.data(), mBuffer.size());
+            mBuffer.clear();
+        }
+
+        void put(const char* pData, std::size_t pSize) {
+            mChecksum.update(pData, pSize);
+            mOut.write(pData, pSize);
+            if (!mOut)
+                throw std::runtime_error("Writing map failed");
+        }
+    };
+
+    /* Counterpart of BinaryWriter. finish() reads the trailing checksum and compares it. */
+    class BinaryReader {
+    public:
+        explicit BinaryReader(std::istream& pIn) : mIn(pIn), mPosition(0) {}
+
+        void read(void* pData, std::size_t pSize) {
+            char* data = static_cast<char*>(pData);
+            while (pSize > 0) {
+                if (mPosition == mBuffer.size())
+                    fill();
+                std::size_t chunk = std::min(pSize, mBuffer.size() - mPosition);
+                std::memcpy(data, mBuffer.data() + mPosition, chunk);
+                mPosition += chunk;
+                data += chunk;
+                pSize -= chunk;
+            }
+        }
+
+        template<typename T>
+        T readValue() {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are read raw");
+            T value;
+            read(&value, sizeof(T));
+            return value;
+        }
+
+        void finish() {
+            mChecksum.update(mBuffer.data(), mPosition);
+            std::uint64_t expected = mChecksum.value();
+            /* The checksum itself may already sit in the buffer. */
+            mBuffer.erase(mBuffer.begin(), mBuffer.begin() + mPosition);
+            mPosition = 0;
+            std::uint64_t stored;
+            char* data = reinterpret_cast<char*>(&stored);
+            std::size_t have = std::min(mBuffer.size(), sizeof(stored));
+            std::memcpy(data, mBuffer.data(), have);
+            mIn.read(data + have, sizeof(stored) - have);
+            if (mIn.gcount() != static_cast<std::streamsize>(sizeof(stored) - have))
+                throw std::runtime_error("Map file is truncated");
+            if (stored != expected)
+                throw std::runtime_error("Map file checksum mismatch");
+            /* Give back what was read ahead, so that whatever follows the map in the stream can be read. */
+            std::size_t ahead = mBuffer.size() - have;
+            if (ahead > 0) {
+                mIn.clear();
+                mIn.seekg(-static_cast<std::streamoff>(ahead), std::ios_base::cur);
+            }
+        }
+
+    private:
+        static const std::size_t BufferSize = 64 * 1024;
+
+        std::istream& mIn;
+        std::vector<char> mBuffer;
+        std::size_t mPosition;
+        Checksum mChecksum;
+
+        void fill() {
+            mChecksum.update(mBuffer.data(), mBuffer.size());
+            mBuffer.resize(BufferSize);
+            mIn.read(mBuffer.data(), BufferSize);
+            mBuffer.resize(static_cast<std::size_t>(mIn.gcount()));
+            mPosition = 0;
+            if (mBuffer.empty())
+                throw std::runtime_error("Map file is truncated");
+        }
+    };
+
+    /* How keys and values are written. Trivially copyable types are copied raw; specialize for others. */
+    template<typename T, typename Enable = void>
+    struct Serializer {
+        static_assert(std::is_trivially_copyable<T>::value, "Specialize aisdi::Serializer for this type");
+
+        static void write(BinaryWriter& pWriter, const T& pValue) {
+            pWriter.writeValue(pValue);
+        }
+
+        static T read(BinaryReader& pReader) {
+            return pReader.readValue<T>();
+        }
+    };
+
+    template<>
+    struct Serializer<std::string> {
+        static void write(BinaryWriter& pWriter, const std::string& pValue) {
+            pWriter.writeValue(static_cast<std::uint64_t>(pValue.size()));
+            pWriter.write(pValue.data(), pValue.size());
+        }
+
+        /* Grows chunk by chunk, a corrupt length fails on the end of the file instead of allocating it. */
+        static std::string read(BinaryReader& pReader) {
+            std::uint64_t size = pReader.readValue<std::uint64_t>();
+            std::string value;
+            while (value.size() < size) {
+                std::size_t offset = value.size();
+                value.resize(offset + std::min<std::uint64_t>(size - offset, 64 * 1024));
+                pReader.read(&value[offset], value.size() - offset);
+            }
+            return value;
+        }
+    };
+
+    struct MapHeader {
+        MapKind mKind;
+        std::uint64_t mSize;
+        std::uint64_t mParameter;
+    };
+
+    enum : std::uint32_t {
+        MapFormatVersion = 2
+    };
+
+    inline void writeHeader(BinaryWriter& pWriter, const MapHeader& pHeader) {
+        pWriter.write("AISDIMAP", 8);
+        pWriter.writeValue<std::uint32_t>(MapFormatVersion);
+        pWriter.writeValue(static_cast<std::uint32_t>(pHeader.mKind));
+        pWriter.writeValue(pHeader.mSize);
+        pWriter.writeValue(pHeader.mParameter);
+    }
+
+    inline MapHeader readHeader(BinaryReader& pReader, MapKind pExpected) {
+        char magic[8];
+        pReader.read(magic, sizeof(magic));
+        if (std::memcmp(magic, "AISDIMAP", sizeof(magic)) != 0)
+            throw std::runtime_error("Not a map file");
+        if (pReader.readValue<std::uint32_t>() != MapFormatVersion)
+            throw std::runtime_error("Unsupported map file version");
+        MapHeader header;
+        header.mKind = static_cast<MapKind>(pReader.readValue<std::uint32_t>());
+        if (header.mKind != pExpected)
+            throw std::runtime_error("Map file holds a different container");
+        header.mSize = pReader.readValue<std::uint64_t>();
+        header.mParameter = pReader.readValue<std::uint64_t>();
+        return header;
+    }
+
+}
+
+#endif /* AISDI_MAPS_SERIALIZATION_H */
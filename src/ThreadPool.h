@@ -0,0 +1,331 @@
+#ifndef AISDI_MAPS_THREADPOOL_H
+#define AISDI_MAPS_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "WorkStealingDeque.h"
+
+namespace aisdi {
+
+    /* Work-stealing scheduler for the parallel operations of the maps. Every worker has a WorkStealingDeque
+     * of tasks: join() pushes one branch on the deque of the calling worker and runs the other, idle workers
+     * steal from the top of other deques, so they take the oldest - largest - branches. Workers that find
+     * nothing to steal for a while park on a condition variable until a task is pushed. Threads outside
+     * the pool hand their work to it and wait. */
+    class ThreadPool {
+    public:
+        using size_type = std::size_t;
+
+        /* Starts pThreads workers, one per hardware thread for 0. A pool of one thread starts none and runs
+         * everything on the caller. */
+        explicit ThreadPool(size_type pThreads = 0) : mInjectedCount(0), mSleeping(0), mEpoch(0), mStopping(false) {
+            if (pThreads == 0)
+                pThreads = std::max(1u, std::thread::hardware_concurrency());
+            if (pThreads == 1)
+                return;
+            for (size_type i = 0; i < pThreads; ++i)
+                mWorkers.emplace_back(new Worker(i));
+            for (auto&& worker : mWorkers) {
+                Worker* self = worker.get();
+                worker->mThread = std::thread([this, self]() {
+                    workerMain(*self);
+                });
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                mStopping = true;
+                ++mEpoch;
+            }
+            mWake.notify_all();
+            for (auto&& worker : mWorkers)
+                worker->mThread.join();
+        }
+
+        /* Pool with one thread per hardware thread, used when no other is given. */
+        static ThreadPool& shared() {
+            static ThreadPool pool;
+            return pool;
+        }
+
+        size_type getSize() const {
+            return std::max<size_type>(1, mWorkers.size());
+        }
+
+        /* Runs pLeft() and pRight(), possibly in parallel, and returns once both are done, rethrowing the
+         * exception of pLeft or else of pRight. On a worker pRight waits on its deque while pLeft runs; if
+         * it was stolen by then the worker runs other tasks until the thief is done with it. */
+        template<typename Left, typename Right>
+        void join(Left&& pLeft, Right&& pRight) {
+            Worker* worker = current().mPool == this ? current().mWorker : nullptr;
+            if (worker == nullptr) {
+                if (mWorkers.empty()) {
+                    std::exception_ptr error, rightError;
+                    try {
+                        pLeft();
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    try {
+                        pRight();
+                    } catch (...) {
+                        rightError = std::current_exception();
+                    }
+                    if (error)
+                        std::rethrow_exception(error);
+                    if (rightError)
+                        std::rethrow_exception(rightError);
+                    return;
+                }
+                auto both = [&]() {
+                    join(pLeft, pRight);
+                };
+                submit(both);
+                return;
+            }
+
+            FunctionTask<typename std::remove_reference<Right>::type> right(pRight);
+            worker->mDeque.push(&right);
+            wake();
+            std::exception_ptr error;
+            try {
+                pLeft();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            if (worker->mDeque.pop() == &right)
+                right.perform();
+            else
+                while (!right.mDone.load(std::memory_order_acquire)) {
+                    if (Task* task = findTask(*worker))
+                        task->perform();
+                    else
+                        std::this_thread::yield();
+                }
+            if (error)
+                std::rethrow_exception(error);
+            if (right.mError)
+                std::rethrow_exception(right.mError);
+        }
+
+        /* Calls pBody(0) ... pBody(pTasks - 1), halving the range with join(). */
+        template<typename Function>
+        void run(size_type pTasks, const Function& pBody) {
+            runRange(0, pTasks, pBody);
+        }
+
+    private:
+        struct Task {
+            Task() : mDone(false) {}
+
+            virtual ~Task() {}
+
+            void perform() {
+                try {
+                    execute();
+                } catch (...) {
+                    mError = std::current_exception();
+                }
+                complete();
+            }
+
+            virtual void execute() = 0;
+
+            virtual void complete() {
+                mDone.store(true, std::memory_order_release);
+            }
+
+            std::atomic<bool> mDone;
+            std::exception_ptr mError;
+        };
+
+        template<typename Function>
+        struct FunctionTask : Task {
+            explicit FunctionTask(Function& pFunction) : mFunction(pFunction) {}
+
+            void execute() override {
+                mFunction();
+            }
+
+            Function& mFunction;
+        };
+
+        /* Work of a thread outside the pool, which waits for it on mFinished. */
+        template<typename Function>
+        struct SubmittedTask : FunctionTask<Function> {
+            SubmittedTask(ThreadPool& pPool, Function& pFunction) : FunctionTask<Function>(pFunction), mPool(pPool) {}
+
+            void complete() override {
+                std::lock_guard<std::mutex> lock(mPool.mLock);
+                this->mDone.store(true, std::memory_order_release);
+                mPool.mFinished.notify_all();
+            }
+
+            ThreadPool& mPool;
+        };
+
+        struct Worker {
+            explicit Worker(size_type pIndex) : mRandom(pIndex * 0x9e3779b97f4a7c15ULL + 1) {}
+
+            WorkStealingDeque<Task> mDeque;
+            /* xorshift state picking the first victim of a steal, used by the owner only. */
+            std::uint64_t mRandom;
+            std::thread mThread;
+        };
+
+        struct Current {
+            ThreadPool* mPool;
+            Worker* mWorker;
+        };
+
+        /* Rounds of failed steals, each followed by a yield, before a worker parks. */
+        static const size_type SpinRounds = 64;
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::mutex mLock;
+        /* Parked workers wait for mEpoch to change, a pusher bumps it only when mSleeping says someone may
+         * be parked. A worker counts itself in mSleeping before checking the deques one last time. */
+        std::condition_variable mWake;
+        std::condition_variable mFinished;
+        std::deque<Task*> mInjected;
+        std::atomic<size_type> mInjectedCount;
+        std::atomic<size_type> mSleeping;
+        size_type mEpoch;
+        bool mStopping;
+
+        static Current& current() {
+            static thread_local Current current{nullptr, nullptr};
+            return current;
+        }
+
+        template<typename Function>
+        void runRange(size_type pBegin, size_type pEnd, const Function& pBody) {
+            if (pEnd - pBegin <= 1) {
+                if (pBegin < pEnd)
+                    pBody(pBegin);
+                return;
+            }
+            size_type middle = pBegin + (pEnd - pBegin) / 2;
+            join([&]() {
+                runRange(pBegin, middle, pBody);
+            }, [&]() {
+                runRange(middle, pEnd, pBody);
+            });
+        }
+
+        template<typename Function>
+        void submit(Function& pFunction) {
+            SubmittedTask<Function> task(*this, pFunction);
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                mInjected.push_back(&task);
+                mInjectedCount.fetch_add(1, std::memory_order_seq_cst);
+            }
+            wake();
+            {
+                std::unique_lock<std::mutex> lock(mLock);
+                mFinished.wait(lock, [&task]() {
+                    return task.mDone.load(std::memory_order_acquire);
+                });
+            }
+            if (task.mError)
+                std::rethrow_exception(task.mError);
+        }
+
+        void wake() {
+            if (mSleeping.load(std::memory_order_seq_cst) == 0)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                ++mEpoch;
+            }
+            mWake.notify_one();
+        }
+
+        /* Own deque first, then submitted work, then the other deques from a random one on. */
+        Task* findTask(Worker& pWorker) {
+            if (Task* task = pWorker.mDeque.pop())
+                return task;
+            if (mInjectedCount.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lock(mLock);
+                if (!mInjected.empty()) {
+                    Task* task = mInjected.front();
+                    mInjected.pop_front();
+                    mInjectedCount.fetch_sub(1, std::memory_order_seq_cst);
+                    return task;
+                }
+            }
+            pWorker.mRandom ^= pWorker.mRandom << 13;
+            pWorker.mRandom ^= pWorker.mRandom >> 7;
+            pWorker.mRandom ^= pWorker.mRandom << 17;
+            size_type first = pWorker.mRandom % mWorkers.size();
+            for (size_type i = 0; i < mWorkers.size(); ++i) {
+                Worker& victim = *mWorkers[(first + i) % mWorkers.size()];
+                if (&victim == &pWorker)
+                    continue;
+                if (Task* task = victim.mDeque.steal())
+                    return task;
+            }
+            return nullptr;
+        }
+
+        /* Called with mLock held. */
+        bool hasWork() const {
+            if (!mInjected.empty())
+                return true;
+            for (auto&& worker : mWorkers)
+                if (!worker->mDeque.isEmpty())
+                    return true;
+            return false;
+        }
+
+        void workerMain(Worker& pWorker) {
+            current() = Current{this, &pWorker};
+            size_type idle = 0;
+            while (true) {
+                if (Task* task = findTask(pWorker)) {
+                    task->perform();
+                    idle = 0;
+                    continue;
+                }
+                if (++idle < SpinRounds) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                idle = 0;
+                std::unique_lock<std::mutex> lock(mLock);
+                if (mStopping)
+                    return;
+                size_type epoch = mEpoch;
+                mSleeping.fetch_add(1, std::memory_order_seq_cst);
+                if (!hasWork())
+                    mWake.wait(lock, [this, epoch]() {
+                        return mEpoch != epoch;
+                    });
+                mSleeping.fetch_sub(1, std::memory_order_seq_cst);
+                if (mStopping)
+                    return;
+            }
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_THREADPOOL_H */
@@ -0,0 +1,338 @@
+#ifndef AISDI_MAPS_TINYLFUCACHE_H
+#define AISDI_MAPS_TINYLFUCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "HashMap.h"
+#include "LruCache.h"
+
+namespace aisdi {
+
+    /* Count-min sketch of 4 rows of saturating 4-bit counters (stored in bytes), each row 4 counters per
+     * expected entry. After a sample of 10 increments per expected entry every counter is halved, so the
+     * estimate follows recent popularity. */
+    template<typename KeyType>
+    class FrequencySketch {
+    public:
+        explicit FrequencySketch(std::size_t pExpectedEntries) : mSize(0) {
+            std::size_t width = 64;
+            while (width < 4 * pExpectedEntries)
+                width *= 2;
+            mMask = width - 1;
+            mSampleSize = 10 * (pExpectedEntries > 0 ? pExpectedEntries : 1);
+            mCounters.assign(Depth * width, 0);
+        }
+
+        void increment(const KeyType& pKey) {
+            std::uint64_t hash = std::hash<KeyType>{}(pKey);
+            bool added = false;
+            for (std::size_t row = 0; row < Depth; ++row) {
+                std::uint8_t& counter = mCounters[index(hash, row)];
+                if (counter < MaxCount) {
+                    ++counter;
+                    added = true;
+                }
+            }
+            if (added && ++mSize == mSampleSize)
+                age();
+        }
+
+        unsigned frequency(const KeyType& pKey) const {
+            std::uint64_t hash = std::hash<KeyType>{}(pKey);
+            unsigned result = MaxCount;
+            for (std::size_t row = 0; row < Depth; ++row) {
+                unsigned counter = mCounters[index(hash, row)];
+                result = counter < result ? counter : result;
+            }
+            return result;
+        }
+
+    private:
+        static const std::size_t Depth = 4;
+        static const std::uint8_t MaxCount = 15;
+
+        std::vector<std::uint8_t> mCounters;
+        std::size_t mMask;
+        std::size_t mSampleSize;
+        std::size_t mSize;
+
+        std::size_t index(std::uint64_t pHash, std::size_t pRow) const {
+            static const std::uint64_t seeds[Depth] = {
+                    0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL
+            };
+            std::uint64_t h = (pHash + seeds[pRow]) * 0xbf58476d1ce4e5b9ULL;
+            h ^= h >> 31;
+            return pRow * (mMask + 1) + (h & mMask);
+        }
+
+        void age() {
+            for (auto&& counter : mCounters)
+                counter >>= 1;
+            mSize /= 2;
+        }
+    };
+
+    /* W-TinyLFU cache (Einziger et al., "TinyLFU: A Highly Efficient Cache Admission Policy"). New entries
+     * land in a small LRU window (1% of the capacity); entries leaving the window compete for a place in
+     * the main segmented LRU with its eviction victim, and only the one accessed more often according to
+     * a FrequencySketch stays. The main region keeps 80% of its capacity for entries hit at least twice
+     * (protected) and the rest for entries on probation. Scan and one-hit-wonder resistant, with the same
+     * interface, weighing and O(1) operations as LruCache. */
+    template<typename KeyType, typename ValueType>
+    class TinyLfuCache {
+    public:
+        using key_type = KeyType;
+        using mapped_type = ValueType;
+        using size_type = std::size_t;
+        using Weigher = std::function<size_type(const key_type&, const mapped_type&)>;
+
+        /* pBuckets == 0 sizes the table and the sketch for pCapacity unit-weight entries. */
+        explicit TinyLfuCache(size_type pCapacity, Weigher pWeigher = nullptr, size_type pBuckets = 0)
+                : mIndex(pBuckets > 0 ? pBuckets : defaultBuckets(pCapacity)),
+                  mSketch(pBuckets > 0 ? pBuckets : defaultBuckets(pCapacity)),
+                  mWeigher(pWeigher), mCapacity(pCapacity), mStatistics{0, 0, 0} {
+            if (pCapacity == 0)
+                throw std::invalid_argument("Cache capacity has to be positive");
+            mWindowCapacity = pCapacity / 100 > 0 ? pCapacity / 100 : 1;
+            mMainCapacity = pCapacity - mWindowCapacity;
+            mProtectedCapacity = mMainCapacity * 4 / 5;
+        }
+
+        TinyLfuCache(const TinyLfuCache&) = delete;
+
+        TinyLfuCache& operator=(const TinyLfuCache&) = delete;
+
+        ~TinyLfuCache() {
+            for (Queue* queue : { &mWindow, &mProbation, &mProtected })
+                while (queue->mHead != nullptr)
+                    destroy(queue->mHead);
+        }
+
+        /* Cached value or nullptr. The pointer is valid until the next put or remove. */
+        const mapped_type* get(const key_type& pKey) {
+            mSketch.increment(pKey);
+            auto it = mIndex.find(pKey);
+            if (it == mIndex.end()) {
+                ++mStatistics.mMisses;
+                return nullptr;
+            }
+            ++mStatistics.mHits;
+            onHit(it->second);
+            return &it->second->mValue;
+        }
+
+        /* Only replacing a cached value counts as an access - inserting is usually the load after a get miss,
+         * which was counted already. */
+        void put(const key_type& pKey, mapped_type pValue) {
+            size_type weight = weigh(pKey, pValue);
+            Node*& slot = mIndex[pKey];
+            if (slot != nullptr) {
+                mSketch.increment(pKey);
+                queueOf(slot).mWeight += weight - slot->mWeight;
+                slot->mValue = std::move(pValue);
+                slot->mWeight = weight;
+                onHit(slot);
+            } else {
+                try {
+                    slot = new Node(pKey, std::move(pValue), weight);
+                } catch (...) {
+                    mIndex.remove(pKey);
+                    throw;
+                }
+                mWindow.pushBack(slot);
+            }
+            evict();
+        }
+
+        bool contains(const key_type& pKey) const {
+            return mIndex.find(pKey) != mIndex.end();
+        }
+
+        bool remove(const key_type& pKey) {
+            auto it = mIndex.find(pKey);
+            if (it == mIndex.end())
+                return false;
+            destroy(it->second);
+            return true;
+        }
+
+        bool isEmpty() const {
+            return mIndex.isEmpty();
+        }
+
+        size_type getSize() const {
+            return mIndex.getSize();
+        }
+
+        size_type getWeight() const {
+            return mWindow.mWeight + mProbation.mWeight + mProtected.mWeight;
+        }
+
+        size_type getCapacity() const {
+            return mCapacity;
+        }
+
+        /* Estimated recent access count of pKey, saturates at 15. */
+        unsigned frequency(const key_type& pKey) const {
+            return mSketch.frequency(pKey);
+        }
+
+        const CacheStatistics& stats() const {
+            return mStatistics;
+        }
+
+        void resetStats() {
+            mStatistics = CacheStatistics{0, 0, 0};
+        }
+
+    private:
+        enum class Region : std::uint8_t {
+            Window, Probation, Protected
+        };
+
+        struct Node {
+            key_type mKey;
+            mapped_type mValue;
+            size_type mWeight;
+            Region mRegion;
+            Node* mPrev;
+            Node* mNext;
+
+            Node(const key_type& pKey, mapped_type pValue, size_type pWeight)
+                    : mKey(pKey), mValue(std::move(pValue)), mWeight(pWeight), mRegion(Region::Window),
+                      mPrev(nullptr), mNext(nullptr) {}
+        };
+
+        /* Intrusive LRU list, front is the least recently used node. */
+        struct Queue {
+            Region mRegion;
+            Node* mHead;
+            Node* mTail;
+            size_type mWeight;
+
+            explicit Queue(Region pRegion) : mRegion(pRegion), mHead(nullptr), mTail(nullptr), mWeight(0) {}
+
+            void pushBack(Node* pNode) {
+                pNode->mRegion = mRegion;
+                pNode->mPrev = mTail;
+                pNode->mNext = nullptr;
+                if (mTail != nullptr)
+                    mTail->mNext = pNode;
+                else
+                    mHead = pNode;
+                mTail = pNode;
+                mWeight += pNode->mWeight;
+            }
+
+            void unlink(Node* pNode) {
+                if (pNode->mPrev != nullptr)
+                    pNode->mPrev->mNext = pNode->mNext;
+                else
+                    mHead = pNode->mNext;
+                if (pNode->mNext != nullptr)
+                    pNode->mNext->mPrev = pNode->mPrev;
+                else
+                    mTail = pNode->mPrev;
+                mWeight -= pNode->mWeight;
+            }
+        };
+
+        HashMap<key_type, Node*> mIndex;
+        FrequencySketch<key_type> mSketch;
+        Weigher mWeigher;
+        size_type mCapacity;
+        size_type mWindowCapacity;
+        size_type mMainCapacity;
+        size_type mProtectedCapacity;
+        Queue mWindow{Region::Window};
+        Queue mProbation{Region::Probation};
+        Queue mProtected{Region::Protected};
+        CacheStatistics mStatistics;
+
+        static size_type defaultBuckets(size_type pCapacity) {
+            return pCapacity < 16 ? 16 : (pCapacity > (1u << 20) ? (1u << 20) : pCapacity);
+        }
+
+        size_type weigh(const key_type& pKey, const mapped_type& pValue) const {
+            return mWeigher ? mWeigher(pKey, pValue) : 1;
+        }
+
+        Queue& queueOf(Node* pNode) {
+            switch (pNode->mRegion) {
+                case Region::Window:
+                    return mWindow;
+                case Region::Probation:
+                    return mProbation;
+                default:
+                    return mProtected;
+            }
+        }
+
+        void moveTo(Queue& pQueue, Node* pNode) {
+            queueOf(pNode).unlink(pNode);
+            pQueue.pushBack(pNode);
+        }
+
+        /* A second hit on probation promotes to protected, overflowing protected entries get demoted. */
+        void onHit(Node* pNode) {
+            if (pNode->mRegion == Region::Probation) {
+                moveTo(mProtected, pNode);
+                while (mProtected.mWeight > mProtectedCapacity && mProtected.mHead != pNode)
+                    moveTo(mProbation, mProtected.mHead);
+            } else {
+                moveTo(queueOf(pNode), pNode);
+            }
+        }
+
+        size_type mainWeight() const {
+            return mProbation.mWeight + mProtected.mWeight;
+        }
+
+        Node* mainVictim() const {
+            return mProbation.mHead != nullptr ? mProbation.mHead : mProtected.mHead;
+        }
+
+        void destroy(Node* pNode) {
+            queueOf(pNode).unlink(pNode);
+            mIndex.remove(pNode->mKey);
+            delete pNode;
+        }
+
+        void evictNode(Node* pNode) {
+            destroy(pNode);
+            ++mStatistics.mEvictions;
+        }
+
+        void evict() {
+            while (mWindow.mWeight > mWindowCapacity) {
+                Node* candidate = mWindow.mHead;
+                if (mainWeight() + candidate->mWeight <= mMainCapacity) {
+                    moveTo(mProbation, candidate);
+                    continue;
+                }
+
+                Node* victim = mainVictim();
+                if (victim != nullptr && candidate->mWeight <= mMainCapacity &&
+                    mSketch.frequency(candidate->mKey) > mSketch.frequency(victim->mKey)) {
+                    while (mainWeight() + candidate->mWeight > mMainCapacity)
+                        evictNode(mainVictim());
+                    moveTo(mProbation, candidate);
+                } else {
+                    evictNode(candidate);
+                }
+            }
+
+            /* Re-weighed main entries can overflow on their own. */
+            while (mainWeight() > mMainCapacity)
+                evictNode(mainVictim());
+        }
+    };
+
+}
+
+#endif /* AISDI_MAPS_TINYLFUCACHE_H */
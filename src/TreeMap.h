@@ -1,11 +1,19 @@
 #ifndef AISDI_MAPS_TREEMAP_H
 #define AISDI_MAPS_TREEMAP_H
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <initializer_list>
+#include <istream>
+#include <ostream>
 #include <stdexcept>
 #include <utility>
 
+#include "FrozenTreeMap.h"
+#include "Serialization.h"
+#include "ThreadPool.h"
+
 namespace aisdi {
 
     template<typename KeyType, typename ValueType>
@@ -27,21 +35,30 @@ namespace aisdi {
         using iterator = Iterator;
         using const_iterator = ConstIterator;
 
-        TreeMap() : mRoot(nullptr), mCount(0) {}
+        /* Shape of the tree, see stats(). Heights count levels - an empty tree has height 0. */
+        struct Statistics {
+            size_type mSize;
+            int mHeight;
+            int mOptimalHeight;
+            double mAverageDepth;
+            size_type mRotations;
+        };
+
+        TreeMap() : mRoot(nullptr), mCount(0), mRotations(0) {}
 
         TreeMap(std::initializer_list<value_type> list) : TreeMap() {
             for (auto&& item : list)
                 insert(item);
         }
 
+        /* Copies the tree node for node, keeping its shape - O(n) without comparisons or rotations. */
         TreeMap(const TreeMap& other) : TreeMap() {
-            for (auto&& item : other)
-                insert(item);
+            mRoot = clone(other.mRoot, nullptr);
+            mCount = other.mCount;
         }
 
         TreeMap(TreeMap&& other) : TreeMap() {
-            std::swap(mRoot, other.mRoot);
-            std::swap(mCount, other.mCount);
+            swap(other);
         }
 
         ~TreeMap() {
@@ -49,20 +66,18 @@ namespace aisdi {
         }
 
         TreeMap& operator=(const TreeMap& other) {
-            if (*this == other)
-                return *this;
-            clear(mRoot);
-            for (auto&& item : other)
-                insert(item);
+            if (this != &other) {
+                TreeMap copy(other);
+                swap(copy);
+            }
             return *this;
         }
 
         TreeMap& operator=(TreeMap&& other) {
-            if (*this == other)
-                return *this;
-            clear(mRoot);
-            std::swap(mRoot, other.mRoot);
-            std::swap(mCount, other.mCount);
+            if (this != &other) {
+                clear(mRoot);
+                swap(other);
+            }
             return *this;
         }
 
@@ -115,16 +130,89 @@ namespace aisdi {
             return mCount;
         }
 
+        Statistics stats() const {
+            Statistics result;
+            result.mSize = mCount;
+            result.mHeight = getHeight(mRoot) + 1;
+            result.mOptimalHeight = 0;
+            while ((size_type(1) << result.mOptimalHeight) <= mCount)
+                ++result.mOptimalHeight;
+            result.mAverageDepth = mCount == 0 ? 0 : depthSum(mRoot, 0) / mCount;
+            result.mRotations = mRotations;
+            return result;
+        }
+
+        /* Debug check of the AVL invariants: key order, balance factors, cached heights, parent links and
+         * the element count. Throws std::logic_error describing the first violation found. */
+        void validate() const {
+            if (mRoot != nullptr && mRoot->mParent != nullptr)
+                throw std::logic_error("Root has a parent");
+            size_type count = 0;
+            validate(mRoot, nullptr, nullptr, count);
+            if (count != mCount)
+                throw std::logic_error("Element count does not match the number of nodes");
+        }
+
+        /* Immutable copy laid out for fast lookups, see FrozenTreeMap. O(n), the map stays usable. */
+        FrozenTreeMap<key_type, mapped_type> freeze() const {
+            return FrozenTreeMap<key_type, mapped_type>(begin(), mCount);
+        }
+
+        /* Calls pFunction on every item on the threads of pPool, forking at both children of every node a few
+         * levels below the root - about SubtreesPerThread subtrees per thread are left to walk serially.
+         * pFunction is called concurrently and may change values but not the map. */
+        template<typename Function>
+        void parallelForEach(Function pFunction, ThreadPool& pPool = ThreadPool::shared()) {
+            forEach(mRoot, forkDepth(pPool), pFunction, pPool);
+        }
+
+        template<typename Function>
+        void parallelForEach(Function pFunction, ThreadPool& pPool = ThreadPool::shared()) const {
+            auto visitor = [&pFunction](const_reference pItem) {
+                pFunction(pItem);
+            };
+            forEach(mRoot, forkDepth(pPool), visitor, pPool);
+        }
+
+        /* Folds pTransform(item) of every item into pIdentity with pCombine, forking like parallelForEach()
+         * and combining in key order - pCombine has to be associative, not commutative. */
+        template<typename T, typename Transform, typename Combine>
+        T parallelReduce(T pIdentity, Transform pTransform, Combine pCombine,
+                         ThreadPool& pPool = ThreadPool::shared()) const {
+            return reduce(mRoot, forkDepth(pPool), pIdentity, pTransform, pCombine, pPool);
+        }
+
+        /* Writes the entries in key order, see Serialization.h. */
+        void save(std::ostream& out) const {
+            BinaryWriter writer(out);
+            writeHeader(writer, MapHeader{MapKind::TreeMap, mCount, 0});
+            for (auto&& item : *this) {
+                Serializer<key_type>::write(writer, item.first);
+                Serializer<mapped_type>::write(writer, item.second);
+            }
+            writer.finish();
+        }
+
+        /* Entries come sorted, so the tree is built bottom-up in O(n): perfectly balanced, without searching
+         * or rotating. Keys out of order make it throw std::runtime_error. */
+        static TreeMap load(std::istream& in) {
+            BinaryReader reader(in);
+            MapHeader header = readHeader(reader, MapKind::TreeMap);
+            TreeMap map;
+            const key_type* previous = nullptr;
+            map.mRoot = map.build(reader, header.mSize, previous);
+            map.mCount = header.mSize;
+            reader.finish();
+            return map;
+        }
+
+        /* Both maps iterate in key order, so they are compared in lockstep - O(n) whatever their shapes. */
         bool operator==(const TreeMap& other) const {
             if (mCount != other.mCount)
                 return false;
-
-            for (auto&& item : other) {
-                TreeNode* node = findNode(item.first);
-                if (node == nullptr || node->mPair.second != item.second)
+            for (auto it = begin(), otherIt = other.begin(); it != end(); ++it, ++otherIt)
+                if (it->first != otherIt->first || it->second != otherIt->second)
                     return false;
-            }
-
             return true;
         }
 
@@ -159,6 +247,87 @@ namespace aisdi {
     private:
         TreeNode* mRoot;
         size_type mCount;
+        size_type mRotations;
+
+        /* Subtrees per thread of the parallel scans. */
+        static const size_type SubtreesPerThread = 8;
+
+        static int forkDepth(const ThreadPool& pPool) {
+            int depth = 0;
+            while (pPool.getSize() > 1 && (size_type(1) << depth) < pPool.getSize() * SubtreesPerThread)
+                ++depth;
+            return depth;
+        }
+
+        template<typename Function>
+        static void forEach(TreeNode* pRoot, int pDepth, Function& pFunction, ThreadPool& pPool) {
+            if (pRoot == nullptr)
+                return;
+            if (pDepth == 0) {
+                visit(pRoot, pFunction);
+                return;
+            }
+            pPool.join([&]() {
+                forEach(pRoot->mLeft, pDepth - 1, pFunction, pPool);
+            }, [&]() {
+                forEach(pRoot->mRight, pDepth - 1, pFunction, pPool);
+            });
+            pFunction(pRoot->mPair);
+        }
+
+        template<typename T, typename Transform, typename Combine>
+        static T reduce(TreeNode* pRoot, int pDepth, const T& pIdentity, Transform& pTransform, Combine& pCombine,
+                        ThreadPool& pPool) {
+            T result = pIdentity;
+            auto fold = [&](const_reference pItem) {
+                result = pCombine(std::move(result), pTransform(pItem));
+            };
+            if (pRoot == nullptr)
+                return result;
+            if (pDepth == 0) {
+                visit(pRoot, fold);
+                return result;
+            }
+            T right = pIdentity;
+            pPool.join([&]() {
+                result = reduce(pRoot->mLeft, pDepth - 1, pIdentity, pTransform, pCombine, pPool);
+            }, [&]() {
+                right = reduce(pRoot->mRight, pDepth - 1, pIdentity, pTransform, pCombine, pPool);
+            });
+            fold(pRoot->mPair);
+            return pCombine(std::move(result), std::move(right));
+        }
+
+        /* In order, recursing only into left subtrees. */
+        template<typename Function>
+        static void visit(TreeNode* pRoot, Function& pFunction) {
+            for (; pRoot != nullptr; pRoot = pRoot->mRight) {
+                visit(pRoot->mLeft, pFunction);
+                pFunction(pRoot->mPair);
+            }
+        }
+
+        void swap(TreeMap& other) {
+            std::swap(mRoot, other.mRoot);
+            std::swap(mCount, other.mCount);
+            std::swap(mRotations, other.mRotations);
+        }
+
+        static TreeNode* clone(const TreeNode* pNode, TreeNode* pParent) {
+            if (pNode == nullptr)
+                return nullptr;
+            TreeNode* node = new TreeNode(pNode->mPair);
+            node->mParent = pParent;
+            node->mHeight = pNode->mHeight;
+            try {
+                node->mLeft = clone(pNode->mLeft, node);
+                node->mRight = clone(pNode->mRight, node);
+            } catch (...) {
+                destroy(node);
+                throw;
+            }
+            return node;
+        }
 
         TreeNode* insert(value_type pValue) {
             TreeNode* node = allocate(pValue.first);
@@ -200,49 +369,93 @@ namespace aisdi {
             return new_node;
         };
 
-        void removeNode(KeyType pKey) {
-            if (mRoot == nullptr)
-                throw std::out_of_range("Removing node that does not exist");
+        void removeNode(const key_type& pKey) {
+            TreeNode* node = findNode(pKey);
+            if (node == nullptr)
+                throw std::out_of_range("Removing nonexisting element");
 
-            TreeNode* n = mRoot;
-            TreeNode* parent = mRoot;
-            TreeNode* child = mRoot;
-            TreeNode* delNode = nullptr;
+            TreeNode* lowest;
+            if (node->mLeft == nullptr || node->mRight == nullptr) {
+                TreeNode* child = node->mLeft != nullptr ? node->mLeft : node->mRight;
+                if (child != nullptr)
+                    child->mParent = node->mParent;
+                replaceChild(node->mParent, node, child);
+                lowest = node->mParent;
+            } else {
+                // Successor takes the place of the removed node, so iterators to other elements stay valid.
+                TreeNode* successor = node->mRight;
+                while (successor->mLeft != nullptr)
+                    successor = successor->mLeft;
+
+                if (successor->mParent != node) {
+                    lowest = successor->mParent;
+                    lowest->mLeft = successor->mRight;
+                    if (successor->mRight != nullptr)
+                        successor->mRight->mParent = lowest;
+                    successor->mRight = node->mRight;
+                    successor->mRight->mParent = successor;
+                } else {
+                    lowest = successor;
+                }
+                successor->mLeft = node->mLeft;
+                successor->mLeft->mParent = successor;
+                successor->mParent = node->mParent;
+                replaceChild(node->mParent, node, successor);
+            }
 
-            while (child != nullptr) {
-                parent = n;
-                n = child;
-                if (pKey >= n->mPair.first)
-                    child = n->mRight;
-                else
-                    child = n->mLeft;
+            delete node;
+            --mCount;
+            if (lowest != nullptr)
+                rebalance(lowest);
+        }
 
-                if (pKey == n->mPair.first)
-                    delNode = n;
+        /* Reads pCount entries in order into a balanced subtree: the left half, its root, the right half. */
+        TreeNode* build(BinaryReader& pReader, std::uint64_t pCount, const key_type*& pPrevious) {
+            if (pCount == 0)
+                return nullptr;
+            std::uint64_t leftCount = (pCount - 1) / 2;
+            TreeNode* left = build(pReader, leftCount, pPrevious);
+            TreeNode* node = nullptr;
+            try {
+                key_type key = Serializer<key_type>::read(pReader);
+                mapped_type value = Serializer<mapped_type>::read(pReader);
+                if (pPrevious != nullptr && !(*pPrevious < key))
+                    throw std::runtime_error("Map file keys are out of order");
+                node = new TreeNode(value_type(std::move(key), std::move(value)));
+                pPrevious = &node->mPair.first;
+                node->mLeft = left;
+                if (left != nullptr)
+                    left->mParent = node;
+                left = nullptr;
+                node->mRight = build(pReader, pCount - 1 - leftCount, pPrevious);
+            } catch (...) {
+                destroy(left);
+                destroy(node);
+                throw;
             }
+            if (node->mRight != nullptr)
+                node->mRight->mParent = node;
+            node->mHeight = 1 + std::max(getHeight(node->mLeft), getHeight(node->mRight));
+            return node;
+        }
 
-            if (!delNode)
-                throw std::out_of_range("Removing nonexisting element");
+        static void destroy(TreeNode* pRoot) {
+            if (pRoot == nullptr)
+                return;
+            destroy(pRoot->mLeft);
+            destroy(pRoot->mRight);
+            delete pRoot;
+        }
 
-            if (n->mLeft)
-                child = n->mLeft;
+        void replaceChild(TreeNode* pParent, TreeNode* pOld, TreeNode* pNew) {
+            if (pParent == nullptr)
+                mRoot = pNew;
+            else if (pParent->mLeft == pOld)
+                pParent->mLeft = pNew;
             else
-                child = n->mRight;
-
-            if (mRoot->mPair.first == pKey) {
-                mRoot = child;
-            } else {
-                if (parent->mLeft == n)
-                    parent->mLeft = child;
-                else
-                    parent->mRight = child;
-                rebalance(parent);
-            }
-            delete n;
-            --mCount;
+                pParent->mRight = pNew;
         }
 
-
         TreeNode* findNode(const key_type& pKey) const {
             TreeNode* root = mRoot;
             while (root && root->mPair.first != pKey)
@@ -321,6 +534,7 @@ namespace aisdi {
         }
 
         TreeNode* rotateLeft(TreeNode* pRoot) {
+            ++mRotations;
             TreeNode* x = pRoot->mRight;
             x->mParent = pRoot->mParent;
             pRoot->mRight = x->mLeft;
@@ -345,6 +559,7 @@ namespace aisdi {
 
 
         TreeNode* rotateRight(TreeNode* pRoot) {
+            ++mRotations;
             TreeNode* x = pRoot->mLeft;
             x->mParent = pRoot->mParent;
             pRoot->mLeft = x->mRight;
@@ -372,6 +587,33 @@ namespace aisdi {
                 return -1;
             return pRoot->mHeight;
         }
+
+        double depthSum(const TreeNode* pRoot, int pDepth) const {
+            if (pRoot == nullptr)
+                return 0;
+            return pDepth + depthSum(pRoot->mLeft, pDepth + 1) + depthSum(pRoot->mRight, pDepth + 1);
+        }
+
+        void validate(const TreeNode* pRoot, const key_type* pLower, const key_type* pUpper, size_type& pCount) const {
+            if (pRoot == nullptr)
+                return;
+            ++pCount;
+
+            if ((pLower != nullptr && !(*pLower < pRoot->mPair.first)) ||
+                (pUpper != nullptr && !(pRoot->mPair.first < *pUpper)))
+                throw std::logic_error("Keys are out of order");
+            if ((pRoot->mLeft != nullptr && pRoot->mLeft->mParent != pRoot) ||
+                (pRoot->mRight != nullptr && pRoot->mRight->mParent != pRoot))
+                throw std::logic_error("Broken parent link");
+            if (pRoot->mHeight != 1 + std::max(getHeight(pRoot->mLeft), getHeight(pRoot->mRight)))
+                throw std::logic_error("Stale node height");
+            int balance = getHeight(pRoot->mRight) - getHeight(pRoot->mLeft);
+            if (balance < -1 || balance > 1)
+                throw std::logic_error("Node is out of balance");
+
+            validate(pRoot->mLeft, pLower, &pRoot->mPair.first, pCount);
+            validate(pRoot->mRight, &pRoot->mPair.first, pUpper, pCount);
+        }
     };
 
     template<typename KeyType, typename ValueType>
@@ -385,7 +627,7 @@ namespace aisdi {
         TreeNode() : mPair(std::make_pair(KeyType(), ValueType())), mParent(nullptr), mLeft(nullptr), mRight(nullptr),
                      mHeight(0) {}
 
-        TreeNode(value_type pPair) : mPair(pPair), mParent(nullptr), mLeft(nullptr), mRight(nullptr), mHeight(0) {}
+        TreeNode(value_type pPair) : mPair(std::move(pPair)), mParent(nullptr), mLeft(nullptr), mRight(nullptr), mHeight(0) {}
     };
 
     template<typename KeyType, typename ValueType>
@@ -435,11 +677,14 @@ namespace aisdi {
                 }
             }
             if (mNode->mLeft) {
-                mNode = mNode->mRight;
+                mNode = mNode->mLeft;
                 while (mNode->mRight) mNode = mNode->mRight;
             } else {
-                while (mNode->mParent && mNode->mParent->mLeft == mNode) mNode = mNode->mParent;
-                mNode = mNode->mParent;
+                TreeNode* node = mNode;
+                while (node->mParent && node->mParent->mLeft == node) node = node->mParent;
+                if (node->mParent == nullptr)
+                    throw std::out_of_range("Eh, what are you doing, decrementing begin iterator?");
+                mNode = node->mParent;
             }
             return *this;
         }
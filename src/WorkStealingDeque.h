@@ -0,0 +1,112 @@
+#ifndef AISDI_MAPS_WORKSTEALINGDEQUE_H
+#define AISDI_MAPS_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace aisdi {
+
+    /* Chase-Lev deque of pointers: its owner pushes and pops at the bottom without locking, other threads
+     * steal from the top and race each other - and the owner, for the last item - with a CAS on mTop. The
+     * circular array doubles when full; arrays it outgrew are kept until destruction, since a thief may still
+     * be reading one. Orderings follow Le et al., "Correct and Efficient Work-Stealing for Weak Memory
+     * Models", with the fences folded into sequentially consistent accesses. */
+    template<typename T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(std::size_t pCapacity = 1024) : mTop(0), mBottom(0) {
+            mArrays.emplace_back(new Array(pCapacity));
+            mArray.store(mArrays.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        /* Owner only. */
+        void push(T* pItem) {
+            std::int64_t bottom = mBottom.load(std::memory_order_relaxed);
+            std::int64_t top = mTop.load(std::memory_order_acquire);
+            Array* array = mArray.load(std::memory_order_relaxed);
+            if (bottom - top > static_cast<std::int64_t>(array->mMask)) {
+                mArrays.emplace_back(array->grow(top, bottom));
+                array = mArrays.back().get();
+                mArray.store(array, std::memory_order_release);
+            }
+            array->put(bottom, pItem);
+            mBottom.store(bottom + 1, std::memory_order_seq_cst);
+        }
+
+        /* Owner only, nullptr when empty. */
+        T* pop() {
+            std::int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            Array* array = mArray.load(std::memory_order_relaxed);
+            mBottom.store(bottom, std::memory_order_seq_cst);
+            std::int64_t top = mTop.load(std::memory_order_seq_cst);
+            if (top > bottom) {
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T* item = array->get(bottom);
+            if (top == bottom) {
+                if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed))
+                    item = nullptr;
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+            return item;
+        }
+
+        /* Any thread, nullptr when empty or when another thread won the race for the top item. */
+        T* steal() {
+            std::int64_t top = mTop.load(std::memory_order_seq_cst);
+            std::int64_t bottom = mBottom.load(std::memory_order_seq_cst);
+            if (top >= bottom)
+                return nullptr;
+            T* item = mArray.load(std::memory_order_acquire)->get(top);
+            if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return item;
+        }
+
+        bool isEmpty() const {
+            return mTop.load(std::memory_order_seq_cst) >= mBottom.load(std::memory_order_seq_cst);
+        }
+
+    private:
+        struct Array {
+            explicit Array(std::size_t pCapacity) : mMask(pCapacity - 1), mItems(new std::atomic<T*>[pCapacity]) {}
+
+            T* get(std::int64_t pIndex) const {
+                return mItems[pIndex & mMask].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t pIndex, T* pItem) {
+                mItems[pIndex & mMask].store(pItem, std::memory_order_relaxed);
+            }
+
+            Array* grow(std::int64_t pTop, std::int64_t pBottom) const {
+                Array* array = new Array(2 * (mMask + 1));
+                for (std::int64_t i = pTop; i < pBottom; ++i)
+                    array->put(i, get(i));
+                return array;
+            }
+
+            std::size_t mMask;
+            std::unique_ptr<std::atomic<T*>[]> mItems;
+        };
+
+        /* Thieves hammer mTop while the owner works at mBottom, keep them on separate cache lines. */
+        std::atomic<std::int64_t> mTop;
+        char mPadding[64];
+        std::atomic<std::int64_t> mBottom;
+        std::atomic<Array*> mArray;
+        std::vector<std::unique_ptr<Array>> mArrays;
+    };
+
+}
+
+#endif /* AISDI_MAPS_WORKSTEALINGDEQUE_H */
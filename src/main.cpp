@@ -1,24 +1,32 @@
+#include <chrono>
 #include <cstddef>
+#include <functional>
 #include <string>
 #include <random>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "FlatMap.h"
+#include "HamtMap.h"
 #include "HashMap.h"
 #include "Benchmark.h"
+#include "BenchmarkRunner.h"
+#include "Fixtures.h"
+#include "KeyGenerator.h"
+#include "LinkedHashMap.h"
+#include "LruCache.h"
+#include "MappedMap.h"
+#include "ParallelBenchmark.h"
+#include "PersistentTreeMap.h"
+#include "ThreadPool.h"
+#include "TinyLfuCache.h"
 #include "TreeMap.h"
 
 
-template<class Collection>
-void Iterate(int n) {
-    Collection map;
-    std::mt19937 device;
-    std::uniform_int_distribution<int> distribution(0, n);
-    for (int i = 0; i < n; ++i) {
-        map[distribution(device)] = i;
-    }
-
-
-}
-
 template<class Collection>
 void randomInsert(int n) {
     Collection map;
@@ -40,53 +48,508 @@ void randomInsertBuckets(int n) {
     }
 }
 
-int main(int argc, char** argv) {
-    (void) argc;
-    (void) argv;
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> insert(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::InsertFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> iterate(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::IterateFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> save(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::SaveFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> load(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::LoadFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Mapped, typename KeyType = typename Mapped::key_type>
+std::shared_ptr<bm::Fixture> openMapped(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::MappedOpenFixture<Mapped, KeyType>>(pKeys);
+}
+
+template<class Mapped, typename KeyType = typename Mapped::key_type>
+std::shared_ptr<bm::Fixture> findMapped(bm::KeyDistribution<KeyType> pKeys, bm::KeyDistribution<KeyType> pLookups,
+                                        int pLookupCount = -1) {
+    return std::make_shared<bm::MappedFindFixture<Mapped, KeyType>>(pKeys, pLookups, pLookupCount);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> copy(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::CopyFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> assign(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::AssignFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> compare(bm::KeyDistribution<KeyType> pKeys) {
+    return std::make_shared<bm::CompareFixture<Collection, KeyType>>(pKeys);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> snapshot(bm::KeyDistribution<KeyType> pKeys, int pWrites, int pInterval) {
+    return std::make_shared<bm::SnapshotFixture<Collection, KeyType>>(pKeys, pWrites, pInterval);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> batchInsert(bm::KeyDistribution<KeyType> pKeys, bool pBatched) {
+    return std::make_shared<bm::BatchInsertFixture<Collection, KeyType>>(pKeys, pBatched);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> batchFind(bm::KeyDistribution<KeyType> pKeys, bm::KeyDistribution<KeyType> pLookups,
+                                       bool pBatched) {
+    return std::make_shared<bm::BatchFindFixture<Collection, KeyType>>(pKeys, pLookups, pBatched);
+}
+
+template<class Cache>
+std::shared_ptr<bm::Fixture> replay(bm::KeyDistribution<int> pKeys) {
+    return std::make_shared<bm::CacheFixture<Cache>>(pKeys, 1000000, 2000000);
+}
+
+template<class Collection, typename KeyType = typename Collection::key_type>
+std::shared_ptr<bm::Fixture> find(bm::KeyDistribution<KeyType> pKeys, bm::KeyDistribution<KeyType> pLookups,
+                                  int pLookupCount = -1) {
+    return std::make_shared<bm::FindFixture<Collection, KeyType>>(pKeys, pLookups, pLookupCount);
+}
+
+std::atomic<std::size_t> lookupHits(0);
+
+/* Threads look up random keys in one shared, prebuilt collection. */
+template<class Collection>
+bm::Benchmark concurrentFind(std::string pName, int pSize, int pLookups) {
+    auto map = std::make_shared<std::unique_ptr<Collection>>();
+    return bm::ParallelBenchmark::create(pName, [map, pSize](int) {
+        if (*map)
+            return;
+        map->reset(new Collection());
+        for (int i = 0; i < pSize; ++i)
+            (**map)[i] = i;
+    }, [map, pSize, pLookups](int pThread, int) {
+        const Collection& shared = **map;
+        std::mt19937 device(pThread);
+        std::uniform_int_distribution<int> distribution(0, 2 * pSize);
+        std::size_t found = 0;
+        for (int i = 0; i < pLookups; ++i)
+            found += shared.find(distribution(device)) != shared.end();
+        lookupHits += found;
+        return static_cast<std::size_t>(pLookups);
+    }, bm::ParallelBenchmark::threadCounts());
+}
+
+/* Threads insert disjoint key ranges into one collection guarded by a single mutex. */
+template<class Collection>
+bm::Benchmark lockedInsert(std::string pName, int pInserts) {
+    auto map = std::make_shared<Collection>();
+    auto lock = std::make_shared<std::mutex>();
+    return bm::ParallelBenchmark::create(pName, [map](int) {
+        *map = Collection();
+    }, [map, lock, pInserts](int pThread, int) {
+        for (int i = 0; i < pInserts; ++i) {
+            std::lock_guard<std::mutex> guard(*lock);
+            (*map)[pThread * pInserts + i] = i;
+        }
+        return static_cast<std::size_t>(pInserts);
+    }, [map]() {
+        *map = Collection();
+    }, bm::ParallelBenchmark::threadCounts());
+}
+
+/* Builds a HashMap of pSize random items with one bucket per item on every thread count, destruction untimed. */
+bm::Benchmark parallelBuild(std::string pName, int pSize, aisdi::HashMap<int, int>::Hashing pHashing) {
+    auto items = std::make_shared<std::vector<std::pair<int, int>>>();
+    return bm::Benchmark::measured(pName, [items, pSize, pHashing](int pThreads, bm::Benchmark::Counters& pCounters) {
+        using namespace std::chrono;
+        if (items->empty()) {
+            std::mt19937 device;
+            std::uniform_int_distribution<int> distribution;
+            for (int i = 0; i < pSize; ++i)
+                items->emplace_back(distribution(device), i);
+        }
+        aisdi::ThreadPool pool(pThreads);
+        time_point<steady_clock> start = steady_clock::now();
+        auto map = aisdi::HashMap<int, int>::parallelBuild(items->begin(), items->end(), pSize, pool, pHashing);
+        duration<double> elapsed = steady_clock::now() - start;
+        pCounters["ops"] = pSize;
+        pCounters["keys/s"] = elapsed.count() > 0 ? pSize / elapsed.count() : 0;
+        return elapsed.count();
+    }, bm::ParallelBenchmark::threadCounts(), "Threads");
+}
+
+std::atomic<long long> valueSum(0);
+
+/* Scans one prebuilt collection of pSize random items on a pool of every thread count: parallelReduce summing
+ * the values, or parallelForEach incrementing them. */
+template<class Collection>
+bm::Benchmark parallelScan(std::string pName, std::shared_ptr<std::unique_ptr<Collection>> pMap, int pSize,
+                           bool pReduce) {
+    return bm::Benchmark::measured(pName, [pMap, pSize, pReduce](int pThreads, bm::Benchmark::Counters& pCounters) {
+        using namespace std::chrono;
+        if (!*pMap) {
+            pMap->reset(new Collection());
+            std::mt19937 device;
+            std::uniform_int_distribution<int> distribution;
+            for (int i = 0; i < pSize; ++i)
+                (**pMap)[distribution(device)] = i;
+        }
+        Collection& map = **pMap;
+        aisdi::ThreadPool pool(pThreads);
+        time_point<steady_clock> start = steady_clock::now();
+        if (pReduce)
+            valueSum += map.parallelReduce(0LL, [](const typename Collection::value_type& pItem) {
+                return static_cast<long long>(pItem.second);
+            }, std::plus<long long>(), pool);
+        else
+            map.parallelForEach([](typename Collection::value_type& pItem) {
+                ++pItem.second;
+            }, pool);
+        duration<double> elapsed = steady_clock::now() - start;
+        pCounters["ops"] = map.getSize();
+        pCounters["keys/s"] = elapsed.count() > 0 ? map.getSize() / elapsed.count() : 0;
+        return elapsed.count();
+    }, bm::ParallelBenchmark::threadCounts(), "Threads");
+}
+
+/* Forks down to pLeaves empty leaves. */
+void forkEmpty(aisdi::ThreadPool& pPool, int pLeaves) {
+    if (pLeaves <= 1)
+        return;
+    pPool.join([&]() {
+        forkEmpty(pPool, pLeaves / 2);
+    }, [&]() {
+        forkEmpty(pPool, pLeaves - pLeaves / 2);
+    });
+}
+
+/* Counts the nodes of a Fibonacci tree of order pOrder - the sparsest AVL tree of its height - forking at
+ * every node, the way a scan of a TreeMap forks when it is not cut off a few levels down. */
+long long forkFibonacci(aisdi::ThreadPool& pPool, int pOrder) {
+    if (pOrder < 2)
+        return pOrder;
+    long long left = 0, right = 0;
+    pPool.join([&]() {
+        left = forkFibonacci(pPool, pOrder - 1);
+    }, [&]() {
+        right = forkFibonacci(pPool, pOrder - 2);
+    });
+    return left + right + 1;
+}
 
+/* Times pTasks forks on a pool of every thread count, or as many std::threads started and joined pThreads
+ * at a time for comparison. */
+bm::Benchmark scheduler(std::string pName, int pTasks, std::function<void(aisdi::ThreadPool&)> pWork) {
+    return bm::Benchmark::measured(pName, [pTasks, pWork](int pThreads, bm::Benchmark::Counters& pCounters) {
+        using namespace std::chrono;
+        aisdi::ThreadPool pool(pThreads);
+        time_point<steady_clock> start = steady_clock::now();
+        if (pWork)
+            pWork(pool);
+        else
+            for (int i = 0; i < pTasks; i += pThreads) {
+                std::vector<std::thread> threads;
+                for (int t = 0; t < pThreads; ++t)
+                    threads.emplace_back([]() {});
+                for (auto&& thread : threads)
+                    thread.join();
+            }
+        duration<double> elapsed = steady_clock::now() - start;
+        pCounters["ops"] = pTasks;
+        pCounters["tasks/s"] = elapsed.count() > 0 ? pTasks / elapsed.count() : 0;
+        return elapsed.count();
+    }, bm::ParallelBenchmark::threadCounts(), "Threads");
+}
+
+int main(int argc, char** argv) {
     auto cases = {1000, 2000, 5000, 8000, 10000, 20000, 50000, 80000, 100000, 200000,
                   500000, 800000, 1000000};
 
-    bm::BenchmarkSuite("RandomInsert")
+    bm::BenchmarkRunner runner;
+
+    runner.addSuite(bm::BenchmarkSuite("RandomInsert")
             .addBenchmark(bm::Benchmark("HashMap", randomInsert<aisdi::HashMap<int, int>>, cases))
             .addBenchmark(bm::Benchmark("TreeMap", randomInsert<aisdi::TreeMap<int, int>>, cases))
-            .run([&](std::pair<const int, double> pPair, int percent) {
-                std::cout << "Done " << percent <<"% -> " << pPair.first << " in " << pPair.second << "\n";
-            })
-            .exportCSVFile();
+    );
 
 
-    bm::BenchmarkSuite("RandomBuckets")
+    runner.addSuite(bm::BenchmarkSuite("RandomBuckets")
             .addBenchmark(bm::Benchmark("HashMap - 10", randomInsertBuckets<10>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 100", randomInsertBuckets<100>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 500", randomInsertBuckets<500>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 1000", randomInsertBuckets<1000>, cases))
             .addBenchmark(bm::Benchmark("TreeMap", randomInsert<aisdi::TreeMap<int, int>>, cases))
-            .run([&](std::pair<const int, double> pPair, int percent) {
-                std::cout << "Done " << percent <<"% -> " << pPair.first << " in " << pPair.second << "\n";
-            })
-            .exportCSVFile();
+    );
 
 
-    bm::BenchmarkSuite("RandomHugeBuckets")
+    runner.addSuite(bm::BenchmarkSuite("RandomHugeBuckets")
             .addBenchmark(bm::Benchmark("HashMap - 1000", randomInsertBuckets<1000>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 2000", randomInsertBuckets<2000>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 5000", randomInsertBuckets<5000>, cases))
             .addBenchmark(bm::Benchmark("HashMap - 10000", randomInsertBuckets<10000>, cases))
             .addBenchmark(bm::Benchmark("TreeMap", randomInsert<aisdi::TreeMap<int, int>>, cases))
-            .run([&](std::pair<const int, double> pPair, int percent) {
-                std::cout << "Done " << percent <<"% -> " << pPair.first << " in " << pPair.second << "\n";
-            })
-            .exportCSVFile();
+    );
 
 
-    bm::BenchmarkSuite("Buckets")
+    runner.addSuite(bm::BenchmarkSuite("Buckets")
             .addBenchmark(bm::Benchmark("100 Buckets", randomInsertBuckets<100>, cases))
             .addBenchmark(bm::Benchmark("500 Buckets", randomInsertBuckets<500>, cases))
             .addBenchmark(bm::Benchmark("1000 Buckets", randomInsertBuckets<1000>, cases))
             .addBenchmark(bm::Benchmark("5000 Buckets", randomInsertBuckets<5000>, cases))
-            .run([&](std::pair<const int, double> pPair, int percent) {
-                std::cout << "Done " << percent <<"% -> " << pPair.first << " in " << pPair.second << "\n";
-            })
-            .exportCSVFile();
+    );
+
+
+    auto zipf = bm::Keys::zipfian(0.99);
+    runner.addSuite(bm::BenchmarkSuite("ZipfInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", insert<bm::BucketedHashMap<1000>>(zipf), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", insert<bm::BucketedHashMap<10000>>(zipf), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(zipf), cases))
+    );
+
+
+    auto hotspot = bm::Keys::hotspot(0.01, 0.9);
+    runner.addSuite(bm::BenchmarkSuite("HotspotInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", insert<bm::BucketedHashMap<1000>>(hotspot), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", insert<bm::BucketedHashMap<10000>>(hotspot), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(hotspot), cases))
+    );
+
+
+    auto clustered = bm::Keys::clustered();
+    runner.addSuite(bm::BenchmarkSuite("ClusteredInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", insert<bm::BucketedHashMap<1000>>(clustered), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", insert<bm::BucketedHashMap<10000>>(clustered), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(clustered), cases))
+    );
+
+
+    auto sequential = bm::Keys::monotonic();
+    runner.addSuite(bm::BenchmarkSuite("SequentialInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", insert<bm::BucketedHashMap<1000>>(sequential), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", insert<bm::BucketedHashMap<10000>>(sequential), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(sequential), cases))
+    );
+
+
+    /* Every key lands in one bucket of std::hash. Guarded maps notice the long chain and reseed, treeified
+     * ones index it with a tree - O(log n) per operation - and only the unguarded ones go quadratic. */
+    auto colliding = bm::Keys::colliding(10000);
+    auto collidingLookups = bm::Keys::colliding(10000, 42);
+    runner.addSuite(bm::BenchmarkSuite("CollidingInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", insert<bm::GuardedHashMap<1000>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", insert<bm::GuardedHashMap<10000>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - unguarded", insert<bm::UnguardedHashMap<10000>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - treeified", insert<bm::TreeifiedHashMap<10000>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - keyed", insert<bm::KeyedHashMap<10000>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 9973", insert<bm::GuardedHashMap<9973>>(colliding), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(colliding), cases))
+    );
+
+    runner.addSuite(bm::BenchmarkSuite("CollidingFind")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", find<bm::GuardedHashMap<10000>>(colliding, collidingLookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - unguarded", find<bm::UnguardedHashMap<10000>>(colliding, collidingLookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - treeified", find<bm::TreeifiedHashMap<10000>>(colliding, collidingLookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", find<aisdi::TreeMap<int, int>>(colliding, collidingLookups), cases))
+    );
+
+
+    auto shortStrings = bm::Keys::strings(bm::Keys::uniform(), 4, 8);
+    auto longStrings = bm::Keys::strings(bm::Keys::uniform(), 32, 128);
+    auto zipfStrings = bm::Keys::strings(zipf, 8, 32);
+    runner.addSuite(bm::BenchmarkSuite("StringInsert")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - short", insert<bm::BucketedHashMap<10000, std::string>>(shortStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - long", insert<bm::BucketedHashMap<10000, std::string>>(longStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - long - keyed", insert<bm::KeyedHashMap<10000, std::string>>(longStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - zipf", insert<bm::BucketedHashMap<10000, std::string>>(zipfStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - short", insert<aisdi::TreeMap<std::string, int>>(shortStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - long", insert<aisdi::TreeMap<std::string, int>>(longStrings), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - zipf", insert<aisdi::TreeMap<std::string, int>>(zipfStrings), cases))
+    );
+
+
+    auto uniform = bm::Keys::uniform();
+    auto lookups = bm::Keys::uniform(42);
+    auto zipfLookups = bm::Keys::zipfian(0.99, 42);
+    runner.addSuite(bm::BenchmarkSuite("Find")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1000", find<bm::BucketedHashMap<1000>>(uniform, lookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000", find<bm::BucketedHashMap<10000>>(uniform, lookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - keyed", find<bm::KeyedHashMap<10000>>(uniform, lookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", find<aisdi::TreeMap<int, int>>(uniform, lookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap", find<aisdi::FlatMap<int, int>>(uniform, lookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 10000 - zipf", find<bm::BucketedHashMap<10000>>(zipf, zipfLookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - zipf", find<aisdi::TreeMap<int, int>>(zipf, zipfLookups), cases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap - zipf", find<aisdi::FlatMap<int, int>>(zipf, zipfLookups), cases))
+    );
+
+
+    /* Small maps, a fixed number of lookups per case so the tiny ones are measurable. */
+    auto smallCases = {8, 16, 32, 64, 128, 256, 512, 1024};
+    runner.addSuite(bm::BenchmarkSuite("SmallFind")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - 1024", find<bm::BucketedHashMap<1024>>(uniform, lookups, 1000000), smallCases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", find<aisdi::TreeMap<int, int>>(uniform, lookups, 1000000), smallCases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap", find<aisdi::FlatMap<int, int>>(uniform, lookups, 1000000), smallCases))
+    );
+
+
+    /* The largest cases are well beyond the last level cache. */
+    auto frozenCases = {1000, 10000, 100000, 1000000, 4000000, 8000000};
+    runner.addSuite(bm::BenchmarkSuite("FrozenFind")
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", find<aisdi::TreeMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("FrozenTreeMap", find<aisdi::FrozenTreeMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap", find<aisdi::FlatMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - sparse", find<bm::BucketedHashMap<8000000>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("PerfectHashMap", find<aisdi::PerfectHashMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+    );
+
+
+    /* FlatMap and HamtMap are built with one batched insert, PerfectHashMap by filling and freezing a HashMap. */
+    runner.addSuite(bm::BenchmarkSuite("BulkBuild")
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", insert<aisdi::TreeMap<int, int>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap", insert<aisdi::FlatMap<int, int>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap", insert<bm::BucketedHashMap<4000000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("PerfectHashMap", insert<aisdi::PerfectHashMap<int, int>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("HamtMap", insert<aisdi::HamtMap<int, int>>(uniform), cases))
+    );
+
+
+    /* In memory, so these measure the format rather than the disk. Compare loads with BulkBuild. */
+    runner.addSuite(bm::BenchmarkSuite("Serialization")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - save", save<bm::BucketedHashMap<1000000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - load", load<bm::BucketedHashMap<1000000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - save", save<aisdi::TreeMap<int, int>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - load", load<aisdi::TreeMap<int, int>>(uniform), cases))
+    );
+
+
+    /* Opening is O(1) while load() reads everything. Lookups hit pages already in the page cache. */
+    runner.addSuite(bm::BenchmarkSuite("Mapped")
+            .addBenchmark(bm::Benchmark::fixture("MappedMap - open", openMapped<aisdi::MappedMap<int, int>>(uniform), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - load", load<bm::BucketedHashMap<1000000>>(uniform), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("MappedMap - find", findMapped<aisdi::MappedMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("MappedHashMap - find", findMapped<aisdi::MappedHashMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+            .addBenchmark(bm::Benchmark::fixture("FlatMap - find", find<aisdi::FlatMap<int, int>>(uniform, lookups, 1000000), frozenCases))
+    );
+
+
+    /* Copies keep the bucket count and node order, or the tree shape, of their source. Comparing walks
+     * both maps once, in lockstep for TreeMaps. */
+    auto copyCases = {1000, 10000, 100000, 1000000};
+    runner.addSuite(bm::BenchmarkSuite("Copy")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - copy", copy<bm::BucketedHashMap<1000000>>(uniform), copyCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - assign", assign<bm::BucketedHashMap<1000000>>(uniform), copyCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - compare", compare<bm::BucketedHashMap<1000000>>(uniform), copyCases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - copy", copy<aisdi::TreeMap<int, int>>(uniform), copyCases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - assign", assign<aisdi::TreeMap<int, int>>(uniform), copyCases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - compare", compare<aisdi::TreeMap<int, int>>(uniform), copyCases))
+    );
+
+
+    /* Batches hash BatchSize keys before probing any, keyed maps with SIMD SipHash kernels where the CPU
+     * has them - the kernel rows time the hashing alone. */
+    auto batchCases = {1000, 10000, 100000, 1000000};
+    bm::BenchmarkSuite batchSuite("BatchHashing");
+    std::vector<std::pair<std::string, aisdi::SimdLevel>> kernels = {
+            {"SipHash - scalar", aisdi::SimdLevel::Scalar},
+            {"SipHash - avx2",   aisdi::SimdLevel::Avx2},
+            {"SipHash - avx512", aisdi::SimdLevel::Avx512}};
+    for (auto&& kernel : kernels)
+        if (aisdi::isSupported(kernel.second))
+            batchSuite.addBenchmark(bm::Benchmark::fixture(kernel.first,
+                    std::make_shared<bm::HashKernelFixture<int>>(uniform, kernel.second), batchCases));
+    runner.addSuite(batchSuite
+            .addBenchmark(bm::Benchmark::fixture("HashMap - insert", batchInsert<bm::BucketedHashMap<1000000>>(uniform, false), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - batch insert", batchInsert<bm::BucketedHashMap<1000000>>(uniform, true), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("KeyedHashMap - insert", batchInsert<bm::KeyedHashMap<1000000>>(uniform, false), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("KeyedHashMap - batch insert", batchInsert<bm::KeyedHashMap<1000000>>(uniform, true), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - find", batchFind<bm::BucketedHashMap<1000000>>(uniform, lookups, false), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - batch find", batchFind<bm::BucketedHashMap<1000000>>(uniform, lookups, true), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("KeyedHashMap - find", batchFind<bm::KeyedHashMap<1000000>>(uniform, lookups, false), batchCases))
+            .addBenchmark(bm::Benchmark::fixture("KeyedHashMap - batch find", batchFind<bm::KeyedHashMap<1000000>>(uniform, lookups, true), batchCases))
+    );
+
+
+    /* 10000 writes with a snapshot retaken every 1000 of them: copying a TreeMap or a HashMap is O(n), a
+     * PersistentTreeMap or HamtMap snapshot is O(1) and their writes path-copy O(log n) nodes instead. */
+    auto snapshotCases = {1000, 10000, 100000, 1000000};
+    runner.addSuite(bm::BenchmarkSuite("Snapshot")
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - insert", insert<aisdi::TreeMap<int, int>>(uniform), snapshotCases))
+            .addBenchmark(bm::Benchmark::fixture("PersistentTreeMap - insert", insert<aisdi::PersistentTreeMap<int, int>>(uniform), snapshotCases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap - write under snapshot", snapshot<aisdi::TreeMap<int, int>>(uniform, 10000, 1000), snapshotCases))
+            .addBenchmark(bm::Benchmark::fixture("PersistentTreeMap - write under snapshot", snapshot<aisdi::PersistentTreeMap<int, int>>(uniform, 10000, 1000), snapshotCases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - write under snapshot", snapshot<bm::BucketedHashMap<1000000>>(uniform, 10000, 1000), snapshotCases))
+            .addBenchmark(bm::Benchmark::fixture("HamtMap - write under snapshot", snapshot<aisdi::HamtMap<int, int>>(uniform, 10000, 1000), snapshotCases))
+    );
+
+
+    /* Sparse tables have far more buckets than keys for most cases, dense ones far fewer. */
+    runner.addSuite(bm::BenchmarkSuite("Iterate")
+            .addBenchmark(bm::Benchmark::fixture("HashMap - dense", iterate<bm::BucketedHashMap<1000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("HashMap - sparse", iterate<bm::BucketedHashMap<4000000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("LinkedHashMap - sparse", iterate<bm::BucketedLinkedHashMap<4000000>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("TreeMap", iterate<aisdi::TreeMap<int, int>>(uniform), cases))
+            .addBenchmark(bm::Benchmark::fixture("FrozenTreeMap", iterate<aisdi::FrozenTreeMap<int, int>>(uniform), cases))
+    );
+
+
+    /* Cases are cache capacities, every run replays 2M accesses over 1M keys. */
+    auto cacheCapacities = {1000, 10000, 100000};
+    auto zipfTrace = bm::Keys::zipfian(0.99);
+    auto flatZipfTrace = bm::Keys::zipfian(0.8);
+    runner.addSuite(bm::BenchmarkSuite("Cache")
+            .addBenchmark(bm::Benchmark::fixture("LruCache - zipf 0.99", replay<aisdi::LruCache<int, int>>(zipfTrace), cacheCapacities))
+            .addBenchmark(bm::Benchmark::fixture("TinyLfuCache - zipf 0.99", replay<aisdi::TinyLfuCache<int, int>>(zipfTrace), cacheCapacities))
+            .addBenchmark(bm::Benchmark::fixture("LruCache - zipf 0.8", replay<aisdi::LruCache<int, int>>(flatZipfTrace), cacheCapacities))
+            .addBenchmark(bm::Benchmark::fixture("TinyLfuCache - zipf 0.8", replay<aisdi::TinyLfuCache<int, int>>(flatZipfTrace), cacheCapacities))
+    );
+
+
+    runner.addSuite(bm::BenchmarkSuite("ConcurrentFind")
+            .addBenchmark(concurrentFind<bm::BucketedHashMap<100000>>("HashMap", 100000, 200000))
+            .addBenchmark(concurrentFind<aisdi::TreeMap<int, int>>("TreeMap", 100000, 200000))
+    );
+
+
+    runner.addSuite(bm::BenchmarkSuite("LockedInsert")
+            .addBenchmark(lockedInsert<bm::BucketedHashMap<100000>>("HashMap", 50000))
+            .addBenchmark(lockedInsert<aisdi::TreeMap<int, int>>("TreeMap", 50000))
+    );
+
+
+    /* 10M items radix-partitioned by bucket range, so threads link disjoint buckets without locks. */
+    runner.addSuite(bm::BenchmarkSuite("ParallelBuild")
+            .addBenchmark(parallelBuild("HashMap", 10000000, aisdi::HashMap<int, int>::Hashing::Guarded))
+            .addBenchmark(parallelBuild("KeyedHashMap", 10000000, aisdi::HashMap<int, int>::Hashing::Keyed))
+    );
+
+
+    /* 10M items split into a few bucket ranges or subtrees per thread. */
+    auto scannedHashMap = std::make_shared<std::unique_ptr<bm::BucketedHashMap<10000000>>>();
+    auto scannedTreeMap = std::make_shared<std::unique_ptr<aisdi::TreeMap<int, int>>>();
+    runner.addSuite(bm::BenchmarkSuite("ParallelScan")
+            .addBenchmark(parallelScan("HashMap - sum", scannedHashMap, 10000000, true))
+            .addBenchmark(parallelScan("HashMap - increment", scannedHashMap, 10000000, false))
+            .addBenchmark(parallelScan("TreeMap - sum", scannedTreeMap, 10000000, true))
+            .addBenchmark(parallelScan("TreeMap - increment", scannedTreeMap, 10000000, false))
+    );
+
+
+    /* Cost of a fork: 1M empty leaves, a Fibonacci tree of 514228 nodes forking at each, and starting a
+     * std::thread per task instead. */
+    runner.addSuite(bm::BenchmarkSuite("Scheduler")
+            .addBenchmark(scheduler("join - empty tasks", 1 << 20, [](aisdi::ThreadPool& pPool) {
+                forkEmpty(pPool, 1 << 20);
+            }))
+            .addBenchmark(scheduler("join - fibonacci tree", 514228, [](aisdi::ThreadPool& pPool) {
+                valueSum += forkFibonacci(pPool, 27);
+            }))
+            .addBenchmark(scheduler("std::thread - spawn", 1024, nullptr))
+    );
+
+    return runner.run(argc, argv);
 }
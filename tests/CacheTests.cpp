@@ -0,0 +1,214 @@
+#include <LruCache.h>
+#include <TinyLfuCache.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedCaches = boost::mpl::list<aisdi::LruCache<int, std::string>, aisdi::TinyLfuCache<int, std::string>>;
+
+BOOST_AUTO_TEST_SUITE(CacheTests)
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenZeroCapacity_WhenCreatingCache_ThenExceptionIsThrown,
+                              Cache,
+                              TestedCaches)
+{
+  BOOST_CHECK_THROW(Cache(0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyCache_WhenGetting_ThenMissIsCounted,
+                              Cache,
+                              TestedCaches)
+{
+  Cache cache(10);
+
+  BOOST_CHECK(cache.get(42) == nullptr);
+  BOOST_CHECK(cache.isEmpty());
+  BOOST_CHECK_EQUAL(cache.stats().mMisses, 1u);
+  BOOST_CHECK_EQUAL(cache.stats().mHits, 0u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCachedValue_WhenGetting_ThenHitIsCounted,
+                              Cache,
+                              TestedCaches)
+{
+  Cache cache(10);
+  cache.put(42, "Alice");
+  cache.put(42, "Bob");
+
+  const std::string* value = cache.get(42);
+
+  BOOST_REQUIRE(value != nullptr);
+  BOOST_CHECK_EQUAL(*value, "Bob");
+  BOOST_CHECK_EQUAL(cache.getSize(), 1u);
+  BOOST_CHECK_EQUAL(cache.stats().mHits, 1u);
+  BOOST_CHECK_EQUAL(cache.stats().hitRatio(), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFullCache_WhenPutting_ThenCapacityIsKept,
+                              Cache,
+                              TestedCaches)
+{
+  Cache cache(10);
+
+  for (int key = 0; key < 100; ++key)
+  {
+    cache.put(key, "Chuck");
+    BOOST_REQUIRE_LE(cache.getSize(), 10u);
+  }
+
+  BOOST_CHECK_EQUAL(cache.getWeight(), cache.getSize());
+  BOOST_CHECK_EQUAL(cache.stats().mEvictions, 100u - cache.getSize());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCachedValue_WhenRemoving_ThenItIsGone,
+                              Cache,
+                              TestedCaches)
+{
+  Cache cache(10);
+  cache.put(1, "Alice");
+  cache.put(2, "Bob");
+
+  BOOST_CHECK(cache.remove(1));
+  BOOST_CHECK(!cache.remove(1));
+  BOOST_CHECK(!cache.contains(1));
+  BOOST_CHECK(cache.contains(2));
+  BOOST_CHECK_EQUAL(cache.getWeight(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenByteWeigher_WhenPutting_ThenTotalSizeStaysWithinCapacity,
+                              Cache,
+                              TestedCaches)
+{
+  Cache cache(100, [](int, const std::string& value) { return value.size(); });
+
+  for (int key = 0; key < 50; ++key)
+  {
+    cache.put(key, std::string(key % 20 + 1, 'x'));
+    BOOST_REQUIRE_LE(cache.getWeight(), 100u);
+  }
+  cache.put(1000, std::string(101, 'x'));
+
+  BOOST_CHECK(!cache.contains(1000));
+  BOOST_CHECK_LE(cache.getWeight(), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(GivenLruCache_WhenFull_ThenLeastRecentlyUsedEntryIsEvicted)
+{
+  aisdi::LruCache<int, std::string> cache(3);
+  cache.put(1, "Alice");
+  cache.put(2, "Bob");
+  cache.put(3, "Chuck");
+
+  cache.get(1);
+  cache.put(4, "Dave");
+
+  BOOST_CHECK(cache.contains(1));
+  BOOST_CHECK(!cache.contains(2));
+  BOOST_CHECK(cache.contains(3));
+  BOOST_CHECK(cache.contains(4));
+}
+
+BOOST_AUTO_TEST_CASE(GivenFrequentlyUsedKeys_WhenScanning_ThenTinyLfuKeepsThem)
+{
+  aisdi::TinyLfuCache<int, std::string> lfu(100);
+  aisdi::LruCache<int, std::string> lru(100);
+  for (int round = 0; round < 5; ++round)
+    for (int key = 0; key < 20; ++key)
+    {
+      if (lfu.get(key) == nullptr)
+        lfu.put(key, "hot");
+      if (lru.get(key) == nullptr)
+        lru.put(key, "hot");
+    }
+
+  for (int key = 1000; key < 2000; ++key)
+  {
+    if (lfu.get(key) == nullptr)
+      lfu.put(key, "cold");
+    if (lru.get(key) == nullptr)
+      lru.put(key, "cold");
+  }
+
+  for (int key = 0; key < 20; ++key)
+  {
+    BOOST_CHECK(lfu.contains(key));
+    BOOST_CHECK(!lru.contains(key));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenSketch_WhenIncrementing_ThenFrequencySaturates)
+{
+  aisdi::FrequencySketch<int> sketch(1000);
+
+  for (int i = 0; i < 3; ++i)
+    sketch.increment(7);
+  BOOST_CHECK_GE(sketch.frequency(7), 3u);
+  BOOST_CHECK_EQUAL(sketch.frequency(8), 0u);
+
+  for (int i = 0; i < 100; ++i)
+    sketch.increment(7);
+  BOOST_CHECK_EQUAL(sketch.frequency(7), 15u);
+}
+
+struct ThrowingValue
+{
+  static bool throwingMove;
+  static bool throwingAssignment;
+
+  ThrowingValue() = default;
+
+  ThrowingValue(ThrowingValue&&)
+  {
+    if (throwingMove)
+      throw std::runtime_error("Bob");
+  }
+
+  ThrowingValue& operator=(ThrowingValue&&)
+  {
+    if (throwingAssignment)
+      throw std::runtime_error("Bob");
+    return *this;
+  }
+};
+
+bool ThrowingValue::throwingMove = false;
+bool ThrowingValue::throwingAssignment = false;
+
+BOOST_AUTO_TEST_CASE(GivenThrowingValue_WhenPuttingIntoTinyLfu_ThenCacheIsUnchanged)
+{
+  aisdi::TinyLfuCache<int, ThrowingValue> cache(10);
+  cache.put(1, ThrowingValue());
+
+  ThrowingValue::throwingMove = true;
+  BOOST_CHECK_THROW(cache.put(2, ThrowingValue()), std::runtime_error);
+  ThrowingValue::throwingMove = false;
+
+  BOOST_CHECK_EQUAL(cache.getSize(), 1u);
+  BOOST_CHECK(!cache.contains(2));
+  BOOST_CHECK(cache.get(2) == nullptr);
+  cache.put(2, ThrowingValue());
+  BOOST_CHECK(cache.contains(2));
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingAssignment_WhenPuttingIntoLru_ThenCacheIsUnchanged)
+{
+  aisdi::LruCache<int, ThrowingValue> cache(10);
+  cache.put(1, ThrowingValue());
+
+  ThrowingValue::throwingAssignment = true;
+  BOOST_CHECK_THROW(cache.put(2, ThrowingValue()), std::runtime_error);
+  ThrowingValue::throwingAssignment = false;
+
+  BOOST_CHECK_EQUAL(cache.getSize(), 1u);
+  BOOST_CHECK_EQUAL(cache.getWeight(), 1u);
+  BOOST_CHECK(!cache.contains(2));
+  BOOST_CHECK(cache.get(2) == nullptr);
+  cache.put(2, ThrowingValue());
+  BOOST_CHECK(cache.contains(2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,236 @@
+#include <FlatMap.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::FlatMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(FlatMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingIterators_ThenBeginEqualsEnd,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(42) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(42), std::out_of_range);
+  BOOST_CHECK_THROW(--(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedInsertions_WhenIterating_ThenKeysAreSorted,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key : { 42, 7, 1000, 3, 14, 7 })
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenFindingKeys_ThenPresentOnesAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } };
+
+  for (K key = 0; key <= 40; ++key)
+  {
+    auto it = map.find(key);
+    if (key == 10 || key == 20 || key == 30)
+      BOOST_CHECK(it != map.end() && it->first == key);
+    else
+      BOOST_CHECK(it == map.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenGettingLowerBound_ThenFirstNotLessKeyIsReturned,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 10, "Alice" }, { 20, "Bob" }, { 30, "Chuck" } };
+
+  BOOST_CHECK_EQUAL(map.lowerBound(0)->first, 10u);
+  BOOST_CHECK_EQUAL(map.lowerBound(10)->first, 10u);
+  BOOST_CHECK_EQUAL(map.lowerBound(11)->first, 20u);
+  BOOST_CHECK_EQUAL(map.lowerBound(30)->first, 30u);
+  BOOST_CHECK(map.lowerBound(31) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenWritingThroughIt_ThenValueIsChanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+
+  map.begin()->second = "Chuck";
+  (*map.find(2)).second = "Dave";
+
+  BOOST_CHECK_EQUAL(map.valueOf(1), "Chuck");
+  BOOST_CHECK_EQUAL(map.valueOf(2), "Dave");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInsertingBatch_ThenLastAssignmentWins,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 5, "Alice" }, { 15, "Bob" } };
+  std::vector<std::pair<K, std::string>> batch = {
+    { 10, "Chuck" }, { 5, "Dave" }, { 1, "Eve" }, { 10, "Frank" }, { 20, "Grace" }
+  };
+
+  map.insert(batch.begin(), batch.end());
+
+  thenMapContainsItems(map, { { 1, "Eve" }, { 5, "Dave" }, { 10, "Frank" }, { 15, "Bob" }, { 20, "Grace" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItems_ThenOthersRemain,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" }, { 4, "Dave" } };
+
+  map.remove(2);
+  map.remove(map.begin());
+
+  thenMapContainsItems(map, { { 3, "Chuck" }, { 4, "Dave" } });
+  BOOST_CHECK_THROW(map.remove(2), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenChangingKeySet_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+  std::vector<std::pair<K, std::string>> batch = { { 3, "Chuck" } };
+
+  map.freeze();
+
+  BOOST_CHECK(map.isFrozen());
+  BOOST_CHECK_THROW(map[3] = "Chuck", std::logic_error);
+  BOOST_CHECK_THROW(map.remove(1), std::logic_error);
+  BOOST_CHECK_THROW(map.insert(batch.begin(), batch.end()), std::logic_error);
+  map[1] = "Dave";
+  BOOST_CHECK_EQUAL(map.valueOf(1), "Dave");
+  BOOST_CHECK_EQUAL(map.getSize(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopyingAndMoving_ThenContentsFollow,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+
+  Map<K> copy(map);
+  copy[3] = "Chuck";
+  Map<K> moved(std::move(map));
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(moved.getSize(), 2u);
+  BOOST_CHECK(copy != moved);
+  copy.remove(3);
+  BOOST_CHECK(copy == moved);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenComparingWithStdMap_ThenContentsMatch,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 device;
+  std::uniform_int_distribution<int> keys(0, 200);
+
+  for (int round = 0; round < 20; ++round)
+  {
+    std::vector<std::pair<K, std::string>> batch;
+    for (int i = 0; i < 30; ++i)
+    {
+      K key = keys(device);
+      batch.emplace_back(key, std::to_string(round * 100 + i));
+      expected[key] = std::to_string(round * 100 + i);
+    }
+    map.insert(batch.begin(), batch.end());
+
+    for (int i = 0; i < 10; ++i)
+    {
+      K key = keys(device);
+      if (expected.erase(key))
+        map.remove(key);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+struct ThrowingValue
+{
+  static bool throwing;
+
+  int value;
+
+  ThrowingValue() : value(0)
+  {
+    if (throwing)
+      throw std::runtime_error("Bob");
+  }
+};
+
+bool ThrowingValue::throwing = false;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingValueConstructor_WhenAddingItem_ThenMapIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::FlatMap<K, ThrowingValue> map;
+  map[1].value = 1;
+  map[3].value = 3;
+
+  ThrowingValue::throwing = true;
+  BOOST_CHECK_THROW(map[2], std::runtime_error);
+  ThrowingValue::throwing = false;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  BOOST_CHECK(map.find(2) == map.end());
+  BOOST_CHECK_EQUAL(map.valueOf(1).value, 1);
+  BOOST_CHECK_EQUAL(map.valueOf(3).value, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
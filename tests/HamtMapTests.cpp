@@ -0,0 +1,231 @@
+#include <HamtMap.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::HamtMap<K, std::string>;
+
+using std::begin;
+using std::end;
+
+/* Key whose hash ignores all but its lowest bit, so whole hashes collide. */
+struct CollidingKey
+{
+  int value;
+
+  bool operator==(const CollidingKey& other) const
+  {
+    return value == other.value;
+  }
+
+  bool operator!=(const CollidingKey& other) const
+  {
+    return value != other.value;
+  }
+};
+
+namespace std
+{
+template <>
+struct hash<CollidingKey>
+{
+  std::size_t operator()(const CollidingKey& key) const
+  {
+    return key.value & 1;
+  }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(HamtMapTests)
+
+#include "HashMapInterfaceTests.h"
+
+template <typename K>
+void thenIterationVisitsItems(const Map<K>& map,
+                              const std::map<K, std::string>& expected)
+{
+  std::map<K, std::string> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    BOOST_CHECK(forward.emplace(it->first, it->second).second);
+
+  std::map<K, std::string> backward;
+  auto it = map.end();
+  for (std::size_t i = 0; i < expected.size(); ++i)
+  {
+    --it;
+    BOOST_CHECK(backward.emplace(it->first, it->second).second);
+  }
+
+  BOOST_CHECK(forward == expected);
+  BOOST_CHECK(backward == expected);
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenComparingWithStdMap_ThenContentsMatch,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 device;
+  std::uniform_int_distribution<int> keys(0, 3000);
+
+  for (int i = 0; i < 20000; ++i)
+  {
+    K key = keys(device);
+    if (i % 3 == 2)
+    {
+      if (expected.erase(key))
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+  thenIterationVisitsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenOriginalIsModified_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 1000; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  const Map<K> snapshot = map.snapshot();
+  BOOST_CHECK(snapshot == map);
+  map[7] = "Alice";
+  map[5000] = "Bob";
+  map.remove(100);
+  map.valueOf(150) = "Chuck";
+  map.find(200)->second = "Dave";
+
+  thenMapContainsItems(snapshot, expected);
+  expected[7] = "Alice";
+  expected[5000] = "Bob";
+  expected.erase(100);
+  expected[150] = "Chuck";
+  expected[200] = "Dave";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(snapshot != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyVersions_WhenEachIsModified_ThenAllKeepTheirContents,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<Map<K>> versions(1);
+  for (K key = 0; key < 100; ++key)
+  {
+    versions.push_back(versions.back());
+    versions.back()[key] = std::to_string(key);
+    if (key % 10 == 9)
+      versions.back().remove(key - 5);
+  }
+
+  for (std::size_t i = 0; i < versions.size(); ++i)
+  {
+    std::map<K, std::string> expected;
+    for (K key = 0; static_cast<std::size_t>(key) < i; ++key)
+    {
+      expected[key] = std::to_string(key);
+      if (key % 10 == 9)
+        expected.erase(key - 5);
+    }
+    thenMapContainsItems(versions[i], expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenItemsInBatch_WhenInserting_ThenLastOfRepeatedKeysWins,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 2000; ++key)
+  {
+    items.emplace_back(key % 1500, std::to_string(key));
+    expected[key % 1500] = std::to_string(key);
+  }
+
+  Map<K> map;
+  map.insert(items.begin(), items.end());
+  Map<K> other;
+  for (auto&& item : items)
+    other[item.first] = item.second;
+
+  thenMapContainsItems(map, expected);
+  thenIterationVisitsItems(map, expected);
+  BOOST_CHECK(map == other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsBuiltInDifferentOrder_WhenComparing_ThenTheyAreEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  Map<K> other;
+  for (K key = 0; key < 500; ++key)
+  {
+    map[key] = "Alice";
+    other[499 - key] = "Alice";
+  }
+  for (K key = 0; key < 500; key += 3)
+    map.remove(key);
+  for (K key = 500; key-- > 0;)
+    if (key % 3 == 0)
+      other.remove(key);
+
+  BOOST_CHECK(map == other);
+  other[1] = "Bob";
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCollidingHashes_WhenUpdating_ThenAllKeysAreKept)
+{
+  aisdi::HamtMap<CollidingKey, int> map;
+  for (int value = 0; value < 20; ++value)
+    map[CollidingKey{ value }] = value;
+  const auto snapshot = map.snapshot();
+  for (int value = 0; value < 20; value += 2)
+    map.remove(CollidingKey{ value });
+
+  BOOST_CHECK_EQUAL(map.getSize(), 10u);
+  BOOST_CHECK_EQUAL(snapshot.getSize(), 20u);
+  for (int value = 0; value < 20; ++value)
+  {
+    BOOST_CHECK((map.find(CollidingKey{ value }) == map.end()) == (value % 2 == 0));
+    BOOST_CHECK_EQUAL(snapshot.valueOf(CollidingKey{ value }), value);
+  }
+
+  aisdi::HamtMap<CollidingKey, int> other;
+  for (int value = 19; value > 0; value -= 2)
+    other[CollidingKey{ value }] = value;
+  BOOST_CHECK(map == other);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
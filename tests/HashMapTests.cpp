@@ -1,8 +1,16 @@
 #include <HashMap.h>
 
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <string>
 #include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -16,579 +24,897 @@ using Map = aisdi::HashMap<K, std::string>;
 using std::begin;
 using std::end;
 
-BOOST_AUTO_TEST_SUITE(MapsTests)
-
-template <typename K>
-void thenMapContainsItems(const Map<K>& map,
-                          const std::map<K, std::string>& expected)
+/* Key with no operator< whose hashes all collide. */
+struct UnorderedKey
 {
-  BOOST_CHECK_EQUAL(map.getSize(), expected.size());
+  int value;
 
-  for (const auto& item : expected)
+  bool operator==(const UnorderedKey& other) const
   {
-    const auto it = map.find(item.first);
-    BOOST_REQUIRE_MESSAGE(it != end(map), "Missing required item with key: " << item.first);
-    BOOST_CHECK_MESSAGE(it->second == item.second,
-                        "Wrong value in map for key: " << item.first
-                        << " (expected: \"" << item.second
-                        << "\" got: \"" << it->second << "\")");
+    return value == other.value;
   }
-}
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCreatedWithDefaultConstructor_ThenItIsEmpty,
-                              K,
-                              TestedKeyTypes)
-{
-  const Map<K> map;
-
-  BOOST_CHECK(map.isEmpty());
-}
+  bool operator!=(const UnorderedKey& other) const
+  {
+    return value != other.value;
+  }
+};
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItIsNoLongerEmpty,
-                              K,
-                              TestedKeyTypes)
+namespace std
 {
-  Map<K> map;
-
-  map[K{}] = std::string{};
-
-  BOOST_CHECK(!map.isEmpty());
-}
-
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingIterators_ThenBeginEqualsEnd,
-                              K,
-                              TestedKeyTypes)
+template <>
+struct hash<UnorderedKey>
 {
-  Map<K> map;
-
-  BOOST_CHECK(begin(map) == end(map));
-  BOOST_CHECK(const_cast<const Map<K>&>(map).begin() == map.end());
-  BOOST_CHECK(map.cbegin() == map.cend());
+  std::size_t operator()(const UnorderedKey&) const
+  {
+    return 0;
+  }
+};
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingIterator_ThenBeginIsNotEnd,
-                              K,
-                              TestedKeyTypes)
-{
-  Map<K> map;
-  map[K{}] = std::string{};
+BOOST_AUTO_TEST_SUITE(MapsTests)
 
-  BOOST_CHECK(begin(map) != end(map));
-}
+#include "HashMapInterfaceTests.h"
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithOnePair_WhenIterating_ThenPairIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingStats_ThenAllBucketsAreEmpty,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[753] = "Rome";
+  const Map<K> map(10);
 
-  auto it = map.begin();
+  const auto stats = map.stats();
 
-  BOOST_CHECK_EQUAL(it->first, 753);
-  BOOST_CHECK_EQUAL(it->second, "Rome");
-  BOOST_CHECK(++it == map.end());
+  BOOST_CHECK_EQUAL(stats.mSize, 0u);
+  BOOST_CHECK_EQUAL(stats.mBucketCount, 10u);
+  BOOST_CHECK_EQUAL(stats.mUsedBuckets, 0u);
+  BOOST_CHECK_EQUAL(stats.mLongestChain, 0u);
+  BOOST_CHECK_EQUAL(stats.mHistogram[0], 10u);
+  BOOST_CHECK_EQUAL(stats.mCollisionRate, 0.0);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostIncrementing_ThenPreviousPositionIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithDistinctBuckets_WhenGettingStats_ThenThereAreNoCollisions,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[K{}] = std::string{};
+  Map<K> map(10);
+  for (K key = 0; key < 5; ++key)
+    map[key] = "Alice";
 
-  auto it = map.begin();
-  auto postIncrementedIt = it++;
+  const auto stats = map.stats();
 
-  BOOST_CHECK(postIncrementedIt == map.begin());
-  BOOST_CHECK(it == map.end());
-  BOOST_CHECK(postIncrementedIt == map.cbegin());
-  BOOST_CHECK(it == map.cend());
+  BOOST_CHECK_EQUAL(stats.mUsedBuckets, 5u);
+  BOOST_CHECK_EQUAL(stats.mLongestChain, 1u);
+  BOOST_CHECK_EQUAL(stats.mHistogram[0], 5u);
+  BOOST_CHECK_EQUAL(stats.mHistogram[1], 5u);
+  BOOST_CHECK_EQUAL(stats.mSuccessfulProbes, 1.0);
+  BOOST_CHECK_EQUAL(stats.mUnsuccessfulProbes, 0.5);
+  BOOST_CHECK_EQUAL(stats.mCollisionRate, 0.0);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreIncrementing_ThenNewPositionIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithCollidingKeys_WhenGettingStats_ThenSingleChainIsReported,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[K{}] = std::string{};
+  Map<K> map(10);
+  for (K key = 0; key < 40; key += 10)
+    map[key] = "Bob";
 
-  auto it = map.begin();
-  auto preIncrementedIt = ++it;
+  const auto stats = map.stats();
 
-  BOOST_CHECK(preIncrementedIt == it);
-  BOOST_CHECK(it == map.end());
+  BOOST_CHECK_EQUAL(stats.mUsedBuckets, 1u);
+  BOOST_CHECK_EQUAL(stats.mLongestChain, 4u);
+  BOOST_CHECK_EQUAL(stats.mHistogram[4], 1u);
+  BOOST_CHECK_EQUAL(stats.mSuccessfulProbes, 2.5);
+  BOOST_CHECK_EQUAL(stats.mCollisionRate, 0.75);
+  BOOST_CHECK_LT(stats.mHashQuality, 0.5);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenIncrementing_ThenOperationThrows,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeys_WhenRemovingFromMiddleOfChain_ThenOtherItemsRemain,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(10);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 50; key += 10)
+  {
+    map[key] = "Alice";
+    expected[key] = "Alice";
+  }
+
+  map.remove(20);
+  map.remove(map.find(0));
+  map.remove(40);
+  expected.erase(20);
+  expected.erase(0);
+  expected.erase(40);
 
-  BOOST_CHECK_THROW(map.end()++, std::out_of_range);
-  BOOST_CHECK_THROW(++(map.end()), std::out_of_range);
-  BOOST_CHECK_THROW(map.cend()++, std::out_of_range);
-  BOOST_CHECK_THROW(++(map.cend()), std::out_of_range);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(60), std::out_of_range);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDecrementing_ThenIteratorPointsToLastItem,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSparseMap_WhenIterating_ThenAllItemsAreVisitedBothWays,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[1] = std::string{};
+  Map<K> map(100000);
+  std::map<K, std::string> expected;
+  for (K key : { 3, 64, 65, 127, 128, 4096, 99999, 100003 })
+  {
+    map[key] = "Bob";
+    expected[key] = "Bob";
+  }
+
+  std::map<K, std::string> forward;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    forward[it->first] = it->second;
 
+  std::map<K, std::string> backward;
   auto it = map.end();
-  --it;
+  for (std::size_t i = 0; i < expected.size(); ++i)
+  {
+    --it;
+    backward[it->first] = it->second;
+  }
 
-  BOOST_CHECK(it == begin(map));
-  BOOST_CHECK_EQUAL(it->first, 1);
+  BOOST_CHECK(forward == expected);
+  BOOST_CHECK(backward == expected);
+  BOOST_CHECK(it == map.begin());
+  BOOST_CHECK_THROW(--it, std::out_of_range);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPreDecrementing_ThenNewIteratorValueIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapWithEmptiedBuckets_WhenIterating_ThenEmptiedBucketsAreSkipped,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[1] = std::string{};
+  Map<K> map(128);
+  for (K key = 0; key < 256; ++key)
+    map[key] = "Chuck";
+  for (K key = 0; key < 256; ++key)
+    if (key % 128 != 5 && key % 128 != 70)
+      map.remove(key);
 
-  auto it = map.end();
-  auto preDecremented = --it;
+  std::size_t count = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+  {
+    BOOST_CHECK(it->first % 128 == 5 || it->first % 128 == 70);
+    ++count;
+  }
 
-  BOOST_CHECK(it == preDecremented);
-  BOOST_CHECK_EQUAL(it->first, 1);
+  BOOST_CHECK_EQUAL(count, 4u);
+  BOOST_CHECK_EQUAL(map.stats().mUsedBuckets, 2u);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenPostDecrementing_ThenOldIteratorValueIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopying_ThenBucketLayoutIsKept,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[1] = std::string{};
+  Map<K> map(97);
+  for (K key = 0; key < 1000; ++key)
+    map[key * 3] = std::to_string(key);
 
-  auto it = map.end();
-  auto postDecremented = it--;
+  Map<K> copy(map);
+  Map<K> assigned;
+  assigned = map;
 
-  BOOST_CHECK(postDecremented == map.end());
-  BOOST_CHECK_EQUAL(it->first, 1);
+  for (const Map<K>* other : { &copy, &assigned })
+  {
+    BOOST_CHECK(*other == map);
+    BOOST_CHECK_EQUAL(other->getBucketCount(), 97u);
+    auto expected = map.begin();
+    for (auto it = other->begin(); it != other->end(); ++it, ++expected)
+      BOOST_CHECK_EQUAL(it->first, expected->first);
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenBeginIterator_WhenDecrementing_ThenOperationThrows,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopiedMap_WhenModifyingIt_ThenOriginalIsUnchanged,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(10);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 100; ++key)
+  {
+    map[key] = "Alice";
+    expected[key] = "Alice";
+  }
 
-  BOOST_CHECK_THROW(map.begin()--, std::out_of_range);
-  BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
-  BOOST_CHECK_THROW(map.cbegin()--, std::out_of_range);
-  BOOST_CHECK_THROW(--(map.cbegin()), std::out_of_range);
+  Map<K> copy(map);
+  for (K key = 0; key < 100; key += 2)
+    copy.remove(key);
+  copy[7] = "Bob";
+  copy[1000] = "Chuck";
+  copy = copy;
+
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_EQUAL(copy.getSize(), 51u);
+  BOOST_CHECK_EQUAL(copy.valueOf(7), "Bob");
+  BOOST_CHECK_EQUAL(copy.valueOf(1000), "Chuck");
+  BOOST_CHECK(copy.find(4) == copy.end());
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEndIterator_WhenDereferencing_ThenOperationThrows,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsWithDifferentBucketCounts_WhenComparingThem_ThenOnlyItemsMatter,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(10);
+  Map<K> other(1000);
+  for (K key = 0; key < 100; ++key)
+  {
+    map[key] = "Alice";
+    other[key] = "Alice";
+  }
 
-  BOOST_CHECK_THROW(*map.end(), std::out_of_range);
-  BOOST_CHECK_THROW(*map.cend(), std::out_of_range);
-  BOOST_CHECK_THROW(map.end()->first, std::out_of_range);
-  BOOST_CHECK_THROW(map.cend()->second, std::out_of_range);
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(other == map);
+  other.remove(5);
+  other[500] = "Alice";
+  BOOST_CHECK(map != other);
+  BOOST_CHECK(other != map);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenConstIterator_WhenDereferencing_ThenItemIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenSourceHasNoItemsLeft,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[42] = "Answer";
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
 
-  const auto it = map.cbegin();
+  other = std::move(map);
 
-  BOOST_CHECK_EQUAL(it->first, 42);
-  BOOST_CHECK_EQUAL(it->second, "Answer");
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(42) == map.end());
+  map[42] = "Chuck";
+  thenMapContainsItems(map, { { 42, "Chuck" } });
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSearchingForKey_ThenEndIsReturned,
-                              K,
-                              TestedKeyTypes)
+BOOST_AUTO_TEST_CASE(GivenReferenceKey_WhenSipHashing_ThenReferenceVectorsAreMatched)
 {
-  const Map<K> map;
-
-  const auto it = map.find(123);
+  unsigned char key[16];
+  unsigned char message[64];
+  for (int i = 0; i < 64; ++i)
+    message[i] = i;
+  for (int i = 0; i < 16; ++i)
+    key[i] = i;
+  std::uint64_t key0, key1;
+  std::memcpy(&key0, key, 8);
+  std::memcpy(&key1, key + 8, 8);
 
-  BOOST_CHECK(it == end(map));
+  BOOST_CHECK_EQUAL((aisdi::sipHash<2, 4>(message, 0, key0, key1)), 0x726fdb47dd0e0e31ULL);
+  BOOST_CHECK_EQUAL((aisdi::sipHash<2, 4>(message, 15, key0, key1)), 0xa129ca6149be45e5ULL);
+  BOOST_CHECK_EQUAL((aisdi::sipHash<2, 4>(message, 63, key0, key1)), 0x958a324ceb064572ULL);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForMissingKey_ThenEndIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeysCollidingUnderStdHash_WhenInserting_ThenGuardedMapReseedsItself,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[321] = "Not it";
-
-  const auto it = map.find(123);
+  Map<K> map(100, Map<K>::Hashing::Guarded);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 2000; ++key)
+  {
+    map[key * 100] = std::to_string(key);
+    expected[key * 100] = std::to_string(key);
+  }
 
-  BOOST_CHECK(it == end(map));
+  BOOST_CHECK(map.isKeyed());
+  BOOST_CHECK_LT(map.stats().mLongestChain, Map<K>::FloodedChain + 40);
+  thenMapContainsItems(map, expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenSearchingForKey_ThenItemIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenDefaultMap_WhenInsertingCollidingKeys_ThenTheyShareOneChain,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[321] = "Not it";
-  map[123] = "It!";
-
-  const auto it = map.find(123);
+  Map<K> map(100);
+  for (K key = 0; key < 200; ++key)
+    map[key * 100] = "Alice";
 
-  BOOST_CHECK(it != end(map));
-  BOOST_CHECK_EQUAL(it->first, 123);
-  BOOST_CHECK_EQUAL(it->second, "It!");
+  BOOST_CHECK(!map.isKeyed());
+  BOOST_CHECK_EQUAL(map.stats().mLongestChain, 200u);
+  BOOST_CHECK_EQUAL(map.stats().mTreeifiedBuckets, 0u);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingSize_ThenZeroIsReturnd,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUniformKeys_WhenInserting_ThenGuardedMapKeepsStdHash,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map;
+  Map<K> map(10, Map<K>::Hashing::Guarded);
+  for (K key = 0; key < 1000; ++key)
+    map[key] = "Alice";
 
-  BOOST_CHECK_EQUAL(map.getSize(), 0);
+  BOOST_CHECK(!map.isKeyed());
+  BOOST_CHECK_EQUAL(map.stats().mLongestChain, 100u);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenGettingSize_ThenItemCountIsReturnd,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenReseeding_ThenItemsAndReferencesAreKept,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  map[1] = "1";
-  map[2] = "1";
+  Map<K> map(64);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 500; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+  std::string& value = map.valueOf(42);
 
-  BOOST_CHECK_EQUAL(map.getSize(), 2);
+  map.reseed(1);
+  Map<K> other(map);
+  other.reseed(2);
+
+  BOOST_CHECK(map.isKeyed());
+  BOOST_CHECK_EQUAL(&map.valueOf(42), &value);
+  thenMapContainsItems(map, expected);
+  thenMapContainsItems(other, expected);
+  BOOST_CHECK(map == other);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenInitializingFromListOfPairs_ThenAllItemsAreInMap,
-                              K,
-                              TestedKeyTypes)
+BOOST_AUTO_TEST_CASE(GivenKeyedMapsOfStrings_WhenComparingThem_ThenOnlyItemsMatter)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  aisdi::HashMap<std::string, int> map(16, aisdi::HashMap<std::string, int>::Hashing::Keyed);
+  aisdi::HashMap<std::string, int> other(16, aisdi::HashMap<std::string, int>::Hashing::Keyed);
+  for (int i = 0; i < 100; ++i)
+  {
+    map[std::to_string(i)] = i;
+    other[std::to_string(99 - i)] = 99 - i;
+  }
 
-  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
-}
+  const aisdi::HashMap<std::string, int> copy(map);
 
+  BOOST_CHECK(map.isKeyed());
+  BOOST_CHECK(copy.isKeyed());
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(copy == other);
+  BOOST_CHECK_EQUAL(copy.valueOf("42"), 42);
+}
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenDereferencing_ThenItemCanBeChanged,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeys_WhenInserting_ThenLongChainIsTreeified,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Chuck" }, { 27, "Bob" } };
+  Map<K> map(100, Map<K>::Hashing::Treeified);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 200; ++key)
+  {
+    map[key * 100] = std::to_string(key);
+    expected[key * 100] = std::to_string(key);
+  }
+  map[5] = "Alice";
+  expected[5] = "Alice";
 
-  auto it = map.find(42);
-  it->second = "Alice";
+  const auto stats = map.stats();
+  BOOST_CHECK(!map.isKeyed());
+  BOOST_CHECK_EQUAL(stats.mLongestChain, 200u);
+  BOOST_CHECK_EQUAL(stats.mTreeifiedBuckets, 1u);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(map.find(150) == map.end());
 
-  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
+  std::size_t visited = 0;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    ++visited;
+  BOOST_CHECK_EQUAL(visited, expected.size());
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAddingItem_ThenItemIsInMap,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTreeifiedChain_WhenItShrinks_ThenItIsUntreeified,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(100, Map<K>::Hashing::Treeified);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 20; ++key)
+  {
+    map[key * 100] = "Alice";
+    expected[key * 100] = "Alice";
+  }
+  BOOST_CHECK_EQUAL(map.stats().mTreeifiedBuckets, 1u);
 
-  map[42] = "Alice";
+  for (K key = 0; key < 15; key += 2)
+  {
+    map.remove(key * 100);
+    map.remove(map.find((key + 1) * 100));
+    expected.erase(key * 100);
+    expected.erase((key + 1) * 100);
+  }
 
-  thenMapContainsItems(map, { { 42, "Alice" } });
+  BOOST_CHECK_EQUAL(map.stats().mTreeifiedBuckets, 0u);
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenChangingItem_ThenNewValueIsInMap,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTreeifiedMap_WhenCopyingOrLoading_ThenResultIsTreeified,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Chuck" }, { 27, "Bob" } };
+  Map<K> map(10, Map<K>::Hashing::Treeified);
+  for (K key = 0; key < 100; ++key)
+    map[key * 10] = std::to_string(key);
+  std::stringstream stream;
+  map.save(stream);
 
-  map[42] = "Alice";
+  Map<K> copy(map);
+  const auto loaded = Map<K>::load(stream);
+  copy.remove(500);
+  copy[7] = "Bob";
 
-  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
+  BOOST_CHECK_EQUAL(copy.stats().mTreeifiedBuckets, 1u);
+  BOOST_CHECK_EQUAL(loaded.stats().mTreeifiedBuckets, 1u);
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK_EQUAL(map.valueOf(500), "50");
+  BOOST_CHECK(copy.find(500) == copy.end());
+  BOOST_CHECK_EQUAL(copy.valueOf(7), "Bob");
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenCreatingCopy_ThenBothMapsAreEmpty,
-                              K,
-                              TestedKeyTypes)
+BOOST_AUTO_TEST_CASE(GivenUnorderedKeys_WhenTheyCollide_ThenChainIsNotTreeified)
 {
-  const Map<K> map;
-  const Map<K> other(map);
+  aisdi::HashMap<UnorderedKey, int> map(10, aisdi::HashMap<UnorderedKey, int>::Hashing::Treeified);
+  for (int value = 0; value < 50; ++value)
+    map[UnorderedKey{ value }] = value;
 
-  BOOST_CHECK(other.isEmpty());
-  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK_EQUAL(map.stats().mLongestChain, 50u);
+  BOOST_CHECK_EQUAL(map.stats().mTreeifiedBuckets, 0u);
+  BOOST_CHECK_EQUAL(map.valueOf(UnorderedKey{ 42 }), 42);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenCreatingCopy_ThenAllItemsAreCopied,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeys_WhenHashingInBatch_ThenEveryLevelMatchesScalarHash,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  const Map<K> other{map};
-
-  map[1410] = "Grunwald";
+  std::mt19937_64 device;
+  std::vector<K> keys(100);
+  for (auto& key : keys)
+    key = static_cast<K>(device());
+  std::vector<std::uint64_t> hashes(keys.size());
 
-  thenMapContainsItems(map, { { 1410, "Grunwald" }, { 753, "Rome" }, { 1789, "Paris" } });
-  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  for (auto level : { aisdi::SimdLevel::Scalar, aisdi::SimdLevel::Avx2, aisdi::SimdLevel::Avx512 })
+  {
+    if (!aisdi::isSupported(level))
+      continue;
+    for (std::size_t count : { 0, 1, 7, 8, 15, 16, 17, 33, 100 })
+    {
+      aisdi::keyedHashBatch(keys.data(), count, 42, 7, hashes.data(), level);
+      for (std::size_t i = 0; i < count; ++i)
+        BOOST_CHECK_EQUAL(hashes[i], aisdi::KeyedHash<K>::hash(keys[i], 42, 7));
+    }
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMovingToOther_ThenBothMapsAreEmpty,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenItemsInBatch_WhenInserting_ThenLastOfRepeatedKeysWins,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  Map<K> other{std::move(map)};
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected = { { 1, "Alice" }, { 3, "Bob" } };
+  for (K key = 0; key < 2000; ++key)
+  {
+    items.emplace_back(key * 7 % 1500, std::to_string(key));
+    expected[key * 7 % 1500] = std::to_string(key);
+  }
 
-  BOOST_CHECK(map.isEmpty());
-  BOOST_CHECK(other.isEmpty());
+  for (auto hashing : { Map<K>::Hashing::Guarded, Map<K>::Hashing::Keyed })
+  {
+    Map<K> map(97, hashing);
+    map[1] = "Alice";
+    map[3] = "Bob";
+    map.insert(items.begin(), items.end());
+
+    thenMapContainsItems(map, expected);
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMovingToOther_ThenAllItemsAreMoved,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenGuardedMap_WhenInsertionReseedsIt_ThenReferencesStayValid,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  const Map<K> other{std::move(map)};
+  Map<K> map(100, Map<K>::Hashing::Guarded);
+  std::map<K, std::string*> references;
+  for (K key = 0; key < 1000 && !map.isKeyed(); ++key)
+  {
+    for (auto&& reference : references)
+      BOOST_REQUIRE_EQUAL(reference.second, &map.valueOf(reference.first));
+    references[key * 100] = &map[key * 100];
+    *references[key * 100] = std::to_string(key);
+  }
 
-  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
-  BOOST_CHECK(map.isEmpty());
+  BOOST_REQUIRE(map.isKeyed());
+  for (auto&& reference : references)
+  {
+    BOOST_CHECK_EQUAL(reference.second, &map.valueOf(reference.first));
+    BOOST_CHECK_EQUAL(*reference.second, std::to_string(reference.first / 100));
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenAssigningToOther_ThenOtherMapIsEmpty,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTreeifiedOrUnguardedMap_WhenInsertingCollidingKeys_ThenIterationOrderIsKept,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map;
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
-
-  other = map;
-
-  BOOST_CHECK(other.isEmpty());
+  for (auto hashing : { Map<K>::Hashing::Treeified, Map<K>::Hashing::Unguarded })
+  {
+    Map<K> map(100, hashing);
+    std::vector<K> order;
+    for (K key = 0; key < 1000; ++key)
+    {
+      map[key * 100] = "Alice";
+      order.insert(order.begin(), key * 100);
+    }
+
+    BOOST_CHECK(!map.isKeyed());
+    std::vector<K> iterated;
+    for (auto&& item : map)
+      iterated.push_back(item.first);
+    BOOST_CHECK(iterated == order);
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenAssigningToOther_ThenAllElementsAreCopied,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeysInBatch_WhenInserting_ThenReseededMapKeepsThemAll,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 1000; ++key)
+  {
+    items.emplace_back(key * 100, std::to_string(key));
+    expected[key * 100] = std::to_string(key);
+  }
 
-  other = map;
-  map[1410] = "Grunwald";
+  Map<K> map(100, Map<K>::Hashing::Guarded);
+  map.insert(items.begin(), items.end());
 
-  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
+  BOOST_CHECK(map.isKeyed());
+  thenMapContainsItems(map, expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSelfAssigning_ThenNothingHappens,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeysInBatch_WhenFinding_ThenValuesOfPresentOnesAreReturned,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(64, Map<K>::Hashing::Keyed);
+  for (K key = 0; key < 500; key += 2)
+    map[key] = std::to_string(key);
+  std::vector<K> keys;
+  for (K key = 0; key < 600; ++key)
+    keys.push_back(key);
 
-  map = map;
+  std::vector<const std::string*> values;
+  map.find(keys.begin(), keys.end(), std::back_inserter(values));
 
-  BOOST_CHECK(map.isEmpty());
+  BOOST_REQUIRE_EQUAL(values.size(), keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    if (keys[i] % 2 == 0 && keys[i] < 500)
+    {
+      BOOST_REQUIRE(values[i] != nullptr);
+      BOOST_CHECK_EQUAL(values[i], &map.valueOf(keys[i]));
+    }
+    else
+      BOOST_CHECK(values[i] == nullptr);
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenSelfAssigning_ThenNothingHappens,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenItems_WhenBuildingInParallel_ThenChainsMatchSerialBuild,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-
-  map = map;
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 3000; ++key)
+  {
+    items.emplace_back(key * 7 % 1500, std::to_string(key));
+    expected[key * 7 % 1500] = std::to_string(key);
+  }
 
-  thenMapContainsItems(map, { { 42, "Alice" }, { 27, "Bob" } });
+  for (std::size_t buckets : { 10, 97, 1000 })
+  {
+    Map<K> serial(buckets);
+    for (auto&& item : items)
+      serial[item.first] = item.second;
+
+    for (std::size_t threads : { 1, 2, 3, 8 })
+    {
+      aisdi::ThreadPool pool(threads);
+      const auto map = Map<K>::parallelBuild(items.begin(), items.end(), buckets, pool);
+
+      thenMapContainsItems(map, expected);
+      BOOST_CHECK_EQUAL(map.getBucketCount(), buckets);
+      auto expectedIt = serial.begin();
+      for (auto it = map.begin(); it != map.end(); ++it, ++expectedIt)
+        BOOST_CHECK(*it == *expectedIt);
+    }
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMoveAssigning_ThenBothMapsAreEmpty,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeyedMap_WhenBuildingInParallel_ThenAllItemsAreFound,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 2000; ++key)
+  {
+    items.emplace_back(key, std::to_string(key));
+    expected[key] = std::to_string(key);
+  }
 
-  other = std::move(map);
+  aisdi::ThreadPool pool(4);
+  const auto map = Map<K>::parallelBuild(items.begin(), items.end(), 500, pool, Map<K>::Hashing::Keyed);
 
-  BOOST_CHECK(other.isEmpty());
-  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.isKeyed());
+  thenMapContainsItems(map, expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigning_ThenAllElementsAreMoved,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCollidingKeys_WhenBuildingInParallel_ThenMapIsReseededOrTreeified,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
-  Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
+  std::vector<std::pair<K, std::string>> items;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 1000; ++key)
+  {
+    items.emplace_back(key * 100, std::to_string(key));
+    expected[key * 100] = std::to_string(key);
+  }
 
-  other = std::move(map);
+  aisdi::ThreadPool pool(4);
+  const auto guarded = Map<K>::parallelBuild(items.begin(), items.end(), 100, pool, Map<K>::Hashing::Guarded);
+  const auto treeified = Map<K>::parallelBuild(items.begin(), items.end(), 100, pool, Map<K>::Hashing::Treeified);
 
-  thenMapContainsItems(other, { { 753, "Rome" }, { 1789, "Paris" } });
-  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(guarded.isKeyed());
+  thenMapContainsItems(guarded, expected);
+  BOOST_CHECK(!treeified.isKeyed());
+  BOOST_CHECK_EQUAL(treeified.stats().mTreeifiedBuckets, 1u);
+  thenMapContainsItems(treeified, expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenReadingValueOfAnyKey_ThenExceptionIsThrown,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNoItems_WhenBuildingInParallel_ThenMapIsEmpty,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map;
-
-  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
-}
+  const std::vector<std::pair<K, std::string>> items;
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenReadingValueOfMissingKey_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
-{
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const auto map = Map<K>::parallelBuild(items.begin(), items.end(), 64);
 
-  BOOST_CHECK_THROW(map.valueOf(1), std::out_of_range);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_EQUAL(map.getBucketCount(), 64u);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenReadingValueOfAKey_ThenValueIsReturned,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenReducingInParallel_ThenResultMatchesSerialFold,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> map(1000);
+  for (K key = 0; key < 5000; ++key)
+    map[key * 7 % 5003] = std::to_string(key);
+  std::size_t length = 0;
+  std::string keys;
+  for (auto&& item : map)
+  {
+    length += item.second.size();
+    keys += std::to_string(item.first) + ",";
+  }
 
-  BOOST_CHECK_EQUAL(map.valueOf(42), "Alice");
+  for (std::size_t threads : { 1, 3, 8 })
+  {
+    aisdi::ThreadPool pool(threads);
+    const Map<K>& shared = map;
+
+    const auto total = shared.parallelReduce(std::size_t(0), [](const typename Map<K>::value_type& item) {
+      return item.second.size();
+    }, std::plus<std::size_t>(), pool);
+    const auto joined = shared.parallelReduce(std::string(), [](const typename Map<K>::value_type& item) {
+      return std::to_string(item.first) + ",";
+    }, std::plus<std::string>(), pool);
+
+    BOOST_CHECK_EQUAL(total, length);
+    BOOST_CHECK(joined == keys);
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenChangingValueOfAKey_ThenValueIsChanged,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenUpdatingInParallel_ThenEveryValueIsUpdatedOnce,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> map(1000);
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 3000; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key) + "!";
+  }
 
-  map.valueOf(42) = "Chuck";
+  aisdi::ThreadPool pool(4);
+  map.parallelForEach([](typename Map<K>::value_type& item) {
+    item.second += "!";
+  }, pool);
 
-  thenMapContainsItems(map, { { 42, "Chuck" }, { 27, "Bob" } });
+  thenMapContainsItems(map, expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenRemovingValueByKey_ThenExceptionIsThrown,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingFunction_WhenRunningInParallel_ThenExceptionIsRethrown,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map;
+  Map<K> map(1000);
+  for (K key = 0; key < 1000; ++key)
+    map[key] = "Alice";
 
-  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  aisdi::ThreadPool pool(4);
+  BOOST_CHECK_THROW(map.parallelForEach([](const typename Map<K>::value_type& item) {
+    if (item.first == 500)
+      throw std::runtime_error("Bob");
+  }, pool), std::runtime_error);
+  BOOST_CHECK_EQUAL(map.parallelReduce(0, [](const typename Map<K>::value_type&) {
+    return 1;
+  }, std::plus<int>(), pool), 1000);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByWrongKey_ThenExceptionIsThrown,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenFreezing_ThenFrozenMapIsEmpty,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  const Map<K> map;
+
+  const auto frozen = map.freeze();
 
-  BOOST_CHECK_THROW(map.remove(1), std::out_of_range);
+  BOOST_CHECK(frozen.isEmpty());
+  BOOST_CHECK(frozen.begin() == frozen.end());
+  BOOST_CHECK(frozen.find(42) == frozen.end());
+  BOOST_CHECK_THROW(frozen.valueOf(42), std::out_of_range);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingValueByKey_ThenItemIsRemoved,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenLookingUpKeys_ThenPresentOnesAreFound,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> map;
+  for (K key = 0; key < 1000; ++key)
+    map[key * 7] = std::to_string(key);
 
-  map.remove(27);
+  const auto frozen = map.freeze();
 
-  thenMapContainsItems(map, { { 42, "Alice" } });
+  BOOST_CHECK_EQUAL(frozen.getSize(), map.getSize());
+  for (K key = 0; key < 7000; ++key)
+  {
+    auto it = frozen.find(key);
+    if (key % 7 == 0)
+    {
+      BOOST_REQUIRE(it != frozen.end());
+      BOOST_CHECK_EQUAL(it->first, key);
+      BOOST_CHECK_EQUAL(frozen.valueOf(key), std::to_string(key / 7));
+    }
+    else
+    {
+      BOOST_CHECK(it == frozen.end());
+      BOOST_CHECK_THROW(frozen.valueOf(key), std::out_of_range);
+    }
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingValueByKey_ThenMapBecomesEmpty,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenIterating_ThenEveryItemIsVisitedOnce,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 27, "Bob" } };
-
-  map.remove(27);
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key = 1; key < 500; ++key)
+  {
+    map[key * key] = std::to_string(key);
+    expected[key * key] = std::to_string(key);
+  }
 
-  BOOST_CHECK(map.isEmpty());
-}
+  const auto frozen = map.freeze();
+  map[0] = "Alice";
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenErasingEnd_ThenExceptionIsThrown,
-                              K,
-                              TestedKeyTypes)
-{
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  std::map<K, std::string> visited;
+  for (const auto& item : frozen)
+    BOOST_CHECK(visited.insert(item).second);
 
-  BOOST_CHECK_THROW(map.remove(end(map)), std::out_of_range);
+  BOOST_CHECK(visited == expected);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNotEmptyMap_WhenRemovingItemByIterator_ThenItemIsRemoved,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenLargeMap_WhenFreezing_ThenHashFunctionIsCompact,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
+  Map<K> map(4096);
+  for (K key = 0; key < 20000; ++key)
+    map[key] = "Chuck";
 
-  map.remove(map.find(42));
+  const auto frozen = map.freeze();
 
-  thenMapContainsItems(map, { { 27, "Bob" } });
+  BOOST_CHECK_EQUAL(frozen.getSize(), 20000u);
+  BOOST_CHECK_LT(frozen.bitsPerKey(), 3.5);
+  for (K key = 0; key < 20000; key += 97)
+    BOOST_CHECK(frozen.find(key) != frozen.end());
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSingleItemMap_WhenRemovingItemByIterator_ThenMapBecomesEmpty,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSavingAndLoading_ThenBucketLayoutIsRestored,
                               K,
                               TestedKeyTypes)
 {
-  Map<K> map = { { 42, "Alice" } };
+  Map<K> map(97);
+  for (K key = 0; key < 1000; ++key)
+    map[key * 3] = std::string(key % 7, 'x') + std::to_string(key);
+  std::stringstream stream;
 
-  map.remove(map.find(42));
+  map.save(stream);
+  const auto loaded = Map<K>::load(stream);
 
-  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK_EQUAL(loaded.getBucketCount(), 97u);
+  auto expected = map.begin();
+  for (auto it = loaded.begin(); it != loaded.end(); ++it, ++expected)
+    BOOST_CHECK_EQUAL(it->first, expected->first);
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEmptyMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenKeyedOrReseededMap_WhenSavingAndLoading_ThenEveryItemIsFound,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map;
-  const Map<K> other;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 200; ++key)
+    expected[key] = std::to_string(key);
 
-  BOOST_CHECK(map == other);
+  for (std::uint64_t seed = 1; seed <= 100; ++seed)
+  {
+    Map<K> reseeded(50, Map<K>::Hashing::Guarded);
+    Map<K> keyed(50, Map<K>::Hashing::Keyed);
+    for (const auto& item : expected)
+    {
+      reseeded[item.first] = item.second;
+      keyed[item.first] = item.second;
+    }
+    reseeded.reseed(seed);
+
+    for (const Map<K>* map : { &reseeded, &keyed })
+    {
+      std::stringstream stream;
+      map->save(stream);
+      const auto loaded = Map<K>::load(stream);
+
+      BOOST_CHECK(loaded.isKeyed());
+      thenMapContainsItems(loaded, expected);
+      BOOST_CHECK(loaded == *map);
+    }
+  }
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEqualMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapFollowedByData_WhenLoading_ThenFollowingDataCanBeRead,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 42, "Alice" }, { 27, "Bob" } };
-
-  BOOST_CHECK(map == other);
-}
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+  std::stringstream stream;
+  map.save(stream);
+  stream << "trailer";
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoEquivalentMaps_WhenComparingThem_ThenTheyAreReportedAsEqual,
-                              K,
-                              TestedKeyTypes)
-{
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 27, "Bob" }, { 42, "Alice" } };
+  const auto loaded = Map<K>::load(stream);
+  std::string trailer;
+  stream >> trailer;
 
-  BOOST_CHECK(map == other);
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK_EQUAL(trailer, "trailer");
 }
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentValues_WhenComparingThem_ThenTheyAreNotEqual,
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCorruptedFile_WhenLoading_ThenOperationThrows,
                               K,
                               TestedKeyTypes)
 {
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" } };
-  const Map<K> other = { { 27, "Alice" }, { 42, "Bob" } };
-
-  BOOST_CHECK(map != other);
-}
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" } };
+  std::stringstream stream;
+  map.save(stream);
+  const std::string file = stream.str();
 
-BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_ThenTheyAreNotEqual,
-                              K,
-                              TestedKeyTypes)
-{
-  const Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
-  const Map<K> other = { { 27, "Alice" }, { 42, "Bob" } };
+  std::string flipped = file;
+  flipped[flipped.size() - 5] ^= 1;
+  std::stringstream corrupted(flipped);
+  std::stringstream truncated(file.substr(0, file.size() - 3));
+  std::stringstream empty;
 
-  BOOST_CHECK(map != other);
+  BOOST_CHECK_THROW(Map<K>::load(corrupted), std::runtime_error);
+  BOOST_CHECK_THROW(Map<K>::load(truncated), std::runtime_error);
+  BOOST_CHECK_THROW(Map<K>::load(empty), std::runtime_error);
 }
 
 // ConstIterator is tested via Iterator methods.
@@ -0,0 +1,229 @@
+#include <LinkedHashMap.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::LinkedHashMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(LinkedHashMapTests)
+
+template <typename K>
+std::vector<K> keysOf(const Map<K>& map)
+{
+  std::vector<K> keys;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    keys.push_back(it->first);
+  return keys;
+}
+
+template <typename K>
+std::vector<K> keysBackwards(const Map<K>& map)
+{
+  std::vector<K> keys;
+  auto it = map.end();
+  while (it != map.begin())
+  {
+    --it;
+    keys.push_back(it->first);
+  }
+  return keys;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingIterators_ThenBeginEqualsEnd,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK_THROW(--(map.end()), std::out_of_range);
+  BOOST_CHECK_THROW(++(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenInsertedKeys_WhenIterating_ThenInsertionOrderIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(7);
+  for (K key : { 42, 7, 1000, 3, 14 })
+    map[key] = "Alice";
+
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 42, 7, 1000, 3, 14 }));
+  BOOST_CHECK(keysBackwards(map) == std::vector<K>({ 14, 3, 1000, 7, 42 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenInsertionOrder_WhenReassigningKey_ThenItKeepsItsPosition,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" } };
+
+  map[1] = "Dave";
+  map.valueOf(2);
+  map.find(1);
+
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 1, 2, 3 }));
+  BOOST_CHECK_EQUAL(map.valueOf(1), "Dave");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenAccessOrder_WhenAccessingKeys_ThenTheyMoveToBack,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(10, Map<K>::Order::Access);
+  for (K key = 1; key <= 4; ++key)
+    map[key] = "Bob";
+
+  map[2] = "Chuck";
+  map.valueOf(1);
+  map.find(3);
+
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 4, 2, 1, 3 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenAccessOrder_WhenReadingThroughConstMap_ThenOrderIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(10, Map<K>::Order::Access);
+  for (K key = 1; key <= 3; ++key)
+    map[key] = "Bob";
+  const Map<K>& constMap = map;
+
+  constMap.valueOf(1);
+  constMap.find(2);
+
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 1, 2, 3 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingItems_ThenOrderOfOthersIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(3);
+  for (K key = 0; key < 6; ++key)
+    map[key] = "Alice";
+
+  map.remove(0);
+  map.remove(3);
+  map.remove(--map.end());
+
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 1, 2, 4 }));
+  BOOST_CHECK(keysBackwards(map) == std::vector<K>({ 4, 2, 1 }));
+  BOOST_CHECK_EQUAL(map.getSize(), 3u);
+  BOOST_CHECK_THROW(map.remove(0), std::out_of_range);
+  BOOST_CHECK_THROW(map.remove(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenRemovingAllItems_ThenItBecomesEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+
+  map.remove(map.begin());
+  map.remove(map.begin());
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  map[5] = "Chuck";
+  BOOST_CHECK(keysOf(map) == std::vector<K>({ 5 }));
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopying_ThenCopyHasSameItemsInSameOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map(10, Map<K>::Order::Access);
+  for (K key : { 9, 4, 6 })
+    map[key] = "Dave";
+
+  Map<K> copy(map);
+  copy[4] = "Eve";
+  map[12] = "Frank";
+
+  BOOST_CHECK(keysOf(copy) == std::vector<K>({ 9, 6, 4 }));
+  BOOST_CHECK(copy.getOrder() == Map<K>::Order::Access);
+  BOOST_CHECK_EQUAL(map.valueOf(4), "Dave");
+  BOOST_CHECK_EQUAL(copy.getSize(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenMoving_ThenSourceBecomesEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+
+  Map<K> moved(std::move(map));
+  Map<K> assigned;
+  assigned[7] = "Chuck";
+  assigned = std::move(moved);
+
+  BOOST_CHECK(keysOf(assigned) == std::vector<K>({ 1, 2 }));
+  BOOST_CHECK(map.isEmpty());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsWithSameItemsInDifferentOrder_WhenComparing_ThenTheyAreEqual,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+  const Map<K> other = { { 2, "Bob" }, { 1, "Alice" } };
+  const Map<K> different = { { 2, "Bob" }, { 1, "Chuck" } };
+
+  BOOST_CHECK(map == other);
+  BOOST_CHECK(map != different);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenIterator_WhenWritingThroughIt_ThenValueIsChanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" } };
+
+  map.begin()->second = "Bob";
+
+  BOOST_CHECK_EQUAL(map.valueOf(1), "Bob");
+}
+
+struct ThrowingValue
+{
+  static bool throwing;
+
+  ThrowingValue()
+  {
+    if (throwing)
+      throw std::runtime_error("Bob");
+  }
+};
+
+bool ThrowingValue::throwing = false;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingValueConstructor_WhenAddingItem_ThenMapIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  aisdi::LinkedHashMap<K, ThrowingValue> map;
+  map[1];
+
+  ThrowingValue::throwing = true;
+  BOOST_CHECK_THROW(map[2], std::runtime_error);
+  ThrowingValue::throwing = false;
+
+  BOOST_CHECK_EQUAL(map.getSize(), 1);
+  BOOST_CHECK(map.find(2) == map.end());
+  map[2];
+  BOOST_CHECK_EQUAL(map.getSize(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
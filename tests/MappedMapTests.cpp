@@ -0,0 +1,213 @@
+#include <MappedMap.h>
+
+#include <HashMap.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::MappedMap<K, double>;
+
+template <typename K>
+using HashedMap = aisdi::MappedHashMap<K, double>;
+
+BOOST_AUTO_TEST_SUITE(MappedMapTests)
+
+/* Unique file in the temporary directory, so that test binaries sharing these cases can run in parallel;
+ * removed when the test case ends. */
+struct TemporaryFile
+{
+  std::string path;
+
+  TemporaryFile()
+  {
+    const char* directory = std::getenv("TMPDIR");
+    std::string pattern = std::string(directory != nullptr ? directory : "/tmp") + "/MappedMapTests.XXXXXX";
+    std::vector<char> name(pattern.begin(), pattern.end());
+    name.push_back('\0');
+    int descriptor = ::mkstemp(name.data());
+    if (descriptor == -1)
+      throw std::runtime_error("Cannot create " + pattern);
+    ::close(descriptor);
+    path = name.data();
+  }
+
+  TemporaryFile(const TemporaryFile&) = delete;
+
+  TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+  ~TemporaryFile()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+template <typename K>
+std::map<K, double> squares(K count)
+{
+  std::map<K, double> items;
+  for (K key = 1; key <= count; ++key)
+    items[key * 3] = key * 0.5;
+  return items;
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenMapping_ThenMappedMapIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const std::map<K, double> items;
+
+  Map<K>::write(file.path, items.begin(), items.end());
+  const Map<K> map(file.path);
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(42) == map.end());
+  BOOST_CHECK(map.lowerBound(42) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(42), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenUnsortedItems_WhenMapping_ThenIterationIsOrdered,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const auto expected = squares<K>(500);
+  aisdi::HashMap<K, double> items;
+  for (auto&& item : expected)
+    items[item.first] = item.second;
+
+  Map<K>::write(file.path, items.begin(), items.end());
+  const Map<K> map(file.path);
+
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  auto it = map.begin();
+  for (auto&& item : expected)
+  {
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+  BOOST_CHECK(map.find(4) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMappedMap_WhenScanningRange_ThenKeysInRangeAreVisited,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const auto items = squares<K>(100);
+  Map<K>::write(file.path, items.begin(), items.end());
+  const Map<K> map(file.path);
+
+  std::vector<K> scanned;
+  for (auto it = map.lowerBound(100); it != map.end() && it->first < 120; ++it)
+    scanned.push_back(it->first);
+
+  BOOST_CHECK((scanned == std::vector<K>{ 102, 105, 108, 111, 114, 117 }));
+  BOOST_CHECK(map.lowerBound(301) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRepeatedKeys_WhenMapping_ThenLastOneWins,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const std::vector<std::pair<K, double>> items = { { 5, 1.0 }, { 1, 2.0 }, { 5, 3.0 } };
+
+  Map<K>::write(file.path, items.begin(), items.end());
+  HashedMap<K>::write(file.path + "h", items.begin(), items.end());
+  const Map<K> map(file.path);
+  const HashedMap<K> hashed(file.path + "h");
+  std::remove((file.path + "h").c_str());
+
+  BOOST_CHECK_EQUAL(map.getSize(), 2u);
+  BOOST_CHECK_EQUAL(map.valueOf(5), 3.0);
+  BOOST_CHECK_EQUAL(hashed.getSize(), 2u);
+  BOOST_CHECK_EQUAL(hashed.valueOf(5), 3.0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenHashedMap_WhenLookingUpKeys_ThenPresentOnesAreFound,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const auto items = squares<K>(1000);
+
+  HashedMap<K>::write(file.path, items.begin(), items.end());
+  const HashedMap<K> map(file.path);
+
+  BOOST_CHECK_EQUAL(map.getSize(), items.size());
+  for (K key = 0; key < 3100; ++key)
+  {
+    auto it = map.find(key);
+    if (items.count(key))
+    {
+      BOOST_REQUIRE(it != map.end());
+      BOOST_CHECK_EQUAL(it->second, items.at(key));
+    }
+    else
+    {
+      BOOST_CHECK(it == map.end());
+      BOOST_CHECK_THROW(map.valueOf(key), std::out_of_range);
+    }
+  }
+
+  std::map<K, double> visited;
+  for (auto it = map.begin(); it != map.end(); ++it)
+    visited[it->first] = it->second;
+  BOOST_CHECK(visited == items);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMappedMap_WhenMoving_ThenMappingFollows,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const auto items = squares<K>(10);
+  Map<K>::write(file.path, items.begin(), items.end());
+
+  Map<K> map(file.path);
+  Map<K> moved(std::move(map));
+
+  BOOST_CHECK_EQUAL(moved.getSize(), 10u);
+  BOOST_CHECK_EQUAL(moved.valueOf(30), 5.0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenForeignOrMismatchedFile_WhenMapping_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  TemporaryFile file;
+  const auto items = squares<K>(10);
+
+  BOOST_CHECK_THROW(Map<K>(file.path), std::runtime_error);
+
+  Map<K>::write(file.path, items.begin(), items.end());
+  BOOST_CHECK_THROW(HashedMap<K>(file.path), std::runtime_error);
+  BOOST_CHECK_THROW((aisdi::MappedMap<K, float>(file.path)), std::runtime_error);
+
+  std::ofstream(file.path, std::ios::binary | std::ios::trunc) << "not a mapped map file, but long enough to "
+                                                                   "hold a whole header of sixty four bytes";
+  BOOST_CHECK_THROW(Map<K>(file.path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#include <PersistentTreeMap.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <boost/mpl/list.hpp>
+
+using TestedKeyTypes = boost::mpl::list<std::int32_t, std::uint64_t>;
+
+template <typename K>
+using Map = aisdi::PersistentTreeMap<K, std::string>;
+
+BOOST_AUTO_TEST_SUITE(PersistentTreeMapTests)
+
+template <typename K>
+void thenMapContainsItems(const Map<K>& map,
+                          const std::map<K, std::string>& expected)
+{
+  BOOST_REQUIRE_EQUAL(map.getSize(), expected.size());
+  BOOST_CHECK_NO_THROW(map.validate());
+
+  auto it = map.begin();
+  for (const auto& item : expected)
+  {
+    BOOST_REQUIRE(it != map.end());
+    BOOST_CHECK_EQUAL(it->first, item.first);
+    BOOST_CHECK_EQUAL(it->second, item.second);
+    BOOST_CHECK_EQUAL(map.valueOf(item.first), item.second);
+    ++it;
+  }
+  BOOST_CHECK(it == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingIterators_ThenBeginEqualsEnd,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+  BOOST_CHECK(map.find(42) == map.end());
+  BOOST_CHECK_THROW(map.valueOf(42), std::out_of_range);
+  BOOST_CHECK_THROW(--(map.end()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomOperations_WhenComparingWithStdMap_ThenContentsMatch,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 device;
+  std::uniform_int_distribution<int> keys(0, 300);
+
+  for (int i = 0; i < 3000; ++i)
+  {
+    K key = keys(device);
+    if (i % 3 == 2)
+    {
+      if (expected.erase(key))
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+  }
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenOriginalIsModified_ThenSnapshotIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 200; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key);
+  }
+
+  const Map<K> snapshot = map.snapshot();
+  BOOST_CHECK(snapshot == map);
+  map[7] = "Alice";
+  map[500] = "Bob";
+  map.remove(100);
+  map.valueOf(150) = "Chuck";
+
+  thenMapContainsItems(snapshot, expected);
+  expected[7] = "Alice";
+  expected[500] = "Bob";
+  expected.erase(100);
+  expected[150] = "Chuck";
+  thenMapContainsItems(map, expected);
+  BOOST_CHECK(snapshot != map);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSnapshot_WhenSnapshotIsModified_ThenOriginalIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" } };
+
+  Map<K> snapshot(map);
+  snapshot.remove(2);
+  snapshot[4] = "Dave";
+
+  thenMapContainsItems(map, { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" } });
+  thenMapContainsItems(snapshot, { { 1, "Alice" }, { 3, "Chuck" }, { 4, "Dave" } });
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenManyVersions_WhenEachIsModified_ThenAllKeepTheirContents,
+                              K,
+                              TestedKeyTypes)
+{
+  std::vector<Map<K>> versions(1);
+  for (K key = 0; key < 100; ++key)
+  {
+    versions.push_back(versions.back());
+    versions.back()[key] = std::to_string(key);
+    if (key % 10 == 9)
+      versions.back().remove(key - 5);
+  }
+
+  for (std::size_t i = 0; i < versions.size(); ++i)
+  {
+    std::map<K, std::string> expected;
+    for (K key = 0; static_cast<std::size_t>(key) < i; ++key)
+    {
+      expected[key] = std::to_string(key);
+      if (key % 10 == 9)
+        expected.erase(key - 5);
+    }
+    thenMapContainsItems(versions[i], expected);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingBackwards_ThenKeysAreDescending,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key : { 50, 20, 80, 10, 30, 70, 90, 60 })
+    map[key] = "Alice";
+
+  std::vector<K> keys;
+  auto it = map.end();
+  while (it != map.begin())
+    keys.push_back((--it)->first);
+
+  BOOST_CHECK((keys == std::vector<K>{ 90, 80, 70, 60, 50, 30, 20, 10 }));
+  BOOST_CHECK_THROW(--it, std::out_of_range);
+  BOOST_CHECK_EQUAL((++map.find(30))->first, 50u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,144 @@
+#include <ThreadPool.h>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace
+{
+
+const std::size_t PoolSizes[] = { 1, 2, 4 };
+
+/* Nodes of a Fibonacci tree of order n, forking at every node. */
+long long fibonacciNodes(aisdi::ThreadPool& pool, int n)
+{
+  if (n < 2)
+    return n;
+  long long left = 0;
+  long long right = 0;
+  pool.join([&]() { left = fibonacciNodes(pool, n - 1); },
+            [&]() { right = fibonacciNodes(pool, n - 2); });
+  return left + right + 1;
+}
+
+std::string caughtMessage(aisdi::ThreadPool& pool, bool throwLeft, bool throwRight)
+{
+  try
+  {
+    pool.join([throwLeft]() {
+      if (throwLeft)
+        throw std::runtime_error("left");
+    }, [throwRight]() {
+      if (throwRight)
+        throw std::runtime_error("right");
+    });
+  }
+  catch (const std::runtime_error& error)
+  {
+    return error.what();
+  }
+  return "";
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTests)
+
+BOOST_AUTO_TEST_CASE(GivenPool_WhenForkingRecursively_ThenEveryBranchRuns)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+
+    BOOST_CHECK_EQUAL(pool.getSize(), threads);
+    BOOST_CHECK_EQUAL(fibonacciNodes(pool, 20), 17710);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenBothBranchesThrowing_WhenJoining_ThenLeftExceptionIsRethrown)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+
+    BOOST_CHECK_EQUAL(caughtMessage(pool, true, true), "left");
+    BOOST_CHECK_EQUAL(caughtMessage(pool, true, false), "left");
+    BOOST_CHECK_EQUAL(caughtMessage(pool, false, true), "right");
+    BOOST_CHECK_EQUAL(caughtMessage(pool, false, false), "");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingLeftBranch_WhenJoining_ThenRightBranchStillRuns)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+    bool ran = false;
+
+    BOOST_CHECK_THROW(pool.join([]() { throw std::runtime_error("left"); },
+                                [&ran]() { ran = true; }),
+                      std::runtime_error);
+    BOOST_CHECK(ran);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenRange_WhenRunning_ThenEveryIndexIsCalledOnce)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+    for (std::size_t tasks : { 0, 1, 7, 1000 })
+    {
+      std::vector<std::atomic<int>> calls(tasks);
+      for (auto&& count : calls)
+        count = 0;
+
+      pool.run(tasks, [&calls](std::size_t task) { ++calls[task]; });
+
+      for (auto&& count : calls)
+        BOOST_CHECK_EQUAL(count.load(), 1);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingTask_WhenRunning_ThenExceptionIsRethrownAfterAllTasks)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+    std::atomic<int> calls(0);
+
+    BOOST_CHECK_THROW(pool.run(100, [&calls](std::size_t task) {
+      ++calls;
+      if (task == 42)
+        throw std::runtime_error("Bob");
+    }), std::runtime_error);
+    BOOST_CHECK_EQUAL(calls.load(), 100);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenThreadsOutsidePool_WhenJoiningConcurrently_ThenAllFinish)
+{
+  for (std::size_t threads : PoolSizes)
+  {
+    aisdi::ThreadPool pool(threads);
+    std::vector<long long> results(4, 0);
+    std::vector<std::thread> callers;
+    for (std::size_t i = 0; i < results.size(); ++i)
+      callers.emplace_back([&pool, &results, i]() {
+        results[i] = fibonacciNodes(pool, 15);
+      });
+    for (auto&& caller : callers)
+      caller.join();
+
+    for (long long result : results)
+      BOOST_CHECK_EQUAL(result, 1596);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
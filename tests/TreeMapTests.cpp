@@ -1,8 +1,13 @@
 #include <TreeMap.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <string>
 #include <map>
+#include <sstream>
+#include <random>
+#include <stdexcept>
 
 #include <boost/test/unit_test.hpp>
 
@@ -591,6 +596,423 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(GivenTwoMapsWithDifferentKeys_WhenComparingThem_Th
   BOOST_CHECK(map != other);
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenDecrementingBegin_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 42, "Alice" }, { 27, "Bob" }, { 13, "Chuck" } };
+
+  BOOST_CHECK_THROW(--(map.begin()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenIteratingBackwards_ThenItemsAreInDescendingOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 100; ++key)
+  {
+    map[(key * 37) % 100] = "Alice";
+    expected[(key * 37) % 100] = "Alice";
+  }
+
+  auto it = map.end();
+  for (auto expectedIt = expected.rbegin(); expectedIt != expected.rend(); ++expectedIt)
+  {
+    --it;
+    BOOST_REQUIRE_EQUAL(it->first, expectedIt->first);
+  }
+  BOOST_CHECK(it == map.begin());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenGettingStats_ThenTreeIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  const auto stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.mSize, 0u);
+  BOOST_CHECK_EQUAL(stats.mHeight, 0);
+  BOOST_CHECK_EQUAL(stats.mOptimalHeight, 0);
+  BOOST_CHECK_EQUAL(stats.mRotations, 0u);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenSortedInsertions_WhenGettingStats_ThenTreeIsBalanced,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 1023; ++key)
+    map[key] = "Bob";
+
+  const auto stats = map.stats();
+
+  BOOST_CHECK_EQUAL(stats.mSize, 1023u);
+  BOOST_CHECK_EQUAL(stats.mOptimalHeight, 10);
+  BOOST_CHECK_GE(stats.mHeight, 10);
+  BOOST_CHECK_LE(stats.mHeight, 14);
+  BOOST_CHECK_LT(stats.mAverageDepth, stats.mHeight);
+  BOOST_CHECK_GT(stats.mRotations, 0u);
+  BOOST_CHECK_NO_THROW(map.validate());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenRandomInsertionsAndRemovals_WhenValidating_ThenTreeStaysConsistent,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  std::mt19937 device;
+  std::uniform_int_distribution<int> keys(0, 300);
+  std::bernoulli_distribution removal(0.4);
+
+  for (int i = 0; i < 3000; ++i)
+  {
+    const K key = keys(device);
+    if (removal(device))
+    {
+      if (expected.erase(key))
+        map.remove(key);
+      else
+        BOOST_CHECK_THROW(map.remove(key), std::out_of_range);
+    }
+    else
+    {
+      map[key] = std::to_string(i);
+      expected[key] = std::to_string(i);
+    }
+    BOOST_REQUIRE_NO_THROW(map.validate());
+  }
+
+  thenMapContainsItems(map, expected);
+  auto expectedIt = expected.begin();
+  for (auto it = map.begin(); it != map.end(); ++it, ++expectedIt)
+    BOOST_REQUIRE_EQUAL(it->first, expectedIt->first);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenCopying_ThenShapeIsKept,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 1000; ++key)
+    map[(key * 37) % 1000] = std::to_string(key);
+
+  const Map<K> copy(map);
+  Map<K> assigned = { { 42, "Alice" } };
+  assigned = map;
+
+  const Map<K>* copies[] = { &copy, &assigned };
+  for (const Map<K>* other : copies)
+  {
+    BOOST_CHECK_NO_THROW(other->validate());
+    BOOST_CHECK(*other == map);
+    BOOST_CHECK_EQUAL(other->stats().mHeight, map.stats().mHeight);
+    BOOST_CHECK_EQUAL(other->stats().mAverageDepth, map.stats().mAverageDepth);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCopiedMap_WhenModifyingIt_ThenOriginalIsUnchanged,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 100; ++key)
+    map[key] = "Alice";
+
+  Map<K> copy(map);
+  for (K key = 0; key < 100; key += 2)
+    copy.remove(key);
+  copy[7] = "Bob";
+
+  BOOST_CHECK_NO_THROW(copy.validate());
+  BOOST_CHECK_EQUAL(map.getSize(), 100u);
+  BOOST_CHECK_EQUAL(map.valueOf(7), "Alice");
+  BOOST_CHECK_EQUAL(copy.getSize(), 50u);
+  BOOST_CHECK_EQUAL(copy.valueOf(7), "Bob");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsOfDifferentShapes_WhenComparingThem_ThenOnlyItemsMatter,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  Map<K> other;
+  for (K key = 0; key < 100; ++key)
+  {
+    map[key] = "Alice";
+    other[99 - key] = "Alice";
+  }
+  other[200] = "Bob";
+  other.remove(200);
+
+  BOOST_CHECK(map == other);
+  other[50] = "Bob";
+  BOOST_CHECK(map != other);
+  other[50] = "Alice";
+  other.remove(0);
+  other[100] = "Alice";
+  BOOST_CHECK(map != other);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNonEmptyMap_WhenMoveAssigningEqualMap_ThenSourceBecomesEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 753, "Rome" }, { 1789, "Paris" } };
+  Map<K> other = { { 753, "Rome" }, { 1789, "Paris" } };
+
+  other = std::move(map);
+
+  BOOST_CHECK_EQUAL(other.getSize(), 2u);
+  BOOST_CHECK(map.isEmpty());
+  BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenFreezing_ThenSnapshotIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+
+  const auto frozen = map.freeze();
+
+  BOOST_CHECK(frozen.isEmpty());
+  BOOST_CHECK(frozen.begin() == frozen.end());
+  BOOST_CHECK(frozen.find(1) == frozen.end());
+  BOOST_CHECK(frozen.lowerBound(1) == frozen.end());
+  BOOST_CHECK_THROW(frozen.valueOf(1), std::out_of_range);
+  BOOST_CHECK_THROW(--frozen.end(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMapsOfAllShapes_WhenFreezing_ThenSnapshotIteratesInOrder,
+                              K,
+                              TestedKeyTypes)
+{
+  for (K size = 0; size < 70; ++size)
+  {
+    Map<K> map;
+    std::map<K, std::string> expected;
+    for (K i = 0; i < size; ++i)
+    {
+      map[2 * i + 1] = std::to_string(i);
+      expected[2 * i + 1] = std::to_string(i);
+    }
+
+    const auto frozen = map.freeze();
+
+    BOOST_REQUIRE_EQUAL(frozen.getSize(), expected.size());
+    auto it = frozen.begin();
+    for (const auto& item : expected)
+    {
+      BOOST_REQUIRE_EQUAL(it->first, item.first);
+      BOOST_REQUIRE_EQUAL(it->second, item.second);
+      ++it;
+    }
+    BOOST_REQUIRE(it == frozen.end());
+    for (auto item = expected.rbegin(); item != expected.rend(); ++item)
+      BOOST_REQUIRE_EQUAL((--it)->first, item->first);
+    BOOST_REQUIRE(it == frozen.begin());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenLookingUpKeys_ThenResultsMatchStdMap,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K i = 0; i < 100; ++i)
+  {
+    map[3 * i + 1] = std::to_string(i);
+    expected[3 * i + 1] = std::to_string(i);
+  }
+
+  const auto frozen = map.freeze();
+
+  for (K key = 0; key < 310; ++key)
+  {
+    auto expectedIt = expected.lower_bound(key);
+    auto it = frozen.lowerBound(key);
+    if (expectedIt == expected.end())
+    {
+      BOOST_CHECK(it == frozen.end());
+      continue;
+    }
+    BOOST_CHECK_EQUAL(it->first, expectedIt->first);
+    if (expectedIt->first == key)
+      BOOST_CHECK_EQUAL(frozen.valueOf(key), expectedIt->second);
+    else
+      BOOST_CHECK(frozen.find(key) == frozen.end());
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenFrozenMap_WhenChangingOriginal_ThenSnapshotIsUnaffected,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" } };
+  const auto frozen = map.freeze();
+
+  map[1] = "Chuck";
+  map[3] = "Dave";
+  map.remove(2);
+
+  BOOST_CHECK_EQUAL(frozen.getSize(), 2u);
+  BOOST_CHECK_EQUAL(frozen.valueOf(1), "Alice");
+  BOOST_CHECK_EQUAL(frozen.valueOf(2), "Bob");
+  BOOST_CHECK(frozen.find(3) == frozen.end());
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenSavingAndLoading_ThenBalancedEqualMapIsRestored,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 1000; ++key)
+    map[key * 3] = std::string(key % 7, 'x') + std::to_string(key);
+  std::stringstream stream;
+
+  map.save(stream);
+  const auto loaded = Map<K>::load(stream);
+
+  BOOST_CHECK(loaded == map);
+  BOOST_CHECK_NO_THROW(loaded.validate());
+  BOOST_CHECK_EQUAL(loaded.stats().mHeight, loaded.stats().mOptimalHeight);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenEmptyMap_WhenSavingAndLoading_ThenLoadedMapIsEmpty,
+                              K,
+                              TestedKeyTypes)
+{
+  const Map<K> map;
+  std::stringstream stream;
+
+  map.save(stream);
+  auto loaded = Map<K>::load(stream);
+
+  BOOST_CHECK(loaded.isEmpty());
+  BOOST_CHECK(loaded.begin() == loaded.end());
+  loaded[1] = "Alice";
+  BOOST_CHECK_EQUAL(loaded.valueOf(1), "Alice");
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenCorruptedFile_WhenLoading_ThenOperationThrows,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map = { { 1, "Alice" }, { 2, "Bob" }, { 3, "Chuck" } };
+  std::stringstream stream;
+  map.save(stream);
+  const std::string file = stream.str();
+
+  std::string flipped = file;
+  flipped[flipped.size() / 2] ^= 1;
+  std::stringstream corrupted(flipped);
+  std::stringstream truncated(file.substr(0, file.size() - 3));
+  std::stringstream foreign("not a map file at all");
+
+  BOOST_CHECK_THROW(Map<K>::load(corrupted), std::runtime_error);
+  BOOST_CHECK_THROW(Map<K>::load(truncated), std::runtime_error);
+  BOOST_CHECK_THROW(Map<K>::load(foreign), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenReducingInParallel_ThenResultMatchesSerialFold,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 5000; ++key)
+    map[key * 7 % 5003] = std::to_string(key);
+  std::size_t length = 0;
+  std::string keys;
+  for (auto&& item : map)
+  {
+    length += item.second.size();
+    keys += std::to_string(item.first) + ",";
+  }
+
+  for (std::size_t threads : { 1, 3, 8 })
+  {
+    aisdi::ThreadPool pool(threads);
+    const Map<K>& shared = map;
+
+    const auto total = shared.parallelReduce(std::size_t(0), [](const typename Map<K>::value_type& item) {
+      return item.second.size();
+    }, std::plus<std::size_t>(), pool);
+    const auto joined = shared.parallelReduce(std::string(), [](const typename Map<K>::value_type& item) {
+      return std::to_string(item.first) + ",";
+    }, std::plus<std::string>(), pool);
+
+    BOOST_CHECK_EQUAL(total, length);
+    BOOST_CHECK(joined == keys);
+  }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenMap_WhenUpdatingInParallel_ThenEveryValueIsUpdatedOnce,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  std::map<K, std::string> expected;
+  for (K key = 0; key < 3000; ++key)
+  {
+    map[key] = std::to_string(key);
+    expected[key] = std::to_string(key) + "!";
+  }
+
+  aisdi::ThreadPool pool(4);
+  map.parallelForEach([](typename Map<K>::value_type& item) {
+    item.second += "!";
+  }, pool);
+
+  thenMapContainsItems(map, expected);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenThrowingFunction_WhenRunningInParallel_ThenExceptionIsRethrown,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> map;
+  for (K key = 0; key < 1000; ++key)
+    map[key] = "Alice";
+
+  aisdi::ThreadPool pool(4);
+  BOOST_CHECK_THROW(map.parallelForEach([](const typename Map<K>::value_type& item) {
+    if (item.first == 500)
+      throw std::runtime_error("Bob");
+  }, pool), std::runtime_error);
+  BOOST_CHECK_EQUAL(map.parallelReduce(0, [](const typename Map<K>::value_type&) {
+    return 1;
+  }, std::plus<int>(), pool), 1000);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(GivenNestedParallelScans_WhenSharingPool_ThenInnerScansComplete,
+                              K,
+                              TestedKeyTypes)
+{
+  Map<K> outer;
+  aisdi::TreeMap<K, std::size_t> inner;
+  for (K key = 0; key < 200; ++key)
+    outer[key] = "";
+  for (K key = 0; key < 500; ++key)
+    inner[key] = 1;
+
+  aisdi::ThreadPool pool(4);
+  outer.parallelForEach([&](typename Map<K>::value_type& item) {
+    const auto count = inner.parallelReduce(std::size_t(0), [](const std::pair<const K, std::size_t>& pair) {
+      return pair.second;
+    }, std::plus<std::size_t>(), pool);
+    item.second = std::to_string(count);
+  }, pool);
+
+  for (auto&& item : outer)
+    BOOST_CHECK_EQUAL(item.second, "500");
+}
+
 // ConstIterator is tested via Iterator methods.
 // If Iterator methods are to be changed, then new ConstIterator tests are required.
 